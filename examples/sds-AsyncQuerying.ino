@@ -0,0 +1,80 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (implementation)
+
+/// @file sds-AsyncQuerying.ino
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011async.h"
+
+/// hardware port to be used with the sensor
+HardwareSerial port(2);
+/// hardware uart rx pin
+#define SDS_RX 13
+/// hardware uart tx pin
+#define SDS_TX 16
+/// transport wrapping the hardware port
+sds011StreamTransport uart;
+/// non-blocking sds011 command engine
+sds011Async sds;
+/// result slot of the running data query
+sds011AsyncResult query;
+/// millis() of the last data query
+unsigned long lastQuery;
+
+/**************************************************************************/
+/*!
+    @brief  called when a configuration command has completed
+    @param result the outcome of the command
+    @param ctx name of the command
+    @returns void
+*/
+/**************************************************************************/
+void configured( const sds011AsyncResult *result, void *ctx )
+{
+  Serial.print( (const char *)ctx ); Serial.print( result->status ? " ok: " : " failed: " ); Serial.println( result->reply[4] );
+}
+
+/**************************************************************************/
+/*!
+    @brief  initialization of peripherals attached to ESP32 board
+    @returns void
+*/
+/**************************************************************************/
+void setup() {
+  Serial.begin(115200);
+  Serial.println("Testing SDS Dust Sensory Libray, asynchronous...");
+
+  port.begin(9600, SERIAL_8N1, SDS_RX, SDS_TX);
+  uart.attach(&port);
+  sds.begin(&uart);
+
+  // queued, sent one after the other by poll()
+  sds.sleepWorkMode( WORK_MODE, WRITE_MODE, NULL, configured, (void *)"Work mode" );
+  sds.workPeriod( 0, WRITE_MODE, NULL, configured, (void *)"Work period" );
+  sds.dataReportingMode( QUERY_MODE, WRITE_MODE, NULL, configured, (void *)"Query mode" );
+  query.done = true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  polls the sensor engine, other work is never blocked
+    @returns void
+*/
+/**************************************************************************/
+void loop()
+{
+  sds.poll();
+
+  if ( query.done && query.status ) {
+    Serial.print("pm10: "); Serial.print( ( query.reply[4] + ( query.reply[5] << 8 ) ) / 10.0, 1 );
+    Serial.print(", pm2.5: "); Serial.println( ( query.reply[2] + ( query.reply[3] << 8 ) ) / 10.0, 1 );
+    query.status = false;
+  }
+  // datasheet advises 3 seconds as minimum poll time.
+  if ( query.done && millis() - lastQuery >= 3000 ) {
+    lastQuery = millis();
+    sds.dataQuery( &query );
+  }
+
+  // ... networking, display, other sensors
+}
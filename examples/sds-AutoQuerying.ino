@@ -5,6 +5,7 @@
 /// @version 0.1
 
 #include "sds011lib.h"
+#include "sds011cadence.h"
 
 /// sensor pm10 values to be used
 float p10;
@@ -18,8 +19,18 @@ HardwareSerial port(2);
 #define SDS_RX 13
 /// hardware uart tx pin
 #define SDS_TX 16
+/// work period in minutes: one report every WORK_PERIOD minutes
+#define WORK_PERIOD 3
+/// longest wait for a report in ms, one work period and a margin for the sensor's clock
+#define REPORT_TIMEOUT ( WORK_PERIOD * 60000UL + 10000UL )
 /// sds011 class instance
 sds011 sds;
+/// transport the reports are read from
+sds011StreamTransport reports;
+/// reads the auto reports in step with the sensor
+sds011CadenceReader reader;
+/// the last report
+sds011Sample sample;
 /// temporary array/string of char
 char  str[80];
 
@@ -59,7 +70,7 @@ void setup() {
   //2nd 0：report active mode
   //0：continuous(default)
   //1-30minute：【work 30 seconds and sleep n*60-30 seconds】
-  sds.workPeriodCmd( &result, 3,WRITE_MODE );
+  sds.workPeriodCmd( &result, WORK_PERIOD,WRITE_MODE );
   if ( result != MSG_FF ){
     Serial.println( "Work Period set to: "+String(result));  
   }
@@ -114,8 +125,9 @@ void setup() {
   if ( result != MSG_FF ){
     Serial.print( "Reporting Mode read as: "); Serial.println( result == AUTO_REPORT_MODE?"AutoReportmode":"Querymode" ); 
   }
-  delay(100);
 
+  reports.attach(&port);
+  reader.begin(&reports);
 }
 
 /**************************************************************************/
@@ -126,10 +138,14 @@ void setup() {
 /**************************************************************************/
 void loop() 
 {
-  status = sds.dataAutoQueryCmd(&p10, &p25 );
+  // idles until just before the next report is due, then reads it
+  status = reader.wait( &sample, REPORT_TIMEOUT );
   if ( status ) {
+     p10 = sds011DeciToFloat( sample.pm10 );
+     p25 = sds011DeciToFloat( sample.pm25 );
      Serial.print("pm10: "); Serial.print( p10,1 ); Serial.print(", pm2.5: "); Serial.println( p25,1); 
+     if ( reader.missed() ) {
+       Serial.print("missed reports: "); Serial.println( reader.missed() );
+     }
   }
-  // datasheet advises 3 seconds as minimum poll time.
-  delay(3000);
 }
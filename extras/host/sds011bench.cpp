@@ -0,0 +1,865 @@
+//! Host tool: protocol and command latency benchmarks
+
+/// @file sds011bench.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Measures frame encode throughput per command, parser throughput on a
+/// clean and a noisy byte stream, the batch decoder (scalar and vector
+/// kernels, frames per second on one core), the telemetry exporters
+/// (bytes per second against snprintf(), output checked byte for byte and
+/// streamed to a socket without a heap allocation), and the round trip of commands against the
+/// software sensor at 9600 baud. The typed command API is checked to make
+/// no heap allocation; the tool exits with 1 if it does. Every result is one JSON object per line,
+/// so runs can be collected and compared:
+///
+///     ./build/sds011bench [-q] [-n round_trips]   (-q skips the round trips)
+///     make bench                                  (writes build/bench.jsonl)
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sds011lib.h"
+#include "sds011async.h"
+#include "sds011batch.h"
+#include "sds011export.h"
+#include "sds011frame.h"
+#include "sds011sim.h"
+
+/// size of the generated byte streams
+#define STREAM_LEN ( 1UL << 20 )
+
+/// keeps results alive so the compiler cannot drop the measured work
+static volatile uint32_t sink;
+
+/// heap allocations of the whole program, counted by the wrappers below
+static volatile uint32_t allocations;
+
+// glibc entry points, malloc and friends below take their place program wide
+extern "C" void *__libc_malloc( size_t size );
+extern "C" void *__libc_calloc( size_t n, size_t size );
+extern "C" void *__libc_realloc( void *ptr, size_t size );
+
+extern "C" void *malloc( size_t size ) { ++allocations; return( __libc_malloc( size ) ); }
+extern "C" void *calloc( size_t n, size_t size ) { ++allocations; return( __libc_calloc( n, size ) ); }
+extern "C" void *realloc( void *ptr, size_t size ) { ++allocations; return( __libc_realloc( ptr, size ) ); }
+
+/**************************************************************************/
+/*!
+    @brief  monotonic time in nanoseconds
+    @returns the time
+*/
+/**************************************************************************/
+static uint64_t nanos(void)
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return( ts.tv_sec * 1000000000ULL + ts.tv_nsec );
+}
+
+/**************************************************************************/
+/*!
+    @brief  prints one throughput result
+    @param bench the benchmark
+    @param name the case
+    @param ops operations done
+    @param bytes bytes processed, 0 if not meaningful
+    @param ns time taken in ns
+    @returns void
+*/
+/**************************************************************************/
+static void result( const char *bench, const char *name, uint64_t ops, uint64_t bytes, uint64_t ns )
+{
+  printf( "{\"bench\":\"%s\",\"case\":\"%s\",\"ops\":%llu,\"ns_per_op\":%.2f,\"ops_per_s\":%.0f", bench, name,
+          (unsigned long long)ops, (double)ns / ops, ops * 1e9 / ns );
+  if ( bytes ) printf( ",\"mb_per_s\":%.1f", bytes * 1e3 / ns );
+  printf( "}\n" );
+  fflush( stdout );
+}
+
+/**************************************************************************/
+/*!
+    @brief  encodes requests of one command with varying options
+    @param name the case
+    @param command the command id
+    @returns void
+*/
+/**************************************************************************/
+static void encode( const char *name, uint8_t command )
+{
+  const uint64_t n = 20000000;
+  sds011Request frame;
+  const uint8_t *bytes;
+  uint32_t acc = 0;
+  uint64_t i, t0;
+
+  t0 = nanos();
+  for ( i = 0; i < n; ++i )
+  {
+    bytes = sds011RequestBytes( &frame, command, (uint8_t)( i & 1 ), (uint8_t)i, MSG_FF, MSG_FF );
+    acc += bytes[17];
+  }
+  result( "encode", name, n, n * SDS011_REQUEST_LEN, nanos() - t0 );
+  sink = acc;
+}
+
+/**************************************************************************/
+/*!
+    @brief  appends one valid data or configuration reply
+    @param out destination
+    @param i varies the contents
+    @returns number of bytes written
+*/
+/**************************************************************************/
+static size_t reply( uint8_t *out, uint32_t i )
+{
+  uint8_t k;
+
+  out[0] = MSG_HEAD;
+  out[1] = i % 8 ? REPLY_DATA : REPLY_CFG;
+  out[2] = i % 8 ? (uint8_t)i : CMD_WORKING_PERIOD;
+  out[3] = (uint8_t)( i >> 8 );
+  out[4] = (uint8_t)( i * 7 );
+  out[5] = 0x01;
+  out[6] = 0xa1;
+  out[7] = 0x60;
+  out[8] = 0;
+  for ( k = 2; k < 8; ++k ) out[8] += out[k];
+  out[9] = MSG_TAIL;
+  return( SDS011_REPLY_LEN );
+}
+
+/**************************************************************************/
+/*!
+    @brief  fills a stream of replies, optionally with noise: random bytes
+    between frames and frames with a broken check-sum or tail
+    @param buf destination of STREAM_LEN bytes
+    @param noisy true for the noisy stream
+    @param frames receives the number of intact frames
+    @returns void
+*/
+/**************************************************************************/
+static void stream( uint8_t *buf, bool noisy, uint32_t *frames )
+{
+  size_t len = 0, n;
+  uint32_t i = 0;
+
+  srand( 1 );
+  *frames = 0;
+  while ( len + 2 * SDS011_REPLY_LEN <= STREAM_LEN )
+  {
+    if ( noisy && rand() % 4 == 0 )
+    {
+      // a burst of line noise, which includes stray header bytes
+      for ( n = rand() % 8; n > 0; --n ) buf[len++] = rand() % 3 ? (uint8_t)rand() : MSG_HEAD;
+    }
+    n = reply( buf + len, i++ );
+    if ( noisy && rand() % 10 == 0 )
+    {
+      buf[len + 8 + rand() % 2] ^= 0x5a;
+    }else
+    {
+      ++*frames;
+    }
+    len += n;
+  }
+  memset( buf + len, 0, STREAM_LEN - len );
+}
+
+/**************************************************************************/
+/*!
+    @brief  parses a stream repeatedly
+    @param name the case
+    @param buf the stream of STREAM_LEN bytes
+    @param expected intact frames in the stream
+    @returns void
+*/
+/**************************************************************************/
+static void parse( const char *name, const uint8_t *buf, uint32_t expected )
+{
+  const int rounds = 20;
+  sds011Parser parser;
+  uint32_t frames = 0;
+  uint64_t t0;
+  size_t i;
+  int r;
+
+  t0 = nanos();
+  for ( r = 0; r < rounds; ++r )
+  {
+    parser.reset();
+    for ( i = 0; i < STREAM_LEN; ++i )
+    {
+      if ( parser.push( buf[i] ) ) frames += parser.frame()[2];
+    }
+  }
+  result( "parse", name, (uint64_t)STREAM_LEN * rounds, (uint64_t)STREAM_LEN * rounds, nanos() - t0 );
+  sink = frames;
+  // every intact frame must be found, however noisy the stream
+  parser.reset();
+  for ( i = 0, frames = 0; i < STREAM_LEN; ++i ) frames += parser.push( buf[i] );
+  if ( frames != expected ) fprintf( stderr, "%s: %u of %u frames found\n", name, frames, expected );
+}
+
+/**************************************************************************/
+/*!
+    @brief  compares two latencies for qsort
+*/
+/**************************************************************************/
+static int compare( const void *a, const void *b )
+{
+  unsigned long x = *(const unsigned long *)a, y = *(const unsigned long *)b;
+
+  return( x < y ? -1 : x > y );
+}
+
+/**************************************************************************/
+/*!
+    @brief  decodes an array of frames, one in 16 of them broken, with the
+    scalar and the vector batch kernels and checks that both agree
+    @param buf scratch of STREAM_LEN bytes
+    @returns false when the kernels disagree
+*/
+/**************************************************************************/
+static bool batch( uint8_t *buf )
+{
+  const size_t count = STREAM_LEN / SDS011_REPLY_LEN;
+  const int rounds = 50;
+  uint16_t *words = (uint16_t *)malloc( 6 * count * sizeof( uint16_t ) );
+  uint8_t *valid = (uint8_t *)malloc( 2 * count );
+  float *values = (float *)malloc( count * sizeof( float ) );
+  sds011Batch a = { words, words + count, words + 2 * count, valid };
+  sds011Batch b = { words + 3 * count, words + 4 * count, words + 5 * count, valid + count };
+  size_t i, na = 0, nb = 0;
+  uint64_t t0;
+  bool same;
+  int r;
+
+  for ( i = 0; i < count; ++i )
+  {
+    reply( buf + i * SDS011_REPLY_LEN, (uint32_t)i * 8 + 1 );
+    if ( i % 16 == 5 ) buf[i * SDS011_REPLY_LEN + 8 + i % 2] ^= 0x5a;
+    if ( i % 16 == 11 ) buf[i * SDS011_REPLY_LEN + 1] = REPLY_CFG;
+  }
+  t0 = nanos();
+  for ( r = 0; r < rounds; ++r ) na = sds011DecodeBatchScalar( buf, count, a );
+  result( "batch", "scalar", (uint64_t)count * rounds, (uint64_t)count * rounds * SDS011_REPLY_LEN, nanos() - t0 );
+  t0 = nanos();
+  for ( r = 0; r < rounds; ++r ) nb = sds011DecodeBatch( buf, count, b );
+  result( "batch", SDS011_BATCH_KERNEL, (uint64_t)count * rounds, (uint64_t)count * rounds * SDS011_REPLY_LEN, nanos() - t0 );
+  t0 = nanos();
+  for ( r = 0; r < rounds; ++r ) sds011DeciToFloatBatch( b.pm25, values, count );
+  result( "batch", "to_float", (uint64_t)count * rounds, 0, nanos() - t0 );
+  sink = (uint32_t)values[count / 2];
+
+  same = na == nb && na == count - count / 8 && memcmp( a.valid, b.valid, count ) == 0;
+  for ( i = 0; same && i < count; ++i )
+  {
+    same = a.id[i] == b.id[i] && a.pm25[i] == b.pm25[i] && a.pm10[i] == b.pm10[i] && values[i] == sds011DeciToFloat( b.pm25[i] );
+  }
+  if ( !same ) fprintf( stderr, "batch: kernels disagree, %zu and %zu valid frames\n", na, nb );
+  free( words );
+  free( valid );
+  free( values );
+  return( same );
+}
+
+/// Unix time in ms at millis() 0 of the exported samples
+#define EXPORT_EPOCH 1700000000000ULL
+/// samples per exported batch
+#define EXPORT_COUNT 1024
+/// size of the buffer streamed to the socket
+#define EXPORT_CHUNK 4096
+
+/// one exporter, with the same signature for the text and the CBOR ones
+typedef sds011Export (*exporter)( const sds011Sample *samples, size_t count, uint8_t *buf, size_t size );
+
+/// line protocol with the epoch of the bench
+static sds011Export influx( const sds011Sample *samples, size_t count, uint8_t *buf, size_t size )
+{
+  return( sds011ExportInflux( samples, count, (char *)buf, size, EXPORT_EPOCH ) );
+}
+
+/// Prometheus text with the epoch of the bench
+static sds011Export prometheus( const sds011Sample *samples, size_t count, uint8_t *buf, size_t size )
+{
+  return( sds011ExportPrometheus( samples, count, (char *)buf, size, EXPORT_EPOCH ) );
+}
+
+/// CBOR with the epoch of the bench
+static sds011Export cbor( const sds011Sample *samples, size_t count, uint8_t *buf, size_t size )
+{
+  return( sds011ExportCbor( samples, count, buf, size, EXPORT_EPOCH ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  formats samples in line protocol with snprintf(), the way a
+    sketch does, as baseline and reference of the exporter
+    @param samples the batch
+    @param count number of samples
+    @param buf the buffer, large enough
+    @returns bytes written
+*/
+/**************************************************************************/
+static size_t influxPrintf( const sds011Sample *samples, size_t count, char *buf )
+{
+  size_t i, len = 0;
+
+  for ( i = 0; i < count; ++i )
+  {
+    const sds011Sample &s = samples[i];
+    len += sprintf( buf + len, "sds011,id=%04X pm25=%u.%u,pm10=%u.%u %llu\n", s.id, s.pm25 / 10, s.pm25 % 10,
+                    s.pm10 / 10, s.pm10 % 10, (unsigned long long)( ( EXPORT_EPOCH + s.time ) * 1000000ULL ) );
+  }
+  return( len );
+}
+
+/**************************************************************************/
+/*!
+    @brief  formats samples in the Prometheus format with snprintf(), the
+    reference of the exporter
+    @param samples the batch
+    @param count number of samples
+    @param buf the buffer, large enough
+    @returns bytes written
+*/
+/**************************************************************************/
+static size_t prometheusPrintf( const sds011Sample *samples, size_t count, char *buf )
+{
+  size_t i, len = 0;
+  int f;
+
+  for ( f = 0; f < 2; ++f )
+  {
+    len += sprintf( buf + len, "# TYPE sds011_%s gauge\n", f ? "pm10" : "pm25" );
+    for ( i = 0; i < count; ++i )
+    {
+      const sds011Sample &s = samples[i];
+      uint16_t v = f ? s.pm10 : s.pm25;
+      len += sprintf( buf + len, "sds011_%s{id=\"%04X\"} %u.%u %llu\n", f ? "pm10" : "pm25", s.id, v / 10, v % 10,
+                      (unsigned long long)( EXPORT_EPOCH + s.time ) );
+    }
+  }
+  return( len );
+}
+
+/**************************************************************************/
+/*!
+    @brief  reads one CBOR head
+    @param p the position, moved past the head
+    @param end end of the data
+    @param v the argument
+    @returns the major type, or -1 for an unexpected encoding
+*/
+/**************************************************************************/
+static int cborHead( const uint8_t *&p, const uint8_t *end, uint64_t *v )
+{
+  uint8_t info, len;
+
+  if ( p >= end ) return( -1 );
+  info = *p & 0x1f;
+  len = info < 24 ? 0 : info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : info == 27 ? 8 : 0xff;
+  if ( len == 0xff || p + 1 + len > end ) return( -1 );
+  *v = len ? 0 : info;
+  for ( int i = 1; i <= len; ++i ) *v = ( *v << 8 ) | p[i];
+  // the shortest form only
+  if ( len && *v < ( len == 1 ? 24ULL : 1ULL << ( len * 4 ) ) ) return( -1 );
+  info = *p >> 5;
+  p += 1 + len;
+  return( info );
+}
+
+/**************************************************************************/
+/*!
+    @brief  decodes the CBOR of the exporter back and compares it with the samples
+    @param samples the batch
+    @param count number of samples
+    @param buf the CBOR
+    @param len its length
+    @returns true when it holds exactly the samples
+*/
+/**************************************************************************/
+static bool cborMatches( const sds011Sample *samples, size_t count, const uint8_t *buf, size_t len )
+{
+  const uint8_t *p = buf, *end = buf + len;
+  uint64_t v, want[4];
+  size_t i;
+  int k;
+
+  if ( cborHead( p, end, &v ) != 4 || v != count ) return( false );
+  for ( i = 0; i < count; ++i )
+  {
+    want[0] = samples[i].id;
+    want[1] = EXPORT_EPOCH + samples[i].time;
+    want[2] = samples[i].pm25;
+    want[3] = samples[i].pm10;
+    if ( cborHead( p, end, &v ) != 4 || v != 4 ) return( false );
+    for ( k = 0; k < 4; ++k )
+    {
+      if ( cborHead( p, end, &v ) != 0 || v != want[k] ) return( false );
+    }
+  }
+  return( p == end );
+}
+
+/**************************************************************************/
+/*!
+    @brief  checks that an exporter cuts a batch at a whole sample for
+    every buffer size up to the output of the batch, and never writes past
+    the buffer
+    @param name the exporter
+    @param fn the exporter
+    @param samples a short batch
+    @param count number of samples
+    @returns true when every cut matches the export of its samples
+*/
+/**************************************************************************/
+static bool cuts( const char *name, exporter fn, const sds011Sample *samples, size_t count )
+{
+  uint8_t whole[4096], part[4096 + 16], again[4096];
+  sds011Export all = fn( samples, count, whole, sizeof( whole ) ), cut, ref;
+  size_t size;
+
+  for ( size = 0; size <= all.bytes; ++size )
+  {
+    memset( part, 0xee, sizeof( part ) );
+    cut = fn( samples, count, part, size );
+    ref = fn( samples, cut.samples, again, sizeof( again ) );
+    if ( cut.bytes > size || part[size] != 0xee || cut.bytes != ref.bytes || memcmp( part, again, cut.bytes ) != 0 ||
+         ( size == all.bytes ) != ( cut.samples == all.samples ) )
+    {
+      fprintf( stderr, "export: %s cut at %zu bytes wrong, %zu samples in %zu bytes\n", name, size, cut.samples, cut.bytes );
+      return( false );
+    }
+  }
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  checks that a batch with repeated ids is cut before the first
+    repeat where a sensor's samples could not be told apart: in the
+    Prometheus format and in line protocol without time, not in line
+    protocol with time or in CBOR
+    @param samples four samples to build the batch from
+    @returns true when every format cuts where it should
+*/
+/**************************************************************************/
+static bool repeats( const sds011Sample *samples )
+{
+  // ids A B A C B
+  const uint16_t ids[5] = { 0x1111, 0x2222, 0x1111, 0x3333, 0x2222 };
+  sds011Sample batch[5];
+  uint8_t out[1024];
+  char ref[1024];
+  sds011Export a, b, c, d, e, f;
+  size_t i;
+  bool ok;
+
+  for ( i = 0; i < 5; ++i )
+  {
+    batch[i] = samples[i];
+    batch[i].id = ids[i];
+  }
+  a = prometheus( batch, 5, out, sizeof( out ) );
+  ok = a.samples == 2 && a.bytes == prometheusPrintf( batch, 2, ref ) && memcmp( out, ref, a.bytes ) == 0;
+  b = prometheus( batch + 2, 3, out, sizeof( out ) );
+  c = sds011ExportInflux( batch, 5, (char *)out, sizeof( out ) );
+  d = sds011ExportInflux( batch + 2, 3, (char *)out, sizeof( out ) );
+  e = influx( batch, 5, out, sizeof( out ) );
+  f = cbor( batch, 5, out, sizeof( out ) );
+  ok &= b.samples == 3 && c.samples == 2 && d.samples == 3 && e.samples == 5 && f.samples == 5;
+  if ( !ok )
+  {
+    fprintf( stderr, "export: repeated ids cut wrong, prometheus %zu + %zu, influx without time %zu + %zu, "
+             "with time %zu, cbor %zu samples\n", a.samples, b.samples, c.samples, d.samples, e.samples, f.samples );
+  }
+  return( ok );
+}
+
+/// the reading end of the socket sink
+struct socketSink {
+	/// the socket
+	int fd;
+	/// bytes received until end of stream
+	uint64_t bytes;
+};
+
+/**************************************************************************/
+/*!
+    @brief  thread counting the bytes arriving at the sink
+    @param arg the socketSink
+    @returns NULL
+*/
+/**************************************************************************/
+static void *drain( void *arg )
+{
+  socketSink *sink = (socketSink *)arg;
+  static uint8_t buf[65536];
+  ssize_t n;
+
+  while ( ( n = read( sink->fd, buf, sizeof( buf ) ) ) > 0 ) sink->bytes += n;
+  return( NULL );
+}
+
+/**************************************************************************/
+/*!
+    @brief  streams batches through a fixed buffer into a local socket,
+    each batch continuing at the first sample that did not fit
+    @param name the case
+    @param fn the exporter
+    @param samples the batch
+    @param count number of samples
+    @returns false when the sink did not receive every byte or the
+    exporter allocated
+*/
+/**************************************************************************/
+static bool toSocket( const char *name, exporter fn, const sds011Sample *samples, size_t count )
+{
+  static uint8_t chunk[EXPORT_CHUNK];
+  const int rounds = 200;
+  socketSink reader = { -1, 0 };
+  uint64_t bytes = 0, t0;
+  uint32_t before;
+  pthread_t thread;
+  sds011Export res;
+  size_t done;
+  int fds[2], r;
+
+  if ( socketpair( AF_UNIX, SOCK_STREAM, 0, fds ) != 0 ) return( false );
+  reader.fd = fds[1];
+  pthread_create( &thread, NULL, drain, &reader );
+
+  before = allocations;
+  t0 = nanos();
+  for ( r = 0; r < rounds; ++r )
+  {
+    for ( done = 0; done < count; done += res.samples )
+    {
+      res = fn( samples + done, count - done, chunk, sizeof( chunk ) );
+      for ( size_t off = 0; off < res.bytes; )
+      {
+        ssize_t n = write( fds[0], chunk + off, res.bytes - off );
+        if ( n <= 0 ) break;
+        off += n;
+      }
+      bytes += res.bytes;
+    }
+  }
+  shutdown( fds[0], SHUT_WR );
+  pthread_join( thread, NULL );
+  result( "export", name, (uint64_t)count * rounds, bytes, nanos() - t0 );
+  before = allocations - before;
+  close( fds[0] );
+  close( fds[1] );
+
+  printf( "{\"bench\":\"alloc\",\"case\":\"%s\",\"samples\":%llu,\"bytes\":%llu,\"received\":%llu,\"allocations\":%u}\n",
+          name, (unsigned long long)count * rounds, (unsigned long long)bytes, (unsigned long long)reader.bytes, before );
+  fflush( stdout );
+  return( reader.bytes == bytes && before == 0 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  measures the exporters and snprintf() on a batch of samples,
+    checks their output against snprintf() and a CBOR decoder, and streams
+    them to a socket
+    @returns false on a wrong output, a lost byte or a heap allocation
+*/
+/**************************************************************************/
+static bool exporters(void)
+{
+  const int rounds = 500;
+  const size_t size = EXPORT_COUNT * 128;
+  sds011Sample *samples = (sds011Sample *)malloc( EXPORT_COUNT * sizeof( sds011Sample ) );
+  uint8_t *out = (uint8_t *)malloc( size );
+  char *ref = (char *)malloc( size );
+  sds011Export res = { 0, 0 };
+  size_t i, len = 0;
+  uint64_t t0;
+  uint32_t before;
+  bool ok = true;
+  int r;
+
+  // ids, times and values of every digit count, with the extremes
+  for ( i = 0; i < EXPORT_COUNT; ++i )
+  {
+    samples[i].id = (uint16_t)( i * 0x9e37 );
+    samples[i].time = (uint32_t)( i * 1000003UL );
+    samples[i].pm25 = (uint16_t)( i < 4 ? i : ( i * 2654435761UL ) >> ( 16 + i % 16 ) );
+    samples[i].pm10 = (uint16_t)( i % 64 == 1 ? 65535 : samples[i].pm25 + i % 1000 );
+  }
+  samples[EXPORT_COUNT - 1].time = 0xffffffffUL;
+
+  t0 = nanos();
+  for ( r = 0; r < rounds; ++r ) len = influxPrintf( samples, EXPORT_COUNT, ref );
+  result( "export", "influx_snprintf", (uint64_t)EXPORT_COUNT * rounds, (uint64_t)len * rounds, nanos() - t0 );
+
+  before = allocations;
+  t0 = nanos();
+  for ( r = 0; r < rounds; ++r ) res = influx( samples, EXPORT_COUNT, out, size );
+  result( "export", "influx", (uint64_t)EXPORT_COUNT * rounds, (uint64_t)res.bytes * rounds, nanos() - t0 );
+  ok &= res.samples == EXPORT_COUNT && res.bytes == len && memcmp( out, ref, len ) == 0;
+
+  len = prometheusPrintf( samples, EXPORT_COUNT, ref );
+  t0 = nanos();
+  for ( r = 0; r < rounds; ++r ) res = prometheus( samples, EXPORT_COUNT, out, size );
+  result( "export", "prometheus", (uint64_t)EXPORT_COUNT * rounds, (uint64_t)res.bytes * rounds, nanos() - t0 );
+  ok &= res.samples == EXPORT_COUNT && res.bytes == len && memcmp( out, ref, len ) == 0;
+
+  t0 = nanos();
+  for ( r = 0; r < rounds; ++r ) res = cbor( samples, EXPORT_COUNT, out, size );
+  result( "export", "cbor", (uint64_t)EXPORT_COUNT * rounds, (uint64_t)res.bytes * rounds, nanos() - t0 );
+  ok &= res.samples == EXPORT_COUNT && cborMatches( samples, EXPORT_COUNT, out, res.bytes );
+  before = allocations - before;
+  if ( !ok ) fprintf( stderr, "export: output differs from the reference\n" );
+  if ( before ) fprintf( stderr, "export: %u heap allocations\n", before );
+  ok &= before == 0;
+
+  ok &= cuts( "influx", influx, samples + 60, 8 );
+  ok &= cuts( "prometheus", prometheus, samples + 60, 8 );
+  ok &= cuts( "cbor", cbor, samples + 60, 8 );
+  ok &= repeats( samples + 60 );
+
+  ok &= toSocket( "influx_socket", influx, samples, EXPORT_COUNT );
+  ok &= toSocket( "prometheus_socket", prometheus, samples, EXPORT_COUNT );
+  ok &= toSocket( "cbor_socket", cbor, samples, EXPORT_COUNT );
+  // eight sensors: one exposition per eight samples
+  for ( i = 0; i < EXPORT_COUNT; ++i ) samples[i].id = (uint16_t)( 0x100 + i % 8 );
+  ok &= toSocket( "prometheus_socket_8_ids", prometheus, samples, EXPORT_COUNT );
+  free( samples );
+  free( out );
+  free( ref );
+  return( ok );
+}
+
+/**************************************************************************/
+/*!
+    @brief  prints the latency distribution of one command
+    @param name the case
+    @param us round trips in us, sorted in place
+    @param n number of round trips
+    @param failed round trips without a valid reply
+    @returns void
+*/
+/**************************************************************************/
+static void latency( const char *name, unsigned long *us, int n, int failed )
+{
+  unsigned long sum = 0;
+  int i;
+
+  qsort( us, n, sizeof( us[0] ), compare );
+  for ( i = 0; i < n; ++i ) sum += us[i];
+  printf( "{\"bench\":\"latency\",\"case\":\"%s\",\"baud\":9600,\"n\":%d,\"failed\":%d,\"mean_us\":%lu,\"p50_us\":%lu,"
+          "\"p90_us\":%lu,\"max_us\":%lu}\n", name, n, failed, sum / n, us[n / 2], us[n * 9 / 10], us[n - 1] );
+  fflush( stdout );
+}
+
+/**************************************************************************/
+/*!
+    @brief  measures command round trips against the software sensor
+    @param n round trips per command
+    @returns void
+*/
+/**************************************************************************/
+static void roundTrips( int n )
+{
+  sds011Simulator sim( 9600 );
+  sds011SimTransport port( &sim );
+  sds011 sds;
+  sds011Async async;
+  sds011AsyncResult res;
+  sds011Sample sample;
+  unsigned long *us = (unsigned long *)malloc( n * sizeof( unsigned long ) );
+  unsigned long t0;
+  uint8_t value;
+  int i, failed;
+
+  sim.reset( micros() );
+  sds.begin( &port );
+  sds.dataReportingModeCmd( &value, QUERY_MODE, WRITE_MODE );
+
+  for ( i = 0, failed = 0; i < n; ++i )
+  {
+    t0 = micros();
+    failed += !sds.dataQueryRaw( &sample );
+    us[i] = micros() - t0;
+  }
+  latency( "dataQueryCmd", us, n, failed );
+  for ( i = 0, failed = 0; i < n; ++i )
+  {
+    t0 = micros();
+    failed += !sds.workPeriodCmd( &value, DONT_CARE, READ_MODE );
+    us[i] = micros() - t0;
+  }
+  latency( "workPeriodCmd", us, n, failed );
+
+  // deviceInfoCmd needs Arduino's String, the engine sends the same firmware query
+  async.begin( &port );
+  for ( i = 0, failed = 0; i < n; ++i )
+  {
+    t0 = micros();
+    async.deviceInfo( &res );
+    while ( !res.done ) async.poll();
+    failed += !res.status;
+    us[i] = micros() - t0;
+  }
+  latency( "deviceInfo_async", us, n, failed );
+  free( us );
+}
+
+/**************************************************************************/
+/*!
+    @brief  measures waking and configuring a sleeping sensor, as a sketch
+    does after every deep sleep: one command at a time, as a profile with
+    an empty cache, and as a profile with the cache kept across the sleep
+    @param n bring-ups per case
+    @returns void
+*/
+/**************************************************************************/
+static void bringUps( int n )
+{
+  static const char *names[3] = { "sequential", "profile_cold", "profile_cached" };
+  sds011Simulator sim( 9600 );
+  sds011SimTransport port( &sim );
+  sds011 sds;
+  sds011Profile profile = { SDS011_FIELD_MODE | SDS011_FIELD_WORK | SDS011_FIELD_PERIOD, QUERY_MODE, WORK_MODE, 0, 0, 0 };
+  sds011State kept;
+  unsigned long *us = (unsigned long *)malloc( n * sizeof( unsigned long ) );
+  unsigned long t0, sum;
+  uint32_t commands;
+  uint8_t value, sent;
+  int c, i, failed;
+  bool ok;
+
+  sim.reset( micros() );
+  sds.begin( &port );
+  sds.applyProfile( profile );
+  for ( c = 0; c < 3; ++c )
+  {
+    for ( i = 0, failed = 0, commands = 0; i < n; ++i )
+    {
+      sds.sleepWorkModeCmd( &value, SLEEP_MODE, WRITE_MODE );
+      kept = sds.state();
+      sds.begin( &port );
+      if ( c == 2 ) sds.setState( kept );
+      t0 = micros();
+      if ( c == 0 )
+      {
+        ok = sds.sleepWorkModeCmd( &value, WORK_MODE, WRITE_MODE );
+        ok = sds.dataReportingModeCmd( &value, QUERY_MODE, WRITE_MODE ) && ok;
+        ok = sds.workPeriodCmd( &value, 0, WRITE_MODE ) && ok;
+        sent = 3;
+      }else
+      {
+        ok = sds.applyProfile( profile, &sent );
+      }
+      us[i] = micros() - t0;
+      failed += !ok;
+      commands += sent;
+    }
+    qsort( us, n, sizeof( us[0] ), compare );
+    for ( i = 0, sum = 0; i < n; ++i ) sum += us[i];
+    printf( "{\"bench\":\"bringup\",\"case\":\"%s\",\"baud\":9600,\"n\":%d,\"failed\":%d,\"commands\":%.1f,"
+            "\"mean_us\":%lu,\"p50_us\":%lu,\"max_us\":%lu}\n", names[c], n, failed, (double)commands / n,
+            sum / n, us[n / 2], us[n - 1] );
+    fflush( stdout );
+  }
+  free( us );
+}
+
+/**************************************************************************/
+/*!
+    @brief  counts the heap allocations of the typed command API
+    @param n calls per command
+    @returns number of allocations, 0 when the API is allocation free
+*/
+/**************************************************************************/
+static uint32_t allocationFree( int n )
+{
+  static const char *names[8] = { "query", "firmware", "reportMode", "setReportMode", "power", "setPower", "workPeriod", "setWorkPeriod" };
+  sds011Simulator sim( 9600 );
+  sds011SimTransport port( &sim );
+  sds011 sds;
+  uint32_t before, total = 0;
+  int c, i, failed;
+
+  sim.reset( micros() );
+  sds.begin( &port );
+  sds.setReportMode( SDS011_REPORT_QUERY );
+  for ( c = 0; c < 8; ++c )
+  {
+    before = allocations;
+    for ( i = 0, failed = 0; i < n; ++i )
+    {
+      switch ( c )
+      {
+        case 0: failed += sds.query().error != SDS011_OK; break;
+        case 1: failed += sds.firmware().error != SDS011_OK; break;
+        case 2: failed += sds.reportMode().error != SDS011_OK; break;
+        case 3: failed += sds.setReportMode( SDS011_REPORT_QUERY ).error != SDS011_OK; break;
+        case 4: failed += sds.power().error != SDS011_OK; break;
+        case 5: failed += sds.setPower( SDS011_POWER_WORK ).error != SDS011_OK; break;
+        case 6: failed += sds.workPeriod().error != SDS011_OK; break;
+        case 7: failed += sds.setWorkPeriod( 0 ).error != SDS011_OK; break;
+      }
+    }
+    before = allocations - before;
+    total += before;
+    printf( "{\"bench\":\"alloc\",\"case\":\"%s\",\"n\":%d,\"failed\":%d,\"allocations\":%u}\n",
+            names[c], n, failed, before );
+    fflush( stdout );
+  }
+  return( total );
+}
+
+int main( int argc, char **argv )
+{
+  uint8_t *buf = (uint8_t *)malloc( STREAM_LEN );
+  bool quick = false;
+  uint32_t frames;
+  int opt, n = 10;
+
+  while ( ( opt = getopt( argc, argv, "qn:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'q': quick = true; break;
+      case 'n': n = atoi( optarg ); break;
+      default:
+        fprintf( stderr, "usage: %s [-q] [-n round_trips]\n", argv[0] );
+        return( 2 );
+    }
+  }
+  if ( n < 1 ) n = 1;
+
+  encode( "reporting_mode", CMD_REPORTING_MODE );
+  encode( "query_data", CMD_QUERY_DATA );
+  encode( "set_device_id", CMD_SET_DEVICE_ID );
+  encode( "sleep_work", CMD_SLEEP_AND_WORK );
+  encode( "firmware", CMD_FIRMWARE_VERSION );
+  encode( "work_period", CMD_WORKING_PERIOD );
+
+  stream( buf, false, &frames );
+  parse( "clean", buf, frames );
+  stream( buf, true, &frames );
+  parse( "noisy", buf, frames );
+  if ( !batch( buf ) ) return( 1 );
+  if ( !exporters() ) return( 1 );
+  free( buf );
+
+  if ( !quick )
+  {
+    roundTrips( n );
+    bringUps( n );
+    if ( allocationFree( n ) ) return( 1 );
+  }
+  return( 0 );
+}
@@ -0,0 +1,171 @@
+//! Host tool: talks to a sensor on a tty, or to the built-in simulator
+
+/// @file sds011cli.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Runs the query sequence of the sds-AskQuerying sketch on a Linux host and
+/// prints the latency of every command. With -a it then switches to auto
+/// report mode and reads the reports in step with the sensor for a while.
+/// With -w all bytes on the line are captured for sds011replay:
+///
+///     ./build/sds011cli [-d] [-n queries] [-a seconds] [-w capture] /dev/ttyUSB0
+///     ./build/sds011cli [-d] [-n queries] [-a seconds] [-w capture] sim
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sds011lib.h"
+#include "sds011cadence.h"
+#include "sds011capture.h"
+#include "sds011sim.h"
+#include "sds011metrics.h"
+
+/// prints the outcome and duration of one command
+static void report( const char *name, bool status, unsigned long start, uint8_t value )
+{
+  printf( "%-22s %-5s %5lu ms  value %u\n", name, status ? "ok" : "error", millis() - start, value );
+}
+
+/// capture sink writing to a stdio file
+static size_t fileSink( const uint8_t *buf, size_t len, void *ctx )
+{
+  return( fwrite( buf, 1, len, (FILE *)ctx ) );
+}
+
+/// reads auto reports with the cadence-locked reader and prints them with the gaps
+static void reports( sds011 *sds, sds011Transport *port, unsigned long seconds )
+{
+  sds011CadenceReader reader;
+  sds011Sample s;
+  unsigned long start = millis();
+  uint8_t result;
+
+  sds->dataReportingModeCmd( &result, AUTO_REPORT_MODE, WRITE_MODE );
+  reader.begin( port );
+  while ( millis() - start < seconds * 1000 )
+  {
+    if ( !reader.wait( &s, 3000 ) )
+    {
+      printf( "no report within 3 s\n" );
+      continue;
+    }
+    printf( "%7.3f s  pm10 %u.%u pm2.5 %u.%u  period %u ms  missed %u\n", ( s.time - start ) / 1000.0, s.pm10 / 10, s.pm10 % 10,
+            s.pm25 / 10, s.pm25 % 10, reader.cadence().period(), reader.missed() );
+  }
+  printf( "reports: period %u ms, jitter %u ms, %u missed, %u late\n", reader.cadence().period(), reader.cadence().jitter(),
+          reader.cadence().gaps(), reader.cadence().late() );
+}
+
+#if SDS011_METRICS
+/// prints the protocol counters and the latency histograms
+static void metrics(void)
+{
+  static const char *names[SDS011_METRICS_COMMANDS] = { "reporting", "query", "id", "sleep/work", "firmware", "period" };
+  sds011MetricsSnapshot m;
+  uint8_t c, b;
+
+  sds011MetricsRead( &m );
+  printf( "frames %u  discarded %u  bad header %u  checksum %u  tail %u\n", m.frames, m.discarded, m.badHeader,
+          m.badChecksum, m.badTail );
+  printf( "commands %u  retries %u  timeouts %u  fps %u.%02u\n", m.commands, m.retries, m.timeouts, m.fps / 100, m.fps % 100 );
+  for ( c = 0; c < SDS011_METRICS_COMMANDS; ++c )
+  {
+    if ( m.latency[c].count == 0 ) continue;
+    printf( "%-10s n %u  mean %u ms  max %u ms  <2^n ms:", names[c], m.latency[c].count, m.latency[c].sum / m.latency[c].count,
+            m.latency[c].max );
+    for ( b = 0; b < SDS011_LATENCY_BINS; ++b ) printf( " %u", m.latency[c].bins[b] );
+    printf( "\n" );
+  }
+}
+#endif
+
+int main( int argc, char **argv )
+{
+  sds011PosixTransport tty;
+  sds011Simulator sim;
+  sds011SimTransport simport( &sim );
+  sds011CaptureTransport capture;
+  sds011Transport *port;
+  const char *capturePath = NULL;
+  FILE *out = NULL;
+  sds011 sds;
+  uint8_t result;
+  unsigned long start;
+  float p10, p25;
+  bool status, debug = false;
+  int opt, i, queries = 5;
+  unsigned long seconds = 0;
+
+  while ( ( opt = getopt( argc, argv, "dn:a:w:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'd': debug = true; break;
+      case 'n': queries = atoi( optarg ); break;
+      case 'a': seconds = strtoul( optarg, NULL, 10 ); break;
+      case 'w': capturePath = optarg; break;
+      default: optind = argc; break;
+    }
+  }
+  if ( optind != argc - 1 )
+  {
+    fprintf( stderr, "usage: %s [-d] [-n queries] [-a seconds] [-w capture] <tty>|sim\n", argv[0] );
+    return( 2 );
+  }
+  if ( strcmp( argv[optind], "sim" ) == 0 )
+  {
+    sim.reset( micros() );
+    port = &simport;
+  }else if ( tty.open( argv[optind] ) )
+  {
+    port = &tty;
+  }else
+  {
+    perror( argv[optind] );
+    return( 1 );
+  }
+  if ( capturePath )
+  {
+    if ( ( out = fopen( capturePath, "wb" ) ) == NULL )
+    {
+      perror( capturePath );
+      return( 1 );
+    }
+    capture.begin( port, fileSink, out );
+    port = &capture;
+  }
+
+  sds.begin( port );
+  sds.setDebug( debug );
+
+  start = millis();
+  status = sds.sleepWorkModeCmd( &result, WORK_MODE, WRITE_MODE );
+  report( "sleepWorkModeCmd set", status, start, result );
+  start = millis();
+  status = sds.workPeriodCmd( &result, DONT_CARE, READ_MODE );
+  report( "workPeriodCmd read", status, start, result );
+  start = millis();
+  status = sds.dataReportingModeCmd( &result, QUERY_MODE, WRITE_MODE );
+  report( "dataReportingModeCmd", status, start, result );
+
+  for ( i = 0; i < queries; ++i )
+  {
+    start = millis();
+    status = sds.dataQueryCmd( &p10, &p25 );
+    printf( "%-22s %-5s %5lu ms  pm10 %.1f pm2.5 %.1f\n", "dataQueryCmd", status ? "ok" : "error", millis() - start, p10, p25 );
+  }
+  if ( seconds ) reports( &sds, port, seconds );
+#if SDS011_METRICS
+  metrics();
+#endif
+  if ( out )
+  {
+    capture.save();
+    fclose( out );
+    printf( "captured %u bytes to %s\n", capture.bytes(), capturePath );
+  }
+  return( 0 );
+}
@@ -0,0 +1,114 @@
+//! Host tool: concurrent sensor workflows written as coroutines
+
+/// @file sds011coro.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Runs the duty cycle of the sds-AskQuerying sketch (wake, let the fan spin
+/// up, query a few times, sleep) on several simulated sensors at once, each
+/// as one coroutine on a single thread (see sds011coro.h). Prints every
+/// step and compares the run time with doing the cycles one after the other:
+///
+///     ./build/sds011coro [-n sensors] [-c cycles] [-s spinup_ms] [-q queries]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sds011coro.h"
+#include "sds011sim.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+/// most simulated sensors
+#define CORO_SENSORS 8
+
+/// millis() when the run started
+static unsigned long start;
+/// steps that failed
+static int failures;
+
+/// one duty cycle after another on a sensor
+static sds011Task cycle( sds011CoSensor &sensor, int n, int cycles, unsigned long spinup, int queries )
+{
+  sds011SampleResult r;
+  int c, q;
+
+  for ( c = 0; c < cycles; ++c )
+  {
+    if ( ( co_await sensor.setPower( SDS011_POWER_WORK ) ).error != SDS011_OK ) ++failures;
+    if ( ( co_await sensor.setReportMode( SDS011_REPORT_QUERY ) ).error != SDS011_OK ) ++failures;
+    printf( "%6lu ms  sensor %d  cycle %d  awake, spinning up\n", millis() - start, n, c );
+    co_await sensor.sleepFor( spinup );
+    for ( q = 0; q < queries; ++q )
+    {
+      r = co_await sensor.query();
+      if ( r.error != SDS011_OK ) ++failures;
+      printf( "%6lu ms  sensor %d  cycle %d  pm2.5 %u.%u pm10 %u.%u\n", millis() - start, n, c, r.sample.pm25 / 10,
+              r.sample.pm25 % 10, r.sample.pm10 / 10, r.sample.pm10 % 10 );
+      co_await sensor.sleepFor( 1000 );
+    }
+    if ( ( co_await sensor.setPower( SDS011_POWER_SLEEP ) ).error != SDS011_OK ) ++failures;
+    printf( "%6lu ms  sensor %d  cycle %d  asleep\n", millis() - start, n, c );
+    // sleep as long as the sensor was awake
+    co_await sensor.sleepFor( spinup + queries * 1000 );
+  }
+}
+
+int main( int argc, char **argv )
+{
+  static sds011Simulator sims[CORO_SENSORS];
+  static sds011SimTransport *ports[CORO_SENSORS];
+  static sds011CoSensor sensors[CORO_SENSORS];
+  sds011Executor exec;
+  unsigned long spinup = 3000, elapsed, sequential;
+  int opt, n = 4, cycles = 2, queries = 3, i;
+  clock_t cpu;
+
+  while ( ( opt = getopt( argc, argv, "n:c:s:q:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'n': n = atoi( optarg ); break;
+      case 'c': cycles = atoi( optarg ); break;
+      case 's': spinup = strtoul( optarg, NULL, 10 ); break;
+      case 'q': queries = atoi( optarg ); break;
+      default:
+        fprintf( stderr, "usage: %s [-n sensors] [-c cycles] [-s spinup_ms] [-q queries]\n", argv[0] );
+        return( 2 );
+    }
+  }
+  if ( n < 1 ) n = 1;
+  if ( n > CORO_SENSORS ) n = CORO_SENSORS;
+
+  for ( i = 0; i < n; ++i )
+  {
+    sims[i].setId( (uint8_t)i, 0 );
+    sims[i].setPm( (uint16_t)( 100 + i ), (uint16_t)( 200 + i ) );
+    sims[i].reset( micros() );
+    ports[i] = new sds011SimTransport( &sims[i] );
+    sensors[i].begin( &exec, ports[i] );
+    exec.spawn( cycle( sensors[i], i, cycles, spinup, queries ) );
+  }
+  start = millis();
+  cpu = clock();
+  exec.run();
+  elapsed = millis() - start;
+  cpu = clock() - cpu;
+
+  sequential = (unsigned long)n * cycles * 2 * ( spinup + queries * 1000 );
+  printf( "%d sensors, %d cycles on one thread: %lu ms (one after the other: %lu ms), CPU %lu ms, %d failed steps\n", n,
+          cycles, elapsed, sequential, (unsigned long)( cpu * 1000 / CLOCKS_PER_SEC ), failures );
+  return( failures ? 1 : 0 );
+}
+
+#else
+
+int main(void)
+{
+  fprintf( stderr, "sds011coro needs a compiler with C++20 coroutines\n" );
+  return( 1 );
+}
+
+#endif
@@ -0,0 +1,210 @@
+//! Host tool: evaluates the adaptive duty cycle against simulated sensors
+
+/// @file sds011dutytool.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Without -r, replays a synthetic day of PM (slow drift plus a few
+/// pollution events decaying over tens of minutes) in virtual time and
+/// compares continuous sampling, the fixed 3 minute work period of the
+/// examples and sds011DutyPolicy by awake time, charge and the error of the
+/// last reading against the true value. With -r, runs sds011Duty for the
+/// given seconds in real time against the software sensor, with a step in
+/// PM half way:
+///
+///     ./build/sds011dutytool [-t tolerance] [-u spinup_ms]
+///     ./build/sds011dutytool -r seconds [-u spinup_ms]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "sds011duty.h"
+#include "sds011sim.h"
+
+/// length of the synthetic trace in seconds
+#define DAY 86400
+
+/// true PM2.5 and PM10 per second, 0.1 ug/m3
+static uint16_t truth25[DAY], truth10[DAY];
+
+/**************************************************************************/
+/*!
+    @brief  fills the synthetic trace
+    @returns void
+*/
+/**************************************************************************/
+static void makeTrace(void)
+{
+  double events[DAY] = { 0 };
+  double level = 0;
+  int t, e;
+
+  srand( 1 );
+  for ( e = 0; e < 6; ++e ) events[rand() % DAY] = 300 + rand() % 1200;
+  for ( t = 0; t < DAY; ++t )
+  {
+    // 20 minute decay of events on a slowly drifting background
+    level = level * exp( -1.0 / 1200 ) + events[t];
+    truth25[t] = (uint16_t)( 80 + 30 * sin( t * 2 * M_PI / DAY ) + level );
+    truth10[t] = (uint16_t)( truth25[t] * 16 / 10 + 20 );
+  }
+}
+
+/// outcome of one strategy over the trace
+struct outcome {
+  double awake;
+  double charge;
+  double error;
+  double miss;
+  unsigned samples;
+};
+
+/**************************************************************************/
+/*!
+    @brief  runs one strategy over the trace in virtual time
+    @param policy the adaptive policy, NULL for a fixed interval
+    @param fixed the fixed interval in ms
+    @param spinup fan spin-up in ms
+    @param tolerance error in 0.1 ug/m3 counted as a miss
+    @param out the outcome
+    @returns void
+*/
+/**************************************************************************/
+static void run( sds011DutyPolicy *policy, uint32_t fixed, uint32_t spinup, uint16_t tolerance, outcome *out )
+{
+  uint32_t t = spinup, next, interval, awake = spinup, s;
+  uint32_t sum = 0, misses = 0, err;
+  sds011Sample sample;
+  bool sleeps;
+
+  out->samples = 0;
+  sample.id = 0xa160;
+  while ( t < DAY * 1000UL )
+  {
+    // reading with the sensor's noise of a few tenths
+    sample.time = t;
+    sample.pm25 = (uint16_t)( truth25[t / 1000] + rand() % 5 - 2 );
+    sample.pm10 = (uint16_t)( truth10[t / 1000] + rand() % 5 - 2 );
+    ++out->samples;
+    if ( policy )
+    {
+      interval = policy->update( sample );
+      sleeps = policy->sleeps( spinup );
+    }else
+    {
+      interval = fixed;
+      sleeps = fixed >= spinup + SDS011_DUTY_MIN_SLEEP;
+    }
+    awake += sleeps ? spinup : interval;
+    next = t + interval;
+    for ( s = t / 1000; s < next / 1000 && s < DAY; ++s )
+    {
+      err = abs( (int)sample.pm25 - (int)truth25[s] );
+      sum += err;
+      if ( err > tolerance && err * 10 > truth25[s] ) ++misses;
+    }
+    t = next;
+  }
+  out->awake = awake / 3600000.0;
+  out->charge = ( awake * (double)SDS011_DUTY_AWAKE_MA + ( DAY * 1000.0 - awake ) * SDS011_DUTY_SLEEP_MA ) / 3600000.0;
+  out->error = sum / (double)DAY / 10;
+  out->miss = 100.0 * misses / DAY;
+}
+
+/**************************************************************************/
+/*!
+    @brief  prints one row of the comparison
+    @param name the strategy
+    @param o its outcome
+    @returns void
+*/
+/**************************************************************************/
+static void print( const char *name, const outcome &o )
+{
+  printf( "%-12s %8u %9.2f %10.1f %9.2f %9.2f\n", name, o.samples, o.awake, o.charge, o.error, o.miss );
+}
+
+/**************************************************************************/
+/*!
+    @brief  runs sds011Duty in real time against the software sensor
+    @param seconds run time
+    @param spinup fan spin-up in ms
+    @returns process exit code
+*/
+/**************************************************************************/
+static int live( unsigned long seconds, uint32_t spinup )
+{
+  sds011Simulator sim;
+  sds011SimTransport port( &sim );
+  sds011 sensor;
+  sds011Duty duty;
+  sds011DutyReport r;
+  sds011Sample s;
+  unsigned long start;
+  bool stepped = false;
+
+  sim.reset( micros() );
+  sim.setPm( 100, 180 );
+  sensor.begin( &port );
+  if ( !duty.begin( &sensor, spinup ) ) fprintf( stderr, "sensor configuration failed\n" );
+  // short intervals, so the adaptation shows within a minute or two
+  duty.policy().begin( 1000, 60000 );
+  start = millis();
+  while ( millis() - start < seconds * 1000 )
+  {
+    if ( !stepped && millis() - start >= seconds * 500 )
+    {
+      sim.setPm( 600, 980 );
+      stepped = true;
+    }
+    if ( duty.poll( &s ) )
+    {
+      printf( "%7.1f s  pm2.5 %3u.%u  pm10 %3u.%u  next in %lu ms%s\n", ( s.time - start ) / 1000.0, s.pm25 / 10, s.pm25 % 10,
+              s.pm10 / 10, s.pm10 % 10, (unsigned long)duty.policy().interval(), duty.sleeping() ? ", sleeping" : "" );
+    }
+    delay( 20 );
+  }
+  duty.report( &r );
+  printf( "awake %u s, asleep %u s, %u samples, %u wakes, %u errors, %u uAh\n", r.awake, r.asleep, r.samples, r.wakes,
+          r.errors, r.charge );
+  return( r.errors ? 1 : 0 );
+}
+
+int main( int argc, char **argv )
+{
+  unsigned long seconds = 0;
+  uint32_t spinup = SDS011_DUTY_SPINUP;
+  uint16_t tolerance = 20;
+  sds011DutyPolicy policy;
+  outcome o;
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "r:t:u:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'r': seconds = strtoul( optarg, NULL, 10 ); break;
+      case 't': tolerance = (uint16_t)strtoul( optarg, NULL, 10 ); break;
+      case 'u': spinup = strtoul( optarg, NULL, 10 ); break;
+      default:
+        fprintf( stderr, "usage: %s [-t tolerance] [-u spinup_ms]\n       %s -r seconds [-u spinup_ms]\n", argv[0], argv[0] );
+        return( 2 );
+    }
+  }
+  if ( seconds ) return( live( seconds, spinup ? spinup : 1 ) );
+
+  makeTrace();
+  printf( "one day, spin-up %lu ms, miss = error above %u.%u ug/m3 and 10%%\n", (unsigned long)spinup, tolerance / 10,
+          tolerance % 10 );
+  printf( "%-12s %8s %9s %10s %9s %9s\n", "strategy", "samples", "awake_h", "charge_mAh", "mae_ug", "miss_pct" );
+  run( NULL, 1000, spinup, tolerance, &o );
+  print( "continuous", o );
+  run( NULL, 180000, spinup, tolerance, &o );
+  print( "fixed_3min", o );
+  policy.begin( 5000, 600000, tolerance, 10 );
+  run( &policy, 0, spinup, tolerance, &o );
+  print( "adaptive", o );
+  return( 0 );
+}
@@ -0,0 +1,356 @@
+//! Host tool: parser fault injection and fuzzing
+
+/// @file sds011fuzz.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Checks and measures how the reply parser recovers from line noise,
+/// corrupted and lost bytes, duplicated headers, wrong ids, bad check-sums
+/// and frames cut short. The default run injects each fault many times
+/// between valid frames and prints, one JSON object per line, how many
+/// bytes and how much parse and wire time (at 9600 baud) pass from the start
+/// of the fault to the next valid frame, and whether a valid frame was lost
+/// or a false one reported. -e runs commands through sds011 against the
+/// faulty software sensor, -f checks the fuzz properties on random streams.
+///
+///     ./build/sds011fuzz [-t trials] [-e commands] [-f streams] [file...]
+///
+/// Files are run through the fuzz entry point, e.g. a crash from the
+/// coverage guided build (clang, libFuzzer):
+///
+///     make -C extras/host fuzz && ./build/sds011fuzz-libfuzzer corpus/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sds011lib.h"
+#include "sds011frame.h"
+#include "sds011log.h"
+#include "sds011sim.h"
+
+/**************************************************************************/
+/*!
+    @brief  fuzz entry: every input must leave the parser, the decoders,
+    the simulator and the log reader consistent
+    @param data the input
+    @param size its length
+    @returns 0
+*/
+/**************************************************************************/
+extern "C" int LLVMFuzzerTestOneInput( const uint8_t *data, size_t size )
+{
+  static const uint8_t valid[SDS011_REPLY_LEN] = { MSG_HEAD, REPLY_DATA, 0x7b, 0x00, 0xc8, 0x01, 0xa1, 0x60, 0x45, MSG_TAIL };
+  sds011Parser parser;
+  sds011Simulator sim;
+  sds011LogReader log;
+  sds011Sample sample;
+  const uint8_t *frame;
+  bool found = false;
+  size_t i;
+
+  for ( i = 0; i < size; ++i )
+  {
+    if ( !parser.push( data[i] ) ) continue;
+    frame = parser.frame();
+    // nothing but valid replies is reported
+    if ( !sds011ReplyValid( frame ) || ( frame[1] == REPLY_DATA ) == ( frame[1] == REPLY_CFG ) ) abort();
+    if ( frame[1] == REPLY_DATA && sds011ReplyPm25( frame ) != ( frame[2] | frame[3] << 8 ) ) abort();
+  }
+  // nine bytes that can neither start nor end a frame settle any partial frame
+  for ( i = 0; i < SDS011_REPLY_LEN - 1; ++i ) parser.push( 0 );
+  if ( parser.pending() != 0 ) abort();
+  // and a valid frame after any garbage is found
+  for ( i = 0; i < SDS011_REPLY_LEN; ++i ) found = parser.push( valid[i] );
+  if ( !found || memcmp( parser.frame(), valid, SDS011_REPLY_LEN ) != 0 ) abort();
+
+  // the simulator parses command frames from the same bytes
+  sim.receive( data, size, 0 );
+  while ( sim.ready( 1000000 ) > 0 ) sim.read( 1000000 );
+
+  // and the log reader must survive any block contents
+  log.begin( data, size );
+  while ( log.next( &sample ) ) {}
+  log.begin( data, size );
+  log.seek( size > 4 ? data[0] | data[1] << 8 : 0 );
+  return( 0 );
+}
+
+#ifndef SDS011_LIBFUZZER
+
+/// the injected faults
+enum fault { NOISE, CORRUPT, DROP, HEADER, COMMAND, CHECKSUM, TRUNCATE, FAULTS };
+
+/// fault names for the results
+static const char *faultNames[FAULTS] = { "noise", "corrupt", "drop", "header", "command", "checksum", "truncate" };
+
+/**************************************************************************/
+/*!
+    @brief  monotonic time in nanoseconds
+    @returns the time
+*/
+/**************************************************************************/
+static uint64_t nanos(void)
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return( ts.tv_sec * 1000000000ULL + ts.tv_nsec );
+}
+
+/**************************************************************************/
+/*!
+    @brief  writes a valid data reply
+    @param out destination
+    @param seq sequence number, stored in the PM2.5 value
+    @returns number of bytes written
+*/
+/**************************************************************************/
+static size_t reply( uint8_t *out, uint16_t seq )
+{
+  uint8_t k;
+
+  out[0] = MSG_HEAD;
+  out[1] = REPLY_DATA;
+  out[2] = (uint8_t)seq;
+  out[3] = (uint8_t)( seq >> 8 );
+  out[4] = (uint8_t)rand();
+  out[5] = (uint8_t)rand();
+  out[6] = 0xa1;
+  out[7] = 0x60;
+  out[8] = 0;
+  for ( k = 2; k < 8; ++k ) out[8] += out[k];
+  out[9] = MSG_TAIL;
+  return( SDS011_REPLY_LEN );
+}
+
+/**************************************************************************/
+/*!
+    @brief  writes the bytes of one fault
+    @param out destination
+    @param f the fault
+    @param seq sequence number of a damaged frame
+    @returns number of bytes written
+*/
+/**************************************************************************/
+static size_t inject( uint8_t *out, fault f, uint16_t seq )
+{
+  size_t n, i;
+
+  if ( f == NOISE )
+  {
+    for ( n = 1 + rand() % 16, i = 0; i < n; ++i ) out[i] = rand() % 4 ? (uint8_t)rand() : MSG_HEAD;
+    return( n );
+  }
+  if ( f == HEADER )
+  {
+    out[0] = MSG_HEAD;
+    return( 1 );
+  }
+  n = reply( out, seq );
+  switch ( f )
+  {
+    case CORRUPT: out[rand() % n] ^= (uint8_t)( 1 + rand() % 255 ); break;
+    case DROP:
+      i = rand() % n;
+      memmove( out + i, out + i + 1, n - i - 1 );
+      --n;
+      break;
+    case COMMAND: out[1] ^= (uint8_t)( 1 + rand() % 255 ); break;
+    case CHECKSUM: out[8] ^= (uint8_t)( 1 + rand() % 255 ); break;
+    case TRUNCATE: n = 1 + rand() % ( n - 1 ); break;
+    default: break;
+  }
+  return( n );
+}
+
+/**************************************************************************/
+/*!
+    @brief  injects one fault many times and prints the recovery
+    @param f the fault
+    @param trials number of injections
+    @returns false when a valid frame was lost other than to a false frame;
+    a damaged frame passing the 8 bit check-sum by chance is a limit of the
+    protocol, not of the parser
+*/
+/**************************************************************************/
+static bool recovery( fault f, unsigned long trials )
+{
+  uint8_t buf[64];
+  sds011Parser parser;
+  unsigned long t, lost = 0, spurious = 0, extra = 0, extraMax = 0, bytes = 0, bytesMax = 0;
+  uint64_t ns = 0, t0;
+  size_t len, flen, i, at;
+  uint16_t seq = 0;
+
+  for ( t = 0; t < trials; ++t )
+  {
+    // fault, then two valid frames; the first valid one must be the next reported
+    // 0xffff marks the damaged frame, the valid ones count below it
+    seq = ( seq + 2 ) % 0xfffe;
+    flen = inject( buf, f, 0xffff );
+    len = flen + reply( buf + flen, seq );
+    len += reply( buf + len, seq + 1 );
+    at = 0;
+    t0 = nanos();
+    for ( i = 0; i < len && at == 0; ++i )
+    {
+      if ( parser.push( buf[i] ) ) at = i + 1;
+    }
+    ns += nanos() - t0;
+    if ( at == 0 || sds011ReplyPm25( parser.frame() ) == 0xffff )
+    {
+      // a damaged frame that still checks, e.g. a corrupted id byte
+      ++spurious;
+      for ( at = 0; i < len && at == 0; ++i )
+      {
+        if ( parser.push( buf[i] ) ) at = i + 1;
+      }
+    }
+    if ( at == 0 || sds011ReplyPm25( parser.frame() ) != seq )
+    {
+      ++lost;
+    }else
+    {
+      bytes += at;
+      if ( at > bytesMax ) bytesMax = at;
+      // bytes beyond the fault and the frame itself
+      extra += at - flen - SDS011_REPLY_LEN;
+      if ( at - flen - SDS011_REPLY_LEN > extraMax ) extraMax = at - flen - SDS011_REPLY_LEN;
+    }
+    // drain the second frame so every trial starts in sync
+    for ( ; i < len; ++i ) parser.push( buf[i] );
+    parser.reset();
+  }
+  printf( "{\"bench\":\"recovery\",\"case\":\"%s\",\"trials\":%lu,\"lost\":%lu,\"spurious\":%lu,"
+          "\"bytes_mean\":%.2f,\"bytes_max\":%lu,\"extra_mean\":%.3f,\"extra_max\":%lu,"
+          "\"parse_ns_mean\":%.1f,\"wire_ms_mean\":%.2f,\"wire_ms_max\":%.2f}\n",
+          faultNames[f], trials, lost, spurious, (double)bytes / ( trials - lost ), bytesMax,
+          (double)extra / ( trials - lost ), extraMax, (double)ns / trials,
+          bytes * 10000.0 / 9600 / ( trials - lost ), bytesMax * 10000.0 / 9600 );
+  fflush( stdout );
+  return( lost <= spurious );
+}
+
+/**************************************************************************/
+/*!
+    @brief  runs commands through sds011 against the faulty software sensor
+    @param n number of queries and of work period reads
+    @returns void
+*/
+/**************************************************************************/
+static void endToEnd( int n )
+{
+  sds011Simulator sim( 9600 );
+  sds011SimTransport port( &sim );
+  sds011SimFaults faults;
+  sds011Sample sample;
+  sds011 sds;
+  unsigned long t0, sum = 0, max = 0, us;
+  uint8_t value;
+  int i, ok = 0;
+
+  sim.reset( micros() );
+  sds.begin( &port );
+  sds.dataReportingModeCmd( &value, QUERY_MODE, WRITE_MODE );
+  // one reply in three is damaged
+  faults.noise = 100;
+  faults.corrupt = 50;
+  faults.drop = 50;
+  faults.header = 50;
+  faults.command = 30;
+  faults.checksum = 30;
+  faults.truncate = 30;
+  faults.interleave = 100;
+  sim.setFaults( faults );
+  for ( i = 0; i < 2 * n; ++i )
+  {
+    t0 = micros();
+    if ( i % 2 ? sds.workPeriodCmd( &value, DONT_CARE, READ_MODE ) : sds.dataQueryRaw( &sample ) ) ++ok;
+    us = micros() - t0;
+    sum += us;
+    if ( us > max ) max = us;
+  }
+  printf( "{\"bench\":\"faulty_sensor\",\"case\":\"query_and_period\",\"commands\":%d,\"ok\":%d,\"faults\":%u,"
+          "\"mean_us\":%lu,\"max_us\":%lu}\n", 2 * n, ok, sim.faults(), sum / ( 2 * n ), max );
+}
+
+/**************************************************************************/
+/*!
+    @brief  runs random and mutated reply streams through the fuzz entry
+    @param n number of streams
+    @returns void
+*/
+/**************************************************************************/
+static void randomStreams( unsigned long n )
+{
+  uint8_t buf[512];
+  unsigned long s;
+  size_t len, k;
+
+  for ( s = 0; s < n; ++s )
+  {
+    for ( len = 0; len + 40 < sizeof( buf ); )
+    {
+      k = rand() % 3;
+      if ( k == 0 )
+      {
+        len += reply( buf + len, (uint16_t)rand() );
+      }else
+      {
+        len += inject( buf + len, (fault)( rand() % FAULTS ), (uint16_t)rand() );
+      }
+    }
+    LLVMFuzzerTestOneInput( buf, len );
+  }
+  printf( "{\"bench\":\"fuzz\",\"case\":\"random_streams\",\"streams\":%lu,\"failed\":0}\n", n );
+}
+
+int main( int argc, char **argv )
+{
+  unsigned long trials = 100000, streams = 0;
+  uint8_t buf[65536];
+  bool ok = true;
+  int opt, e = 0, f;
+  size_t len;
+  FILE *in;
+
+  while ( ( opt = getopt( argc, argv, "t:e:f:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 't': trials = strtoul( optarg, NULL, 10 ); break;
+      case 'e': e = atoi( optarg ); break;
+      case 'f': streams = strtoul( optarg, NULL, 10 ); break;
+      default:
+        fprintf( stderr, "usage: %s [-t trials] [-e commands] [-f streams] [file...]\n", argv[0] );
+        return( 2 );
+    }
+  }
+  if ( optind < argc )
+  {
+    for ( ; optind < argc; ++optind )
+    {
+      in = fopen( argv[optind], "rb" );
+      if ( in == NULL )
+      {
+        perror( argv[optind] );
+        return( 1 );
+      }
+      len = fread( buf, 1, sizeof( buf ), in );
+      fclose( in );
+      LLVMFuzzerTestOneInput( buf, len );
+    }
+    return( 0 );
+  }
+
+  srand( 1 );
+  if ( trials ) for ( f = 0; f < FAULTS; ++f ) ok = recovery( (fault)f, trials ) && ok;
+  if ( streams ) randomStreams( streams );
+  if ( e > 0 ) endToEnd( e );
+  return( ok ? 0 : 1 );
+}
+
+#endif
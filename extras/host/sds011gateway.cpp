@@ -0,0 +1,433 @@
+//! Host tool: gateway serving many serial-attached sensors
+
+/// @file sds011gateway.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Serves any number of sensors on ttys (USB-serial adapters) from one
+/// process. The ports are spread over a few worker threads; each worker
+/// waits on its ports with epoll and runs one non-blocking sds011Async
+/// engine per port, so a thread only wakes for received bytes, a reply
+/// deadline or a query that is due. Samples go through a lock-free ring per
+/// worker to the main thread, which publishes them as JSON lines on stdout.
+/// With -s the gateway first creates that many simulated sensors on ptys
+/// and serves those, for tests and load measurements:
+///
+///     ./build/sds011gateway [-t threads] [-i interval_ms] [-a] [-q] [-d seconds] <tty>...
+///     ./build/sds011gateway [-t threads] [-i interval_ms] [-a] [-q] [-d seconds] -s count
+///
+/// -a uses auto report mode instead of queries, -q prints only the summary.
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sds011async.h"
+#include "sds011frame.h"
+#include "sds011ring.h"
+#include "sds011sim.h"
+
+/// most worker threads
+#define GATEWAY_THREADS 16
+/// samples a worker can hand to the main thread between two drains
+#define GATEWAY_RING 1024
+/// longest sleep of a worker, bounds the reaction to the stop flag
+#define GATEWAY_IDLE 100
+/// poll period of a worker while a command waits for its reply, in ms
+#define GATEWAY_BUSY 5
+
+struct gatewayWorker;
+
+/// one serial port and the sensor on it
+struct gatewayPort {
+	/// device path
+	char path[64];
+	/// the tty
+	sds011PosixTransport tty;
+	/// command engine of the port
+	sds011Async engine;
+	/// result slot of the query in flight
+	sds011AsyncResult result;
+	/// the worker serving the port
+	gatewayWorker *worker;
+	/// index in the port table
+	uint16_t index;
+	/// millis() of the last query
+	unsigned long last;
+	/// samples published
+	uint32_t samples;
+	/// queries without a valid reply
+	uint32_t failures;
+};
+
+/// a sample on its way to the main thread
+struct gatewaySample {
+	/// index of the port
+	uint16_t port;
+	/// the sample
+	sds011Sample sample;
+};
+
+/// a thread and the ports it serves
+struct gatewayWorker {
+	/// the thread
+	pthread_t thread;
+	/// epoll instance of the ports
+	int epfd;
+	/// first port of the worker in the port table
+	gatewayPort *ports;
+	/// number of ports
+	uint16_t count;
+	/// samples for the main thread
+	sds011Ring<gatewaySample, GATEWAY_RING> ring;
+	/// CPU time of the thread in ns, written when the thread ends
+	uint64_t cpu;
+	/// epoll wake-ups
+	uint32_t wakeups;
+};
+
+/// query interval in ms
+static unsigned long interval = 1000;
+/// true for auto report mode
+static bool autoReport = false;
+/// cleared to stop the workers
+static volatile bool running = true;
+
+/// stops the gateway on SIGINT / SIGTERM
+static void onSignal( int )
+{
+  running = false;
+}
+
+/// CPU time of the calling thread in ns
+static uint64_t threadCpu(void)
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+  return( (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec );
+}
+
+/// hands a data frame of a port to the main thread
+static void publish( gatewayPort *port, const uint8_t *frame )
+{
+  gatewaySample s;
+
+  s.port = port->index;
+  s.sample.time = (uint32_t)millis();
+  s.sample.id = sds011ReplyId( frame );
+  s.sample.pm25 = sds011ReplyPm25( frame );
+  s.sample.pm10 = sds011ReplyPm10( frame );
+  if ( port->worker->ring.push( s ) ) ++port->samples;
+}
+
+/// completion of a query
+static void onQuery( const sds011AsyncResult *result, void *ctx )
+{
+  gatewayPort *port = (gatewayPort *)ctx;
+
+  if ( result->status ) publish( port, result->reply ); else ++port->failures;
+}
+
+/// an auto report
+static void onReport( const sds011AsyncResult *result, void *ctx )
+{
+  publish( (gatewayPort *)ctx, result->reply );
+}
+
+/**************************************************************************/
+/*!
+    @brief  worker thread: waits for bytes on its ports, runs the engines
+    and schedules the queries
+    @param arg the gatewayWorker
+    @returns NULL
+*/
+/**************************************************************************/
+static void *work( void *arg )
+{
+  gatewayWorker *w = (gatewayWorker *)arg;
+  struct epoll_event events[64];
+  gatewayPort *p;
+  unsigned long now, due;
+  int n, i, timeout = 0;
+  bool busy;
+
+  while ( running )
+  {
+    n = epoll_wait( w->epfd, events, 64, timeout );
+    ++w->wakeups;
+    for ( i = 0; i < n; ++i ) ( (gatewayPort *)events[i].data.ptr )->engine.poll();
+
+    // deadlines and due queries; only ports with a command in flight are polled again
+    now = millis();
+    busy = false;
+    timeout = GATEWAY_IDLE;
+    for ( p = w->ports; p < w->ports + w->count; ++p )
+    {
+      if ( p->engine.queued() ) p->engine.poll();
+      if ( !autoReport && !p->engine.queued() )
+      {
+        due = p->last + interval;
+        if ( (long)( now - due ) >= 0 )
+        {
+          p->last = now;
+          p->engine.dataQuery( &p->result, onQuery, p );
+          p->engine.poll();
+        }else if ( (long)( due - now ) < timeout )
+        {
+          timeout = (int)( due - now );
+        }
+      }
+      busy = busy || p->engine.queued();
+    }
+    if ( busy && timeout > GATEWAY_BUSY ) timeout = GATEWAY_BUSY;
+  }
+  w->cpu = threadCpu();
+  return( NULL );
+}
+
+/**************************************************************************/
+/*!
+    @brief  opens a port, registers it with its worker and queues the setup
+    commands: wake up, reporting mode
+    @param p the port, path and worker set
+    @returns false when the tty cannot be opened
+*/
+/**************************************************************************/
+static bool openPort( gatewayPort *p )
+{
+  struct epoll_event ev;
+
+  if ( !p->tty.open( p->path ) ) return( false );
+  ev.events = EPOLLIN;
+  ev.data.ptr = p;
+  if ( epoll_ctl( p->worker->epfd, EPOLL_CTL_ADD, p->tty.fd(), &ev ) != 0 ) return( false );
+  p->engine.begin( &p->tty );
+  p->engine.onData( onReport, p );
+  p->engine.sleepWorkMode( WORK_MODE, WRITE_MODE );
+  p->engine.dataReportingMode( autoReport ? AUTO_REPORT_MODE : QUERY_MODE, WRITE_MODE );
+  // spread the first queries over the interval
+  p->last = millis() - interval + ( p->index * 37 ) % interval;
+  return( true );
+}
+
+/// the simulated sensors of -s
+struct gatewaySims {
+	/// number of sensors
+	int count;
+	/// the sensors
+	sds011Simulator *sims;
+	/// pty master of each sensor
+	int *masters;
+	/// epoll instance of the masters
+	int epfd;
+	/// the thread
+	pthread_t thread;
+};
+
+/**************************************************************************/
+/*!
+    @brief  simulator thread: feeds the commands written to the ptys into
+    the sensors and writes their replies and reports out at the simulated
+    bit rate, as sds011simpty does for one sensor
+    @param arg the gatewaySims
+    @returns NULL
+*/
+/**************************************************************************/
+static void *simulate( void *arg )
+{
+  gatewaySims *s = (gatewaySims *)arg;
+  struct epoll_event events[64];
+  uint8_t buf[64];
+  uint32_t t;
+  int i, n, k, len;
+
+  while ( running )
+  {
+    n = epoll_wait( s->epfd, events, 64, 1 );
+    for ( i = 0; i < n; ++i )
+    {
+      k = events[i].data.u32;
+      while ( ( len = read( s->masters[k], buf, sizeof( buf ) ) ) > 0 ) s->sims[k].receive( buf, len, (uint32_t)micros() );
+    }
+    t = (uint32_t)micros();
+    for ( k = 0; k < s->count; ++k )
+    {
+      for ( len = 0; len < (int)sizeof( buf ) && s->sims[k].ready( t ) > 0; ++len ) buf[len] = s->sims[k].read( t );
+      if ( len > 0 && write( s->masters[k], buf, len ) != len ) perror( "write" );
+    }
+  }
+  return( NULL );
+}
+
+/**************************************************************************/
+/*!
+    @brief  creates the simulated sensors on ptys and starts their thread
+    @param s the simulators
+    @param count number of sensors
+    @param ports receives the slave paths
+    @returns false when a pty cannot be created
+*/
+/**************************************************************************/
+static bool startSims( gatewaySims *s, int count, gatewayPort *ports )
+{
+  struct epoll_event ev;
+  struct termios tio;
+  int k, slave;
+
+  s->count = count;
+  s->sims = new sds011Simulator[count];
+  s->masters = (int *)malloc( count * sizeof( int ) );
+  s->epfd = epoll_create1( EPOLL_CLOEXEC );
+  for ( k = 0; k < count; ++k )
+  {
+    s->masters[k] = posix_openpt( O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC );
+    if ( s->masters[k] < 0 || grantpt( s->masters[k] ) != 0 || unlockpt( s->masters[k] ) != 0 )
+    {
+      perror( "posix_openpt" );
+      return( false );
+    }
+    // raw before the gateway opens it, so nothing is echoed back
+    slave = open( ptsname( s->masters[k] ), O_RDWR | O_NOCTTY );
+    if ( slave >= 0 && tcgetattr( slave, &tio ) == 0 )
+    {
+      cfmakeraw( &tio );
+      tcsetattr( slave, TCSANOW, &tio );
+    }
+    if ( slave >= 0 ) close( slave );
+    snprintf( ports[k].path, sizeof( ports[k].path ), "%s", ptsname( s->masters[k] ) );
+    s->sims[k].setId( (uint8_t)k, (uint8_t)( k >> 8 ) );
+    s->sims[k].setPm( (uint16_t)( 100 + k ), (uint16_t)( 200 + k ) );
+    s->sims[k].reset( micros() );
+    ev.events = EPOLLIN;
+    ev.data.u32 = k;
+    epoll_ctl( s->epfd, EPOLL_CTL_ADD, s->masters[k], &ev );
+  }
+  return( pthread_create( &s->thread, NULL, simulate, s ) == 0 );
+}
+
+/// prints the samples waiting in the rings, returns their number
+static uint32_t drain( gatewayWorker *workers, int threads, gatewayPort *ports, bool quiet )
+{
+  gatewaySample batch[64];
+  uint32_t total = 0;
+  uint16_t n, i;
+  int w;
+
+  for ( w = 0; w < threads; ++w )
+  {
+    while ( ( n = workers[w].ring.pop( batch, 64 ) ) > 0 )
+    {
+      total += n;
+      for ( i = 0; !quiet && i < n; ++i )
+      {
+        printf( "{\"port\":\"%s\",\"id\":\"%04X\",\"time\":%u,\"pm25\":%u.%u,\"pm10\":%u.%u}\n", ports[batch[i].port].path,
+                batch[i].sample.id, batch[i].sample.time, batch[i].sample.pm25 / 10, batch[i].sample.pm25 % 10,
+                batch[i].sample.pm10 / 10, batch[i].sample.pm10 % 10 );
+      }
+    }
+  }
+  if ( !quiet ) fflush( stdout );
+  return( total );
+}
+
+int main( int argc, char **argv )
+{
+  gatewayWorker workers[GATEWAY_THREADS];
+  gatewayPort *ports;
+  gatewaySims sims;
+  unsigned long seconds = 0, start;
+  uint64_t cpu = 0, published = 0, failures = 0, overruns = 0, wakeups = 0;
+  int opt, threads = 4, count, simulated = 0, i, w;
+  bool quiet = false;
+
+  while ( ( opt = getopt( argc, argv, "t:i:aqd:s:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 't': threads = atoi( optarg ); break;
+      case 'i': interval = strtoul( optarg, NULL, 10 ); break;
+      case 'a': autoReport = true; break;
+      case 'q': quiet = true; break;
+      case 'd': seconds = strtoul( optarg, NULL, 10 ); break;
+      case 's': simulated = atoi( optarg ); break;
+      default: optind = argc + 1; break;
+    }
+  }
+  count = simulated ? simulated : argc - optind;
+  if ( optind > argc || count < 1 || ( simulated && optind != argc ) )
+  {
+    fprintf( stderr, "usage: %s [-t threads] [-i interval_ms] [-a] [-q] [-d seconds] <tty>...\n"
+                     "       %s [-t threads] [-i interval_ms] [-a] [-q] [-d seconds] -s count\n", argv[0], argv[0] );
+    return( 2 );
+  }
+  if ( threads < 1 ) threads = 1;
+  if ( threads > GATEWAY_THREADS ) threads = GATEWAY_THREADS;
+  if ( threads > count ) threads = count;
+  if ( interval < 10 ) interval = 10;
+  signal( SIGINT, onSignal );
+  signal( SIGTERM, onSignal );
+
+  ports = new gatewayPort[count];
+  for ( i = 0; i < count; ++i )
+  {
+    ports[i].index = (uint16_t)i;
+    ports[i].samples = 0;
+    ports[i].failures = 0;
+    if ( !simulated ) snprintf( ports[i].path, sizeof( ports[i].path ), "%s", argv[optind + i] );
+  }
+  if ( simulated && !startSims( &sims, simulated, ports ) ) return( 1 );
+
+  // contiguous blocks of ports per worker
+  for ( w = 0, i = 0; w < threads; ++w )
+  {
+    workers[w].epfd = epoll_create1( EPOLL_CLOEXEC );
+    workers[w].ports = ports + i;
+    workers[w].count = (uint16_t)( count / threads + ( w < count % threads ) );
+    workers[w].cpu = 0;
+    workers[w].wakeups = 0;
+    for ( ; i < workers[w].ports - ports + workers[w].count; ++i )
+    {
+      ports[i].worker = &workers[w];
+      if ( !openPort( &ports[i] ) )
+      {
+        perror( ports[i].path );
+        return( 1 );
+      }
+    }
+  }
+  for ( w = 0; w < threads; ++w ) pthread_create( &workers[w].thread, NULL, work, &workers[w] );
+
+  start = millis();
+  while ( running && ( seconds == 0 || millis() - start < seconds * 1000 ) )
+  {
+    usleep( GATEWAY_IDLE * 1000 );
+    published += drain( workers, threads, ports, quiet );
+  }
+  running = false;
+  for ( w = 0; w < threads; ++w )
+  {
+    pthread_join( workers[w].thread, NULL );
+    cpu += workers[w].cpu;
+    wakeups += workers[w].wakeups;
+    overruns += workers[w].ring.overruns();
+  }
+  published += drain( workers, threads, ports, quiet );
+  if ( simulated ) pthread_join( sims.thread, NULL );
+  for ( i = 0; i < count; ++i ) failures += ports[i].failures;
+
+  start = millis() - start;
+  fprintf( stderr, "gateway: %d ports, %d threads, %s, %lu s: %llu samples (%.1f/s), %llu failed queries, %llu ring overruns\n",
+           count, threads, autoReport ? "auto reports" : "queries", start / 1000, (unsigned long long)published,
+           published * 1000.0 / start, (unsigned long long)failures, (unsigned long long)overruns );
+  fprintf( stderr, "gateway: worker CPU %.1f%% of one core (%.1f us per sample), %.0f wake-ups/s\n", cpu / 1e4 / start,
+           published ? cpu / 1e3 / published : 0.0, wakeups * 1000.0 / start );
+  return( failures || overruns ? 1 : 0 );
+}
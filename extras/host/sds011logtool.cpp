@@ -0,0 +1,140 @@
+//! Host tool: writes and reads binary sample logs
+
+/// @file sds011logtool.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Writes a synthetic 1 Hz log or decodes an existing one through a memory
+/// mapping, and reports size and decode rate:
+///
+///     ./build/sds011logtool -w count <file>
+///     ./build/sds011logtool [-p] [-s time] <file>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sds011log.h"
+
+/**************************************************************************/
+/*!
+    @brief  log sink writing to a stdio file
+    @param buf the block
+    @param len its length
+    @param ctx the FILE
+    @returns bytes written
+*/
+/**************************************************************************/
+static size_t fileSink( const uint8_t *buf, size_t len, void *ctx )
+{
+  return( fwrite( buf, 1, len, (FILE *)ctx ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  monotonic time in seconds
+    @returns the time
+*/
+/**************************************************************************/
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return( ts.tv_sec + ts.tv_nsec * 1e-9 );
+}
+
+int main( int argc, char **argv )
+{
+  unsigned long count = 0, n, total = 0;
+  unsigned long start = 0;
+  bool print = false, seek = false;
+  sds011Sample batch[256];
+  sds011LogWriter writer;
+  sds011LogReader reader;
+  sds011LogFile file;
+  sds011Sample s;
+  double t0, t;
+  FILE *out;
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "w:ps:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'w': count = strtoul( optarg, NULL, 10 ); break;
+      case 'p': print = true; break;
+      case 's': start = strtoul( optarg, NULL, 10 ); seek = true; break;
+      default: optind = argc; break;
+    }
+  }
+  if ( optind != argc - 1 )
+  {
+    fprintf( stderr, "usage: %s -w count <file>\n       %s [-p] [-s time] <file>\n", argv[0], argv[0] );
+    return( 2 );
+  }
+
+  if ( count )
+  {
+    out = fopen( argv[optind], "wb" );
+    if ( out == NULL )
+    {
+      perror( argv[optind] );
+      return( 1 );
+    }
+    writer.begin( fileSink, out );
+    srand( 1 );
+    s.time = 1000;
+    s.id = 0x60a1;
+    s.pm25 = 123;
+    s.pm10 = 456;
+    t0 = now();
+    for ( n = 0; n < count; ++n )
+    {
+      // a 1 Hz stream with a little jitter and slowly wandering values
+      s.time += 1000 + rand() % 5;
+      s.pm25 = (uint16_t)( s.pm25 + rand() % 7 - 3 + ( s.pm25 < 20 ? 3 : 0 ) );
+      s.pm10 = (uint16_t)( s.pm10 + rand() % 9 - 4 + ( s.pm10 < 40 ? 4 : 0 ) );
+      if ( !writer.append( s ) ) break;
+    }
+    writer.flush();
+    t = now() - t0;
+    if ( fclose( out ) != 0 || writer.records() != count )
+    {
+      perror( argv[optind] );
+      return( 1 );
+    }
+    printf( "wrote %lu records in %u blocks, %.2f bytes/record, %.1f M records/s\n", count, writer.blocks(),
+            (double)writer.blocks() * SDS011_LOG_BLOCK / count, count / t / 1e6 );
+    return( 0 );
+  }
+
+  if ( !file.open( argv[optind] ) )
+  {
+    perror( argv[optind] );
+    return( 1 );
+  }
+  reader.begin( file.data(), file.length() );
+  if ( seek && !reader.seek( start ) )
+  {
+    printf( "no record at or after %lu\n", start );
+    return( 0 );
+  }
+  t0 = now();
+  while ( ( n = reader.read( batch, sizeof( batch ) / sizeof( batch[0] ) ) ) > 0 )
+  {
+    if ( print )
+    {
+      for ( unsigned long i = 0; i < n; ++i )
+      {
+        printf( "%u %04x %u %u\n", batch[i].time, batch[i].id, batch[i].pm25, batch[i].pm10 );
+      }
+    }
+    total += n;
+  }
+  t = now() - t0;
+  fprintf( print ? stderr : stdout, "read %lu records from %u blocks (%u corrupt), %.1f M records/s\n",
+           total, reader.blocks(), reader.corrupt(), total / t / 1e6 );
+  return( 0 );
+}
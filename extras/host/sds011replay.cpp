@@ -0,0 +1,258 @@
+//! Host tool: replays raw UART captures through the decoder
+
+/// @file sds011replay.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Maps a capture written by sds011CaptureTransport (e.g. sds011cli -w) and
+/// pushes the received bytes through the frame parser and the windowed
+/// statistics at full speed. The summary on stdout depends only on the
+/// capture, so captures double as regression inputs; the replay rate goes
+/// to stderr. -g writes a synthetic capture of auto reports with line noise
+/// and a two hour outage, longer than 32 bit microseconds reach, and reads
+/// it back to check that every chunk keeps its time:
+///
+///     ./build/sds011replay -g days <file>
+///     ./build/sds011replay [-p] [-o log] <file>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sds011capture.h"
+#include "sds011frame.h"
+#include "sds011stats.h"
+
+/// silence in the synthetic capture, 2 hours, past the 71.6 minutes of 32 bit microseconds
+#define OUTAGE_US ( 2 * 3600000000ULL )
+
+/// capture and log sink writing to a stdio file
+static size_t fileSink( const uint8_t *buf, size_t len, void *ctx )
+{
+  return( fwrite( buf, 1, len, (FILE *)ctx ) );
+}
+
+/// monotonic time in seconds
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return( ts.tv_sec + ts.tv_nsec * 1e-9 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  writes a synthetic capture: a 1 Hz auto report stream with a
+    random walk, a query every 10 minutes, a noise byte now and then and
+    after 12 hours a silence of OUTAGE_US. The capture is read back and
+    the time of each frame compared with the time recorded.
+    @param path the capture file
+    @param days length of the capture
+    @returns exit code
+*/
+/**************************************************************************/
+static int generate( const char *path, unsigned long days )
+{
+  static const sds011Request query = sds011MakeRequest( CMD_QUERY_DATA, 0, 0 );
+  sds011CaptureTransport capture;
+  sds011CaptureReader reader;
+  sds011CaptureChunk chunk;
+  sds011LogFile file;
+  uint32_t seed = 1, s, wrong = 0;
+  uint64_t t = 0, last = 0;
+  uint16_t pm25 = 120, pm10 = 200;
+  uint8_t frame[10], noise;
+  FILE *out = fopen( path, "wb" );
+
+  if ( out == NULL )
+  {
+    perror( path );
+    return( 1 );
+  }
+  capture.begin( NULL, fileSink, out );
+  for ( s = 0; s < days * 86400UL; ++s )
+  {
+    seed = seed * 1103515245 + 12345;
+    pm25 = (uint16_t)( pm25 + ( seed >> 16 ) % 21 - 10 );
+    pm10 = (uint16_t)( pm10 + ( seed >> 8 ) % 21 - 10 );
+    if ( pm25 > 9990 ) pm25 = 10;
+    if ( pm10 > 9990 ) pm10 = 20;
+    frame[0] = MSG_HEAD;
+    frame[1] = REPLY_DATA;
+    frame[2] = (uint8_t)pm25;
+    frame[3] = (uint8_t)( pm25 >> 8 );
+    frame[4] = (uint8_t)pm10;
+    frame[5] = (uint8_t)( pm10 >> 8 );
+    frame[6] = 0x34;
+    frame[7] = 0x12;
+    frame[8] = sds011ReplyChecksum( frame );
+    frame[9] = MSG_TAIL;
+    if ( ( seed >> 20 ) % 1000 == 0 )
+    {
+      noise = (uint8_t)seed;
+      capture.record( SDS011_CAPTURE_RX, &noise, 1, t );
+    }
+    capture.record( SDS011_CAPTURE_RX, frame, 10, t + 1040 );
+    if ( s % 600 == 0 ) capture.record( SDS011_CAPTURE_TX, (const uint8_t *)&query, SDS011_REQUEST_LEN, t + 500000 );
+    // a byte every 1.04 ms at 9600 baud
+    t += 1000000;
+    if ( s == 12 * 3600 ) t += OUTAGE_US;
+  }
+  capture.save();
+  printf( "%s: %lu days, %u bytes recorded, %ld bytes written\n", path, days, capture.bytes(), (long)ftell( out ) );
+  fclose( out );
+  if ( capture.lost() ) return( 1 );
+
+  // a report is recorded 1040 us into its second, or at the start with a noise byte ahead of it
+  if ( !file.open( path ) || !reader.begin( file.data(), file.length() ) ) return( 1 );
+  for ( s = 0; reader.next( &chunk ); )
+  {
+    if ( chunk.dir != SDS011_CAPTURE_RX || chunk.len < SDS011_REPLY_LEN ) continue;
+    t = s * 1000000ULL + ( s > 12 * 3600 ? OUTAGE_US : 0 ) + ( chunk.len == SDS011_REPLY_LEN ? 1040 : 0 );
+    if ( chunk.time != t && wrong++ < 5 ) printf( "report %u at %.6f s, recorded at %.6f s\n", s, chunk.time / 1e6, t / 1e6 );
+    last = chunk.time;
+    ++s;
+  }
+  if ( reader.truncated() || s != days * 86400UL ) ++wrong;
+  printf( "%s: read back %u reports up to %.1f h, %u wrong\n", path, s, last / 3.6e9, wrong );
+  return( wrong ? 1 : 0 );
+}
+
+/// prints the summary of one window of the statistics
+static void summary( const char *name, const sds011Stats &stats, uint8_t window )
+{
+  sds011Summary pm25, pm10;
+
+  stats.summary( window, &pm25, &pm10 );
+  printf( "%-8s %9u samples  pm2.5 mean %4u.%u p50 %4u.%u p90 %4u.%u max %4u.%u  pm10 mean %4u.%u p90 %4u.%u max %4u.%u\n", name,
+          pm25.count, pm25.mean / 10, pm25.mean % 10, pm25.p50 / 10, pm25.p50 % 10, pm25.p90 / 10, pm25.p90 % 10,
+          pm25.max / 10, pm25.max % 10, pm10.mean / 10, pm10.mean % 10, pm10.p90 / 10, pm10.p90 % 10, pm10.max / 10, pm10.max % 10 );
+}
+
+/// prints the Air Quality Index over one window of the statistics
+static void aqi( const char *name, const sds011Stats &stats, uint8_t window )
+{
+  sds011Aqi a;
+
+  stats.aqi( window, &a );
+  printf( "aqi %-4s %9u samples  pm2.5 %4u.%u -> %3u  pm10 %4u -> %3u  aqi %3u\n", name, a.count, a.pm25 / 10, a.pm25 % 10,
+          a.aqi25, a.pm10 / 10, a.aqi10, a.aqi );
+}
+
+int main( int argc, char **argv )
+{
+  unsigned long days = 0;
+  unsigned long chunks = 0, rx = 0, tx = 0, data = 0, config = 0, commands = 0, samples = 0;
+  const char *logPath = NULL;
+  bool print = false;
+  sds011LogFile file;
+  sds011CaptureReader reader;
+  sds011CaptureChunk chunk;
+  sds011Parser parser;
+  sds011Stats stats;
+  sds011LogWriter log;
+  sds011Sample sample;
+  const uint8_t *frame;
+  uint64_t span = 0;
+  FILE *out = NULL;
+  double t0, t;
+  uint8_t i;
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "g:po:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'g': days = strtoul( optarg, NULL, 10 ); break;
+      case 'p': print = true; break;
+      case 'o': logPath = optarg; break;
+      default: optind = argc; break;
+    }
+  }
+  if ( optind != argc - 1 )
+  {
+    fprintf( stderr, "usage: %s -g days <file>\n       %s [-p] [-o log] <file>\n", argv[0], argv[0] );
+    return( 2 );
+  }
+  if ( days ) return( generate( argv[optind], days ) );
+
+  if ( !file.open( argv[optind] ) || !reader.begin( file.data(), file.length() ) )
+  {
+    fprintf( stderr, "%s: not a capture\n", argv[optind] );
+    return( 1 );
+  }
+  if ( logPath )
+  {
+    if ( ( out = fopen( logPath, "wb" ) ) == NULL )
+    {
+      perror( logPath );
+      return( 1 );
+    }
+    log.begin( fileSink, out );
+  }
+
+  // statistics run on seconds; a bucket counts up to 65535 samples, a week of 1 Hz reports fits
+  t0 = now();
+  stats.begin( 0 );
+  stats.setWindow( 0, 3600, 0 );
+  stats.setWindow( 1, 86400, 0 );
+  stats.setWindow( 2, 7 * 86400, 0 );
+
+  while ( reader.next( &chunk ) )
+  {
+    ++chunks;
+    span = chunk.time;
+    if ( chunk.dir == SDS011_CAPTURE_TX )
+    {
+      tx += chunk.len;
+      // commands go out in one write each
+      if ( chunk.len == SDS011_REQUEST_LEN && chunk.data[0] == MSG_HEAD ) ++commands;
+      if ( print ) printf( "%12.6f tx command %02X\n", chunk.time / 1e6, chunk.len > 2 ? chunk.data[2] : 0 );
+      continue;
+    }
+    rx += chunk.len;
+    for ( i = 0; i < chunk.len; ++i )
+    {
+      if ( !parser.push( chunk.data[i] ) ) continue;
+      frame = parser.frame();
+      if ( frame[1] != REPLY_DATA )
+      {
+        ++config;
+        if ( print ) printf( "%12.6f rx reply %02X value %u\n", chunk.time / 1e6, frame[2], sds011ReplyValue( frame ) );
+        continue;
+      }
+      ++data;
+      sample.time = (uint32_t)( chunk.time / 1000000 );
+      sample.id = sds011ReplyId( frame );
+      sample.pm25 = sds011ReplyPm25( frame );
+      sample.pm10 = sds011ReplyPm10( frame );
+      stats.add( sample );
+      if ( out && log.append( sample ) ) ++samples;
+      if ( print ) printf( "%12.6f rx data %04X pm2.5 %u.%u pm10 %u.%u\n", chunk.time / 1e6, sample.id, sample.pm25 / 10,
+                           sample.pm25 % 10, sample.pm10 / 10, sample.pm10 % 10 );
+    }
+  }
+  stats.advance( (uint32_t)( span / 1000000 ) );
+  t = now() - t0;
+
+  printf( "capture  %lu chunks over %.1f h%s\n", chunks, span / 3.6e9, reader.truncated() ? ", truncated" : "" );
+  printf( "received %lu bytes, %lu data frames, %lu replies, %lu bytes outside frames\n", rx, data, config,
+          rx - ( data + config ) * SDS011_REPLY_LEN - parser.pending() );
+  printf( "sent     %lu bytes, %lu commands\n", tx, commands );
+  summary( "hour", stats, 0 );
+  summary( "day", stats, 1 );
+  summary( "week", stats, 2 );
+  aqi( "day", stats, 1 );
+  if ( out )
+  {
+    log.flush();
+    fclose( out );
+    printf( "log      %lu samples in %u blocks\n", samples, log.blocks() );
+  }
+  fprintf( stderr, "replayed %.1f MB in %.3f s: %.0f MB/s, %.0f frames/s, %.0fx real time\n", file.length() / 1e6, t,
+           file.length() / 1e6 / t, ( data + config ) / t, span / 1e6 / t );
+  return( 0 );
+}
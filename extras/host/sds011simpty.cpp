@@ -0,0 +1,80 @@
+//! Host tool: software SDS011 on a pseudo terminal
+
+/// @file sds011simpty.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Creates a pty, prints the slave device path and answers on it like a real
+/// sensor at the simulated bit rate, so any program using a tty (including
+/// sds011cli) can be run against it:
+///
+///     ./build/sds011simpty [-b baud] [-p pm25,pm10]
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "sds011lib.h"
+#include "sds011sim.h"
+
+int main( int argc, char **argv )
+{
+  unsigned long baud = 9600;
+  unsigned pm25 = 123, pm10 = 456;
+  uint8_t buf[64];
+  struct termios tio;
+  struct pollfd pfd;
+  int opt, master, slave, n;
+
+  while ( ( opt = getopt( argc, argv, "b:p:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'b': baud = strtoul( optarg, NULL, 10 ); break;
+      case 'p': sscanf( optarg, "%u,%u", &pm25, &pm10 ); break;
+      default:
+        fprintf( stderr, "usage: %s [-b baud] [-p pm25,pm10]   (values in 0.1 ug/m3)\n", argv[0] );
+        return( 2 );
+    }
+  }
+
+  master = posix_openpt( O_RDWR | O_NOCTTY );
+  if ( master < 0 || grantpt( master ) != 0 || unlockpt( master ) != 0 )
+  {
+    perror( "posix_openpt" );
+    return( 1 );
+  }
+  // keep the slave open and raw, so nothing is echoed before a client attaches
+  slave = open( ptsname( master ), O_RDWR | O_NOCTTY );
+  if ( slave >= 0 && tcgetattr( slave, &tio ) == 0 )
+  {
+    cfmakeraw( &tio );
+    tcsetattr( slave, TCSANOW, &tio );
+  }
+  printf( "%s\n", ptsname( master ) );
+  fflush( stdout );
+
+  sds011Simulator sim( baud );
+  sim.setPm( pm25, pm10 );
+  sim.reset( micros() );
+
+  pfd.fd = master;
+  pfd.events = POLLIN;
+  for ( ;; )
+  {
+    // one millisecond granularity is enough for bytes of about a millisecond
+    if ( poll( &pfd, 1, 1 ) > 0 && ( n = read( master, buf, sizeof( buf ) ) ) > 0 )
+    {
+      sim.receive( buf, n, micros() );
+    }
+    for ( n = 0; n < (int)sizeof( buf ) && sim.ready( micros() ) > 0; ++n )
+    {
+      buf[n] = sim.read( micros() );
+    }
+    if ( n > 0 && write( master, buf, n ) != n ) perror( "write" );
+  }
+  return( 0 );
+}
@@ -0,0 +1,91 @@
+//! Host tool: one program per configuration for the size report
+
+/// @file sds011size.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// `make size` builds this file once per configuration, selected with
+/// -DSIZE_<config>, with the whole library, -Os and unused sections
+/// dropped, and records text, data and bss of each program in
+/// build/size.jsonl. Each program reads a tty given as argument the way a
+/// sketch of that configuration would, so only the code it needs is linked:
+///
+/// * baseline: the transport, no sensor code
+/// * lite_read: sds011Lite reading auto reports
+/// * lite_query: sds011Lite switching to query mode and querying
+/// * lite_all: sds011Lite with every command, learned timeouts and floats
+/// * lite_debug: lite_all with debug messages
+/// * classic_read: sds011 reading auto reports with dataAutoQueryCmd()
+/// * classic_all: sds011 calling every command
+///
+/// Sizes are those of the host build; they compare configurations and
+/// revisions, not boards.
+
+#include <stdio.h>
+
+#include "sds011transport.h"
+#if defined(SIZE_classic_read) || defined(SIZE_classic_all)
+#include "sds011lib.h"
+#else
+#include "sds011lite.h"
+#endif
+
+#if defined(SIZE_lite_read)
+/// the sensor of the configuration
+static sds011Lite<SDS011_FEATURE_READ> sensor;
+#elif defined(SIZE_lite_query)
+static sds011Lite<SDS011_FEATURE_QUERY | SDS011_FEATURE_MODE> sensor;
+#elif defined(SIZE_lite_all)
+static sds011Lite<SDS011_FEATURE_ALL & ~SDS011_FEATURE_DEBUG> sensor;
+#elif defined(SIZE_lite_debug)
+static sds011Lite<SDS011_FEATURE_ALL> sensor;
+#elif defined(SIZE_classic_read) || defined(SIZE_classic_all)
+static sds011 sensor;
+#endif
+
+int main( int argc, char **argv )
+{
+  sds011PosixTransport port;
+  float pm10, pm25;
+  int i;
+
+  if ( argc < 2 || !port.open( argv[1] ) ) return( 1 );
+  pm10 = pm25 = 0;
+  (void)i;
+#if defined(SIZE_lite_read)
+  sensor.begin( &port );
+  for ( i = 0; i < 10; ++i ) pm25 += sensor.read().sample.pm25;
+#elif defined(SIZE_lite_query)
+  sensor.begin( &port );
+  sensor.setReportMode( SDS011_REPORT_QUERY );
+  for ( i = 0; i < 10; ++i ) pm25 += sensor.query().sample.pm25;
+#elif defined(SIZE_lite_all) || defined(SIZE_lite_debug)
+  sensor.begin( &port );
+  sensor.reportMode();
+  sensor.setReportMode( SDS011_REPORT_QUERY );
+  sensor.power();
+  sensor.setPower( SDS011_POWER_WORK );
+  sensor.workPeriod();
+  sensor.setWorkPeriod( 0 );
+  sensor.setId( 0x1234 );
+  pm25 += sensor.firmware().year;
+  pm25 += sensor.read().sample.pm25;
+  for ( i = 0; i < 10; ++i ) sensor.dataQueryCmd( &pm10, &pm25 );
+  sensor.dataAutoQueryCmd( &pm10, &pm25 );
+#elif defined(SIZE_classic_read)
+  sensor.begin( &port );
+  for ( i = 0; i < 10; ++i ) sensor.dataAutoQueryCmd( &pm10, &pm25 );
+#elif defined(SIZE_classic_all)
+  uint8_t response, id[2];
+  sensor.begin( &port );
+  sensor.dataReportingModeCmd( &response, QUERY_MODE, WRITE_MODE );
+  sensor.sleepWorkModeCmd( &response, WORK_MODE, WRITE_MODE );
+  sensor.workPeriodCmd( &response, 0, WRITE_MODE );
+  sensor.deviceIdCmd( id, 0x34, 0x12 );
+  pm25 += sensor.firmware().year;
+  for ( i = 0; i < 10; ++i ) sensor.dataQueryCmd( &pm10, &pm25 );
+  sensor.dataAutoQueryCmd( &pm10, &pm25 );
+#endif
+  printf( "%.1f %.1f\n", pm25, pm10 );
+  return( 0 );
+}
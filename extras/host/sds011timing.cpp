@@ -0,0 +1,285 @@
+//! Host tool: checks the protocol timing in virtual time
+
+/// @file sds011timing.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Installs an sds011VirtualClock and runs command and timeout scenarios
+/// against the software sensor, each with a random reply latency:
+///
+/// * every reply arrives after exactly the wire time of command and reply
+///   at 9600 baud plus the latency, rounded up to the 1 ms polling step
+/// * a sensor that keeps its id answers a new id with SDS011_ERR_REFUSED
+/// * a sleeping sensor fails a query with SDS011_ERR_SILENT after exactly
+///   its timeout plus the doubled one
+/// * an unanswered wake command returns after SDS011_WAKE_TIMEOUT
+/// * replies with a wrong command id make SDS011_TRIES_WRONG sends, each
+///   waiting its whole timeout, and end in SDS011_ERR_NO_REPLY
+/// * a new id set while all sensors (FF FF) are addressed leaves them all
+///   addressed, and a refused id gives the id of the reply
+/// * an auto report held back while a command waited is not handed out
+///   after a query answered later
+///
+/// The scenarios run against sds011 and against sds011Lite with all
+/// features, which must time the protocol the same way. Every deviation
+/// is printed and makes the tool exit with 1. The summary
+/// compares the virtual time covered with the wall time taken:
+///
+///     ./build/sds011timing [-n rounds] [-s seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sds011lib.h"
+#include "sds011lite.h"
+#include "sds011clock.h"
+#include "sds011sim.h"
+
+/// bit rate of the scenarios
+#define BAUD 9600
+/// time on the wire of a command and its reply in us, 10 bit times per byte
+#define WIRE_US ( ( SDS011_REQUEST_LEN + SDS011_REPLY_LEN ) * ( 10000000UL / BAUD ) )
+
+/// the virtual clock of the run
+static sds011VirtualClock vclock;
+/// commands run
+static unsigned long commands;
+/// deviations found
+static unsigned long failures;
+
+/// transport to a sensor that is not there
+class deadTransport : public sds011Transport {
+	public:
+		int available(void) { return( 0 ); }
+		int read(void) { return( -1 ); }
+		size_t write( const uint8_t *buf, size_t len ) { (void)buf; return( len ); }
+};
+
+/**************************************************************************/
+/*!
+    @brief  compares the outcome and duration of a command with the expectation
+    @param type the sensor class
+    @param what the scenario
+    @param round the round
+    @param error the outcome
+    @param want the expected outcome
+    @param ms the duration in virtual ms
+    @param expect the expected duration
+    @returns void
+*/
+/**************************************************************************/
+static void check( const char *type, const char *what, unsigned long round, sds011Error error, sds011Error want, unsigned long ms, unsigned long expect )
+{
+  ++commands;
+  if ( error == want && ms == expect ) return;
+  ++failures;
+  printf( "%s round %lu %s: error %d after %lu ms, expected error %d after %lu ms\n", type, round, what, (int)error, ms,
+          (int)want, expect );
+}
+
+/**************************************************************************/
+/*!
+    @brief  records the outcome of a scenario without a duration to compare
+    @param type the sensor class
+    @param what the scenario
+    @param round the round
+    @param ok true when the outcome is the expected one
+    @returns void
+*/
+/**************************************************************************/
+static void verify( const char *type, const char *what, unsigned long round, bool ok )
+{
+  ++commands;
+  if ( ok ) return;
+  ++failures;
+  printf( "%s round %lu %s: unexpected outcome\n", type, round, what );
+}
+
+/**************************************************************************/
+/*!
+    @brief  runs one round of scenarios against a fresh sensor
+    @param type name of the sensor class S
+    @param round number of the round
+    @param latency reply latency of the software sensor in us
+    @returns void
+*/
+/**************************************************************************/
+template <class S>
+static void scenarios( const char *type, unsigned long round, uint32_t latency )
+{
+  // the reply is complete at the wire time plus latency, seen at the next 1 ms poll
+  const unsigned long rtt = ( WIRE_US + latency + 999 ) / 1000;
+  sds011Simulator sim( BAUD );
+  sds011SimTransport port( &sim );
+  deadTransport dead;
+  sds011SimFaults faults = sds011SimFaults();
+  S sensor;
+  sds011Timeouts expect;
+  unsigned long t, first;
+  sds011Error error;
+  int i;
+
+  // start on a millisecond, as a sketch does after its first delay()
+  vclock.advance( 1000 - vclock.now() % 1000 );
+  sim.setLatency( latency );
+  sim.reset( (uint32_t)micros() );
+  sensor.begin( &port );
+
+  t = millis();
+  error = sensor.setReportMode( SDS011_REPORT_QUERY ).error;
+  check( type, "query mode", round, error, SDS011_OK, millis() - t, rtt );
+  for ( i = 0; i < 8; ++i )
+  {
+    t = millis();
+    error = sensor.query().error;
+    check( type, "query", round, error, SDS011_OK, millis() - t, rtt );
+  }
+
+  // a sensor that keeps its id refuses the change in one round trip
+  sim.lockId( true );
+  t = millis();
+  error = sensor.setId( 0x1234 ).error;
+  check( type, "refused id", round, error, SDS011_ERR_REFUSED, millis() - t, rtt );
+
+  t = millis();
+  error = sensor.setPower( SDS011_POWER_SLEEP ).error;
+  check( type, "sleep", round, error, SDS011_OK, millis() - t, rtt );
+  // the learned timeout, then the doubled one
+  expect = sensor.timeouts();
+  first = expect.timeout( CMD_QUERY_DATA );
+  expect.expired( CMD_QUERY_DATA );
+  t = millis();
+  error = sensor.query().error;
+  check( type, "silent query", round, error, SDS011_ERR_SILENT, millis() - t, first + expect.timeout( CMD_QUERY_DATA ) );
+
+  sensor.begin( &dead );
+  t = millis();
+  error = sensor.setPower( SDS011_POWER_WORK ).error;
+  check( type, "unanswered wake", round, error, SDS011_ERR_SILENT, millis() - t, SDS011_WAKE_TIMEOUT );
+
+  // wake the software sensor, then garble the id of every reply
+  sensor.begin( &port );
+  sensor.setPower( SDS011_POWER_WORK );
+  ++commands;
+  faults.command = 1000;
+  sim.setFaults( faults, (uint32_t)round + 1 );
+  t = millis();
+  error = sensor.firmware().error;
+  check( type, "wrong replies", round, error, SDS011_ERR_NO_REPLY, millis() - t,
+         SDS011_TRIES_WRONG * (unsigned long)sensor.timeouts().timeout( CMD_FIRMWARE_VERSION ) );
+}
+
+/// the next auto report of an sds011, as sds011Lite::read() gives it
+static sds011SampleResult nextReport( sds011 &sensor )
+{
+  sds011SampleResult result = { SDS011_OK, { 0, 0, 0, 0 } };
+
+  if ( !sensor.dataAutoQueryRaw( &result.sample ) ) result.error = sensor.lastError();
+  return( result );
+}
+
+/// the next auto report of an sds011Lite
+template <unsigned F>
+static sds011SampleResult nextReport( sds011Lite<F> &sensor )
+{
+  return( sensor.read() );
+}
+
+/**************************************************************************/
+/*!
+    @brief  runs one round of the id and held back report scenarios
+    against a fresh sensor
+    @param type name of the sensor class S
+    @param round number of the round
+    @param latency reply latency of the software sensor in us
+    @returns void
+*/
+/**************************************************************************/
+template <class S>
+static void addressing( const char *type, unsigned long round, uint32_t latency )
+{
+  const unsigned long rtt = ( WIRE_US + latency + 999 ) / 1000;
+  sds011Simulator sim( BAUD );
+  sds011SimTransport port( &sim );
+  S sensor;
+  sds011IdResult id;
+  sds011SampleResult report;
+  unsigned long t;
+  sds011Error error;
+
+  vclock.advance( 1000 - vclock.now() % 1000 );
+  sim.setLatency( latency );
+  sim.reset( (uint32_t)micros() );
+  sensor.begin( &port );
+  sensor.setReportMode( SDS011_REPORT_QUERY );
+  ++commands;
+
+  // addressed as FF FF, the sensor is still reached after it took a new id
+  t = millis();
+  error = sensor.setId( 0x1234 ).error;
+  check( type, "new id", round, error, SDS011_OK, millis() - t, rtt );
+  sim.setId( 0x56, 0x78 );
+  t = millis();
+  error = sensor.query().error;
+  check( type, "query after new id", round, error, SDS011_OK, millis() - t, rtt );
+  sim.lockId( true );
+  id = sensor.setId( 0x4321 );
+  verify( type, "refused id of the reply", round, id.error == SDS011_ERR_REFUSED && id.id == 0x7856 );
+
+  // the report met by firmware() is older than the answer to the query after it
+  sensor.setReportMode( SDS011_REPORT_AUTO );
+  vclock.advance( 1100000 );
+  // polled, the software sensor puts the report due on the line ahead of the command
+  port.available();
+  sensor.firmware();
+  commands += 2;
+  t = millis();
+  error = sensor.query().error;
+  // read() waits 600 ms, the next report is due within a second of the last
+  vclock.advance( 500000 );
+  report = nextReport( sensor );
+  verify( type, "report after query", round, error == SDS011_OK && report.error == SDS011_OK && report.sample.time >= t );
+}
+
+int main( int argc, char **argv )
+{
+  unsigned long rounds = 1000, r;
+  unsigned int seed = 1;
+  uint32_t latency;
+  struct timespec a, b;
+  double wall;
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "n:s:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'n': rounds = strtoul( optarg, NULL, 10 ); break;
+      case 's': seed = (unsigned int)strtoul( optarg, NULL, 10 ); break;
+      default:
+        fprintf( stderr, "usage: %s [-n rounds] [-s seed]\n", argv[0] );
+        return( 2 );
+    }
+  }
+
+  srand( seed );
+  clock_gettime( CLOCK_MONOTONIC, &a );
+  sds011UseClock( &vclock );
+  for ( r = 0; r < rounds; ++r )
+  {
+    latency = (uint32_t)( rand() % 5000 );
+    scenarios<sds011>( "sds011", r, latency );
+    scenarios< sds011Lite<SDS011_FEATURE_ALL & ~SDS011_FEATURE_DEBUG> >( "sds011Lite", r, latency );
+    addressing<sds011>( "sds011", r, latency );
+    addressing< sds011Lite<SDS011_FEATURE_ALL & ~SDS011_FEATURE_DEBUG> >( "sds011Lite", r, latency );
+  }
+  sds011UseClock( NULL );
+  clock_gettime( CLOCK_MONOTONIC, &b );
+  wall = ( b.tv_sec - a.tv_sec ) + ( b.tv_nsec - a.tv_nsec ) / 1e9;
+
+  printf( "%lu rounds, %lu commands, %.1f s of virtual time in %.3f s (%.0fx real time), %lu timing deviations\n",
+          rounds, commands, vclock.now() / 1e6, wall, vclock.now() / 1e6 / wall, failures );
+  return( failures ? 1 : 0 );
+}
@@ -0,0 +1,218 @@
+//! Host tool: measures the recovery of the liveness watchdog from sensor faults
+
+/// @file sds011watchtool.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Runs sds011Watchdog against the software sensor in auto report mode, in
+/// virtual time (see sds011clock.h) unless -r asks for real time, and, whenever the watchdog is healthy and the spacing has
+/// passed, makes the sensor misbehave in turn:
+///
+/// * stall: the line goes dead for 5 s and comes back by itself
+/// * sleep: the sensor is sent to sleep behind the library's back
+/// * query: the sensor is switched to query mode behind the library's back
+/// * glitch: the line stays dead until the UART is re-initialized
+///
+/// Prints every recovery, the time from the fault to the next sample per
+/// kind of fault and the watchdog report; exits with 1 when a fault was not
+/// recovered within a minute:
+///
+///     ./build/sds011watchtool [-r] [-n faults] [-e spacing_ms] [-l limit_ms]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "sds011watchdog.h"
+#include "sds011clock.h"
+#include "sds011frame.h"
+#include "sds011lib.h"
+#include "sds011sim.h"
+
+/// kinds of faults
+#define KINDS 4
+/// how long a stall keeps the line dead, in ms
+#define STALL 5000UL
+/// time a fault may take to recover before the run fails, in ms
+#define GIVE_UP 60000UL
+
+/// names of the kinds of faults
+static const char *const kinds[KINDS] = { "stall", "sleep", "query", "glitch" };
+/// names of the recovery steps
+static const char *const steps[SDS011_RECOVER_STEPS] = { "none", "resync", "wake", "configure", "reinit" };
+
+/// transport to the software sensor whose line can go dead
+class flakyTransport : public sds011Transport {
+	public:
+		flakyTransport( sds011Simulator *sim ) : _sim(sim), _dead(false), _until(0) {}
+		/// kills the line, until millis() reaches until or, for 0, until repair()
+		void kill( uint32_t until ) { _dead = true; _until = until; }
+		/// brings the line back
+		void repair(void) { _dead = false; }
+		int available(void)
+		{
+			if ( !alive() ) return( 0 );
+			return( _sim->ready( (uint32_t)micros() ) );
+		}
+		int read(void) { return( alive() ? _sim->read( (uint32_t)micros() ) : -1 ); }
+		size_t write( const uint8_t *buf, size_t len )
+		{
+			if ( alive() ) _sim->receive( buf, len, (uint32_t)micros() );
+			return( len );
+		}
+	private:
+		/// the simulated sensor
+		sds011Simulator *_sim;
+		/// true while the line is dead
+		bool _dead;
+		/// millis() a stall ends, 0 for a glitch
+		uint32_t _until;
+
+		/// false while dead; what the sensor sends meanwhile is lost
+		bool alive(void)
+		{
+			if ( _dead && _until && (int32_t)( millis() - _until ) >= 0 ) _dead = false;
+			if ( _dead )
+			{
+				while ( _sim->ready( (uint32_t)micros() ) > 0 ) _sim->read( (uint32_t)micros() );
+			}
+			return( !_dead );
+		}
+};
+
+/**************************************************************************/
+/*!
+    @brief  the UART re-initialization given to the watchdog
+    @param ctx the flaky transport
+    @returns true
+*/
+/**************************************************************************/
+static bool reinit( void *ctx )
+{
+  ( (flakyTransport *)ctx )->repair();
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  makes the sensor misbehave
+    @param kind index into kinds
+    @param sim the software sensor
+    @param port its transport
+    @returns void
+*/
+/**************************************************************************/
+static void inject( int kind, sds011Simulator *sim, flakyTransport *port )
+{
+  sds011Request frame;
+
+  switch ( kind )
+  {
+    case 0:
+      port->kill( millis() + STALL );
+      break;
+    case 1:
+      // as if another program on the line had sent it; the reply goes to the library
+      frame = sds011MakeRequest( CMD_SLEEP_AND_WORK, WRITE_MODE, SLEEP_MODE );
+      sim->receive( frame.bytes, sizeof( frame.bytes ), (uint32_t)micros() );
+      break;
+    case 2:
+      frame = sds011MakeRequest( CMD_REPORTING_MODE, WRITE_MODE, QUERY_MODE );
+      sim->receive( frame.bytes, sizeof( frame.bytes ), (uint32_t)micros() );
+      break;
+    default:
+      port->kill( 0 );
+      break;
+  }
+}
+
+int main( int argc, char **argv )
+{
+  sds011Simulator sim;
+  flakyTransport port( &sim );
+  sds011 sensor;
+  sds011Watchdog watchdog;
+  sds011Profile profile = { SDS011_FIELD_MODE | SDS011_FIELD_WORK | SDS011_FIELD_PERIOD, AUTO_REPORT_MODE, WORK_MODE, 0, 0, 0 };
+  sds011VirtualClock vclock;
+  sds011WatchdogReport rep;
+  sds011Sample sample;
+  uint32_t spacing = 5000, limit = 0, start, injectedAt = 0, next, took;
+  uint32_t total[KINDS] = { 0 }, worst[KINDS] = { 0 }, count[KINDS] = { 0 };
+  int opt, faults = 4, injected = 0, kind = -1, i;
+  bool failed = false, real = false;
+
+  while ( ( opt = getopt( argc, argv, "rn:e:l:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'r': real = true; break;
+      case 'n': faults = atoi( optarg ); break;
+      case 'e': spacing = strtoul( optarg, NULL, 10 ); break;
+      case 'l': limit = strtoul( optarg, NULL, 10 ); break;
+      default:
+        fprintf( stderr, "usage: %s [-r] [-n faults] [-e spacing_ms] [-l limit_ms]\n", argv[0] );
+        return( 2 );
+    }
+  }
+
+  if ( !real ) sds011UseClock( &vclock );
+  sim.reset( (uint32_t)micros() );
+  sim.setPm( 123, 234 );
+  sensor.begin( &port );
+  if ( !sensor.applyProfile( profile ) )
+  {
+    fprintf( stderr, "the software sensor did not take the profile\n" );
+    return( 1 );
+  }
+  watchdog.begin( &sensor, profile, limit );
+  watchdog.onReinit( reinit, &port );
+  printf( "expected interval %u ms, recovery after %u ms of silence, %d faults\n", (unsigned)watchdog.interval(),
+          (unsigned)watchdog.limit(), faults );
+
+  start = millis();
+  next = start + spacing;
+  while ( injected < faults || kind >= 0 )
+  {
+    if ( watchdog.poll( &sample ) && kind >= 0 )
+    {
+      took = millis() - injectedAt;
+      printf( "%7u ms  %-6s recovered after %5u ms\n", (unsigned)( millis() - start ), kinds[kind], (unsigned)took );
+      total[kind] += took;
+      if ( took > worst[kind] ) worst[kind] = took;
+      ++count[kind];
+      kind = -1;
+      next = millis() + spacing;
+    }
+    if ( kind < 0 && injected < faults && watchdog.healthy() && (int32_t)( millis() - next ) >= 0 )
+    {
+      kind = injected++ % KINDS;
+      injectedAt = millis();
+      inject( kind, &sim, &port );
+      printf( "%7u ms  %-6s injected\n", (unsigned)( injectedAt - start ), kinds[kind] );
+    }
+    if ( kind >= 0 && millis() - injectedAt > GIVE_UP )
+    {
+      printf( "%7u ms  %-6s not recovered, giving up\n", (unsigned)( millis() - start ), kinds[kind] );
+      failed = true;
+      break;
+    }
+  }
+
+  watchdog.report( &rep );
+  sds011UseClock( NULL );
+  printf( "\nfault   count  mean ms  max ms   (fault to next sample)\n" );
+  for ( i = 0; i < KINDS; ++i )
+  {
+    if ( count[i] ) printf( "%-6s  %5u  %7u  %6u\n", kinds[i], (unsigned)count[i], (unsigned)( total[i] / count[i] ), (unsigned)worst[i] );
+  }
+  printf( "\nframes %u, gaps %u (%u ms of data missing, longest interval %u ms)\n", (unsigned)rep.frames, (unsigned)rep.gaps,
+          (unsigned)rep.gapTime, (unsigned)rep.longestGap );
+  printf( "outages %u, recovered %u, time to recovery after detection: mean %u ms, max %u ms\n", (unsigned)rep.outages,
+          (unsigned)rep.recoveries, (unsigned)rep.meanRecovery, (unsigned)rep.maxRecovery );
+  printf( "step        taken  recovered\n" );
+  for ( i = 1; i < SDS011_RECOVER_STEPS; ++i )
+  {
+    printf( "%-10s  %5u  %9u\n", steps[i], (unsigned)rep.actions[i], (unsigned)rep.recoveredBy[i] );
+  }
+  return( failed ? 1 : 0 );
+}
@@ -0,0 +1,395 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (non-blocking command engine implementation)
+
+/// @file sds011async.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011async.h"
+#include "sds011frame.h"
+#include "sds011metrics.h"
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011Async::sds011Async(void) : _uart(NULL), _id_1(MSG_FF), _id_2(MSG_FF), _head(0), _count(0),
+  _sent(false), _sentAt(0), _heard(false), _deviceCount(0), _deviceNext(0), _dataCb(NULL), _dataCtx(NULL) {
+}
+
+/**************************************************************************/
+/*!
+    @brief  attaches the engine to a sensor
+    @param transport the transport connected to the sensor, set up for 9600 8N1
+    @param id_1 device lower byter
+    @param id_2 device higher byter
+    @returns status true when executed seccessfully
+*/
+/**************************************************************************/
+bool sds011Async::begin( sds011Transport *transport, uint8_t id_1, uint8_t id_2 ) {
+  _uart = transport;
+  _id_1 = id_1;
+  _id_2 = id_2;
+  _head = 0;
+  _count = 0;
+  _sent = false;
+  _parser.reset();
+  _deviceCount = 0;
+  _deviceNext = 0;
+  return( transport != NULL );
+}
+
+/**************************************************************************/
+/*!
+    @brief  queues a command, see the command table at sds011::sdsCommunicate for the options
+    @param command one byte of the command to be sent
+    @param option_1 first parameter of the command
+    @param option_2 second parameter of the command
+    @param result slot filled on completion, may be NULL
+    @param cb callback called on completion, may be NULL
+    @param ctx passed to cb
+    @returns false when the queue is full
+*/
+/**************************************************************************/
+bool sds011Async::enqueue( uint8_t command, uint8_t option_1, uint8_t option_2, sds011AsyncResult *result, sds011Callback cb, void *ctx ) {
+  return( enqueue( command, option_1, option_2, _id_1, _id_2, result, cb, ctx ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  queues a command for one of several devices sharing the line
+    @param command one byte of the command to be sent
+    @param option_1 first parameter of the command
+    @param option_2 second parameter of the command
+    @param id_1 the id_lsb where the command is sent
+    @param id_2 the id_msb where the command is sent
+    @param result slot filled on completion, may be NULL
+    @param cb callback called on completion, may be NULL
+    @param ctx passed to cb
+    @returns false when the queue is full
+*/
+/**************************************************************************/
+bool sds011Async::enqueue( uint8_t command, uint8_t option_1, uint8_t option_2, uint8_t id_1, uint8_t id_2, sds011AsyncResult *result, sds011Callback cb, void *ctx ) {
+  entry *e;
+
+  if ( _count >= SDS011_ASYNC_QUEUE ) return( false );
+  e = &_queue[( _head + _count++ ) % SDS011_ASYNC_QUEUE];
+  e->command = command;
+  e->option_1 = option_1;
+  e->option_2 = option_2;
+  e->id_1 = id_1;
+  e->id_2 = id_2;
+  e->silent = 0;
+  e->wrong = 0;
+  e->result = result;
+  e->cb = cb;
+  e->ctx = ctx;
+  if ( result )
+  {
+    result->command = command;
+    result->status = false;
+    result->done = false;
+  }
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  queues a reporting mode command, as dataReportingModeCmd
+    @param mod the mode to be set 0:auto, 1:query
+    @param wr the read (0) or write (1)
+    @param result slot filled on completion, reply[4] holds the mode
+    @param cb callback called on completion
+    @param ctx passed to cb
+    @returns false when the queue is full
+*/
+/**************************************************************************/
+bool sds011Async::dataReportingMode( uint8_t mod, uint8_t wr, sds011AsyncResult *result, sds011Callback cb, void *ctx ) {
+  return( enqueue( CMD_REPORTING_MODE, wr, mod, result, cb, ctx ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  queues a query data command, as dataQueryCmd
+    @param result slot filled on completion, reply[2..5] hold the PM values
+    @param cb callback called on completion
+    @param ctx passed to cb
+    @returns false when the queue is full
+*/
+/**************************************************************************/
+bool sds011Async::dataQuery( sds011AsyncResult *result, sds011Callback cb, void *ctx ) {
+  return( enqueue( CMD_QUERY_DATA, 0, 0, result, cb, ctx ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  queues a set device id command, as deviceIdCmd
+    @param new_Id1 new id lower byte
+    @param new_Id2 new id higher byte
+    @param result slot filled on completion, reply[6..7] hold the new id
+    @param cb callback called on completion
+    @param ctx passed to cb
+    @returns false when the queue is full
+*/
+/**************************************************************************/
+bool sds011Async::deviceId( uint8_t new_Id1, uint8_t new_Id2, sds011AsyncResult *result, sds011Callback cb, void *ctx ) {
+  return( enqueue( CMD_SET_DEVICE_ID, new_Id1, new_Id2, result, cb, ctx ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  queues a sleep / work command, as sleepWorkModeCmd
+    @param mod sleep or work mode
+    @param wr parameter to set (write) or unset (get)
+    @param result slot filled on completion, reply[4] holds the mode
+    @param cb callback called on completion
+    @param ctx passed to cb
+    @returns false when the queue is full
+*/
+/**************************************************************************/
+bool sds011Async::sleepWorkMode( uint8_t mod, uint8_t wr, sds011AsyncResult *result, sds011Callback cb, void *ctx ) {
+  return( enqueue( CMD_SLEEP_AND_WORK, wr, mod, result, cb, ctx ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  queues a work period command, as workPeriodCmd
+    @param minutes duration of sleep time
+    @param wr parameter to set (write) or unset (get)
+    @param result slot filled on completion, reply[4] holds the period
+    @param cb callback called on completion
+    @param ctx passed to cb
+    @returns false when the queue is full
+*/
+/**************************************************************************/
+bool sds011Async::workPeriod( uint8_t minutes, uint8_t wr, sds011AsyncResult *result, sds011Callback cb, void *ctx ) {
+  return( enqueue( CMD_WORKING_PERIOD, wr, minutes, result, cb, ctx ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  queues a firmware version command, as deviceInfoCmd
+    @param result slot filled on completion, reply[3..5] hold YY MM DD
+    @param cb callback called on completion
+    @param ctx passed to cb
+    @returns false when the queue is full
+*/
+/**************************************************************************/
+bool sds011Async::deviceInfo( sds011AsyncResult *result, sds011Callback cb, void *ctx ) {
+  return( enqueue( CMD_FIRMWARE_VERSION, 0, 0, result, cb, ctx ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  sets the callback for data frames that do not answer a queued
+    command, i.e. the reports of a sensor in auto report mode
+    @param cb callback, NULL to drop such frames
+    @param ctx passed to cb
+    @returns void
+*/
+/**************************************************************************/
+void sds011Async::onData( sds011Callback cb, void *ctx ) {
+  _dataCb = cb;
+  _dataCtx = ctx;
+}
+
+/**************************************************************************/
+/*!
+    @brief  the learned reply timeouts of one device on the line
+    @param id_1 device lower byte
+    @param id_2 device higher byte
+    @returns the timeouts, initial ones for a device not addressed yet
+*/
+/**************************************************************************/
+const sds011Timeouts &sds011Async::timeouts( uint8_t id_1, uint8_t id_2 ) const {
+  static const sds011Timeouts initial;
+  uint8_t i;
+
+  for ( i = 0; i < _deviceCount; ++i )
+  {
+    if ( _devices[i].id_1 == id_1 && _devices[i].id_2 == id_2 ) return( _devices[i].timeouts );
+  }
+  return( initial );
+}
+
+/**************************************************************************/
+/*!
+    @brief  the learned reply timeouts of one device, a fresh entry (the
+    oldest one when all are in use) for a device not addressed yet. Sensors
+    sharing a line answer at their own pace, one estimate for all of them
+    would be as slow as the slowest and too short for it after a fast one.
+    @param id_1 device lower byte
+    @param id_2 device higher byte
+    @returns the timeouts
+*/
+/**************************************************************************/
+sds011Timeouts &sds011Async::timeoutsOf( uint8_t id_1, uint8_t id_2 ) {
+  device *d;
+  uint8_t i;
+
+  for ( i = 0; i < _deviceCount; ++i )
+  {
+    if ( _devices[i].id_1 == id_1 && _devices[i].id_2 == id_2 ) return( _devices[i].timeouts );
+  }
+  if ( _deviceCount < SDS011_ASYNC_DEVICES )
+  {
+    d = &_devices[_deviceCount++];
+  }else
+  {
+    d = &_devices[_deviceNext];
+    _deviceNext = ( _deviceNext + 1 ) % SDS011_ASYNC_DEVICES;
+  }
+  d->id_1 = id_1;
+  d->id_2 = id_2;
+  d->timeouts.reset();
+  return( d->timeouts );
+}
+
+/**************************************************************************/
+/*!
+    @brief  sends the command at the head of the queue
+    @returns void
+*/
+/**************************************************************************/
+void sds011Async::send(void) {
+  sds011Request frame;
+  entry *e = &_queue[_head];
+
+  _uart->write( sds011RequestBytes( &frame, e->command, e->option_1, e->option_2, e->id_1, e->id_2 ), SDS011_REQUEST_LEN );
+  if ( e->silent + e->wrong == 0 ) SDS011_METRIC_COUNT( commands ); else SDS011_METRIC_COUNT( retries );
+  _sent = true;
+  _heard = false;
+  _sentAt = millis();
+}
+
+/**************************************************************************/
+/*!
+    @brief  finishes the command at the head of the queue and calls back
+    @param frame the reply, NULL when the command failed
+    @returns void
+*/
+/**************************************************************************/
+void sds011Async::complete( const uint8_t *frame ) {
+  entry e = _queue[_head];
+  sds011AsyncResult local, *result = e.result ? e.result : &local;
+  sds011Timeouts learned;
+  bool status = frame != NULL;
+
+  if ( status ) SDS011_METRIC_LATENCY( e.command, _sentAt );
+  // a reply after a resend may answer an earlier send, only learn from first sends
+  if ( status && e.silent + e.wrong == 0 ) timeoutsOf( e.id_1, e.id_2 ).observe( e.command, millis() - _sentAt );
+
+  // free the slot first, so the callback may queue the next command
+  _head = ( _head + 1 ) % SDS011_ASYNC_QUEUE;
+  --_count;
+  _sent = false;
+
+  if ( status && e.option_1 == WRITE_MODE && ( e.command == CMD_REPORTING_MODE || e.command == CMD_SLEEP_AND_WORK
+       || e.command == CMD_WORKING_PERIOD ) && frame[4] != e.option_2 )
+  {
+    status = false;
+  }
+  if ( status && e.command == CMD_SET_DEVICE_ID )
+  {
+    if ( frame[6] != e.option_1 || frame[7] != e.option_2 )
+    {
+      status = false;
+    }else if ( e.id_1 != MSG_FF || e.id_2 != MSG_FF )
+    {
+      // the estimate follows the device to its new id
+      learned = timeoutsOf( e.id_1, e.id_2 );
+      timeoutsOf( e.option_1, e.option_2 ) = learned;
+      if ( e.id_1 == _id_1 && e.id_2 == _id_2 )
+      {
+        _id_1 = e.option_1;
+        _id_2 = e.option_2;
+      }
+    }
+  }
+
+  result->command = e.command;
+  result->status = status;
+  if ( frame ) memcpy( result->reply, frame, SDS011_REPLY_LEN );
+  result->done = true;
+  if ( e.cb ) e.cb( result, e.ctx );
+}
+
+/**************************************************************************/
+/*!
+    @brief  dispatches a received frame to the command in flight, or to
+    the data callback
+    @param frame the validated reply frame
+    @returns void
+*/
+/**************************************************************************/
+void sds011Async::dispatch( const uint8_t *frame ) {
+  sds011AsyncResult data;
+  entry *e = &_queue[_head];
+
+  // only a frame of the addressed device tells it is awake, not the reports of the others on the line
+  if ( _sent && ( ( e->id_1 == MSG_FF && e->id_2 == MSG_FF ) || ( frame[6] == e->id_1 && frame[7] == e->id_2 )
+       || ( e->command == CMD_SET_DEVICE_ID && frame[6] == e->option_1 && frame[7] == e->option_2 ) ) ) _heard = true;
+  // a sensor addressed by its id only answers for itself, the set id reply carries the new id
+  if ( _sent && sds011ReplyAnswers( frame, e->command ) && ( ( e->id_1 == MSG_FF && e->id_2 == MSG_FF )
+       || e->command == CMD_SET_DEVICE_ID || ( frame[6] == e->id_1 && frame[7] == e->id_2 ) ) )
+  {
+    complete( frame );
+    return;
+  }
+  if ( ( _id_1 != MSG_FF || _id_2 != MSG_FF ) && ( frame[6] != _id_1 || frame[7] != _id_2 ) ) return;
+  if ( frame[1] == REPLY_DATA && _dataCb )
+  {
+    data.command = CMD_QUERY_DATA;
+    data.status = true;
+    data.done = true;
+    memcpy( data.reply, frame, SDS011_REPLY_LEN );
+    _dataCb( &data, _dataCtx );
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  advances the engine without blocking: consumes received bytes,
+    completes the command in flight, resends or fails it after its deadline
+    and sends the next queued command. Call it from loop() as often as possible.
+    @returns void
+*/
+/**************************************************************************/
+void sds011Async::poll(void) {
+  entry *e;
+  bool wake, failed;
+
+  if ( _uart == NULL ) return;
+  while ( _uart->available() > 0 )
+  {
+    if ( _parser.push( (uint8_t)_uart->read() ) ) dispatch( _parser.frame() );
+  }
+
+  if ( _sent )
+  {
+    e = &_queue[_head];
+    wake = e->command == CMD_SLEEP_AND_WORK && e->option_1 == WRITE_MODE && e->option_2 == WORK_MODE;
+    if ( millis() - _sentAt >= ( wake ? SDS011_WAKE_TIMEOUT : timeoutsOf( e->id_1, e->id_2 ).timeout( e->command ) ) )
+    {
+      SDS011_METRIC_COUNT( timeouts );
+      // silence (asleep, unplugged) gets fewer tries than replies lost among reports and noise
+      if ( !_heard )
+      {
+        timeoutsOf( e->id_1, e->id_2 ).expired( e->command );
+        failed = ++e->silent >= SDS011_TRIES_SILENT;
+      }else
+      {
+        failed = ++e->wrong >= SDS011_TRIES_WRONG;
+      }
+      // a sensor woken from sleep often does not answer, resending does not help
+      if ( wake || failed )
+      {
+        complete( NULL );
+      }else
+      {
+        send();
+      }
+    }
+  }
+  if ( !_sent && _count > 0 ) send();
+}
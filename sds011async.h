@@ -0,0 +1,112 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (non-blocking command engine interface)
+
+/// @file sds011async.h
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#ifndef PM_SDS011_ASYNC_h
+#define PM_SDS011_ASYNC_h
+
+#include "sds011lib.h"
+
+/// number of commands that can wait in the queue
+#define SDS011_ASYNC_QUEUE 8
+/// number of device ids on one line with reply timeouts of their own
+#define SDS011_ASYNC_DEVICES 8
+
+/// outcome of an asynchronous command
+struct sds011AsyncResult {
+	/// the command, one of the CMD_ values
+	uint8_t command;
+	/// true once the command has completed, successfully or not
+	volatile bool done;
+	/// true when a matching (and for writes, confirming) reply was received
+	bool status;
+	/// the reply frame, valid when status is true
+	uint8_t reply[SDS011_REPLY_LEN];
+};
+
+/// completion callback, called from poll()
+typedef void (*sds011Callback)( const sds011AsyncResult *result, void *ctx );
+
+/// non-blocking command engine. Commands are queued and return at once;
+/// poll() sends them one after the other, collects the replies, resends on
+/// a missed deadline (learned per command and device id, see sds011Timeouts)
+/// and finally fills the result slot and calls the completion callback. Data frames nobody asked for (auto report mode)
+/// are handed to the onData() callback.
+class sds011Async {
+	public:
+		sds011Async(void);
+		bool begin( sds011Transport *transport, uint8_t id_1 = MSG_FF, uint8_t id_2 = MSG_FF );
+		bool dataReportingMode( uint8_t mod, uint8_t wr, sds011AsyncResult *result = NULL, sds011Callback cb = NULL, void *ctx = NULL );
+		bool dataQuery( sds011AsyncResult *result = NULL, sds011Callback cb = NULL, void *ctx = NULL );
+		bool deviceId( uint8_t new_Id1, uint8_t new_Id2, sds011AsyncResult *result = NULL, sds011Callback cb = NULL, void *ctx = NULL );
+		bool sleepWorkMode( uint8_t mod, uint8_t wr, sds011AsyncResult *result = NULL, sds011Callback cb = NULL, void *ctx = NULL );
+		bool workPeriod( uint8_t minutes, uint8_t wr, sds011AsyncResult *result = NULL, sds011Callback cb = NULL, void *ctx = NULL );
+		bool deviceInfo( sds011AsyncResult *result = NULL, sds011Callback cb = NULL, void *ctx = NULL );
+		bool enqueue( uint8_t command, uint8_t option_1, uint8_t option_2, sds011AsyncResult *result, sds011Callback cb, void *ctx );
+		bool enqueue( uint8_t command, uint8_t option_1, uint8_t option_2, uint8_t id_1, uint8_t id_2, sds011AsyncResult *result, sds011Callback cb, void *ctx );
+		void onData( sds011Callback cb, void *ctx = NULL );
+		void poll(void);
+		/// number of commands queued or in flight
+		uint8_t queued(void) const { return( _count ); }
+		/// learned reply timeouts of the device the engine addresses
+		const sds011Timeouts &timeouts(void) const { return( timeouts( _id_1, _id_2 ) ); }
+		const sds011Timeouts &timeouts( uint8_t id_1, uint8_t id_2 ) const;
+	private:
+		/// one queued command
+		struct entry {
+			uint8_t command;
+			uint8_t option_1;
+			uint8_t option_2;
+			uint8_t id_1;
+			uint8_t id_2;
+			uint8_t silent;
+			uint8_t wrong;
+			sds011AsyncResult *result;
+			sds011Callback cb;
+			void *ctx;
+		};
+		/// the transport connected to the sensor
+		sds011Transport *_uart;
+		/// the reply frame parser
+		sds011Parser _parser;
+		/// id byte 1 the commands are addressed to
+		uint8_t _id_1;
+		/// id byte 2 the commands are addressed to
+		uint8_t _id_2;
+		/// command queue, _queue[_head] is in flight when _sent is true
+		entry _queue[SDS011_ASYNC_QUEUE];
+		/// queue read position
+		uint8_t _head;
+		/// number of queued commands
+		uint8_t _count;
+		/// true when the head command was sent and waits for its reply
+		bool _sent;
+		/// millis() when the head command was sent
+		unsigned long _sentAt;
+		/// true when a frame of the addressed device arrived since the head command was sent
+		bool _heard;
+		/// a device id and its learned reply timeouts
+		struct device {
+			uint8_t id_1;
+			uint8_t id_2;
+			sds011Timeouts timeouts;
+		};
+		/// learned reply timeouts per device id, the oldest entry is replaced when all are in use
+		device _devices[SDS011_ASYNC_DEVICES];
+		/// number of entries of _devices in use
+		uint8_t _deviceCount;
+		/// the entry of _devices replaced next
+		uint8_t _deviceNext;
+		/// callback for unsolicited data frames
+		sds011Callback _dataCb;
+		/// context for _dataCb
+		void *_dataCtx;
+		sds011Timeouts &timeoutsOf( uint8_t id_1, uint8_t id_2 );
+		void send(void);
+		void complete( const uint8_t *frame );
+		void dispatch( const uint8_t *frame );
+};
+
+#endif
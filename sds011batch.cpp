@@ -0,0 +1,204 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (batch frame decoder implementation)
+
+/// @file sds011batch.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011batch.h"
+#include "sds011lib.h"
+
+#if !defined(SDS011_BATCH_SCALAR) && defined(__SSE2__)
+#include <emmintrin.h>
+#elif !defined(SDS011_BATCH_SCALAR) && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/**************************************************************************/
+/*!
+    @brief  decodes one frame without vector instructions
+    @param f the ten bytes
+    @param out the arrays
+    @param i index of the frame
+    @returns 1 for a valid data frame, else 0
+*/
+/**************************************************************************/
+static inline uint8_t decodeOne( const uint8_t *f, const sds011Batch &out, size_t i ) {
+  uint8_t sum = (uint8_t)( f[2] + f[3] + f[4] + f[5] + f[6] + f[7] );
+  uint8_t ok = ( f[0] == MSG_HEAD ) & ( f[1] == REPLY_DATA ) & ( f[8] == sum ) & ( f[9] == MSG_TAIL );
+
+  out.pm25[i] = (uint16_t)( f[2] | ( f[3] << 8 ) );
+  out.pm10[i] = (uint16_t)( f[4] | ( f[5] << 8 ) );
+  out.id[i] = (uint16_t)( f[6] | ( f[7] << 8 ) );
+  out.valid[i] = ok;
+  return( ok );
+}
+
+/**************************************************************************/
+/*!
+    @brief  decodes frames one byte at a time, the reference for the
+    vector kernels
+    @param frames count frames of 10 bytes, back to back
+    @param count number of frames
+    @param out arrays of count entries each
+    @returns number of valid data frames
+*/
+/**************************************************************************/
+size_t sds011DecodeBatchScalar( const uint8_t *frames, size_t count, const sds011Batch &out ) {
+  size_t i, valid = 0;
+
+  for ( i = 0; i < count; ++i ) valid += decodeOne( frames + i * SDS011_REPLY_LEN, out, i );
+  return( valid );
+}
+
+/**************************************************************************/
+/*!
+    @brief  reads a little endian 16 bit word
+    @param p the two bytes
+    @returns the word
+*/
+/**************************************************************************/
+static inline uint16_t word( const uint8_t *p ) {
+  return( (uint16_t)( p[0] | ( p[1] << 8 ) ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  decodes frames with the vector kernel of the target, eight
+    frames per step. DATA1..DATA6, check-sum and tail of each frame are
+    loaded as four 16 bit words and the 8x4 words transposed into one
+    vector each of PM2.5, PM10, ids and check-sum/tail, which are checked
+    and stored eight lanes at a time. The remainder is decoded by the
+    scalar code.
+    @param frames count frames of 10 bytes, back to back
+    @param count number of frames
+    @param out arrays of count entries each
+    @returns number of valid data frames
+*/
+/**************************************************************************/
+size_t sds011DecodeBatch( const uint8_t *frames, size_t count, const sds011Batch &out ) {
+  size_t i = 0, valid = 0;
+#if !defined(SDS011_BATCH_SCALAR) && defined(__SSE2__)
+  const __m128i low = _mm_set1_epi16( 0xff );
+  const __m128i head = _mm_set1_epi16( (short)( MSG_HEAD | ( REPLY_DATA << 8 ) ) );
+  const __m128i tail = _mm_set1_epi16( MSG_TAIL );
+  const __m128i one = _mm_set1_epi8( 1 );
+  __m128i r0, r1, r2, r3, t0, t1, t2, t3, pm25, pm10, id, check, h, sum, ok;
+  const uint8_t *p;
+
+  for ( ; i + 8 <= count; i += 8 )
+  {
+    p = frames + i * SDS011_REPLY_LEN;
+    // two frames per register: DATA1..DATA6, check-sum, tail
+    r0 = _mm_unpacklo_epi64( _mm_loadl_epi64( (const __m128i *)( p + 2 ) ), _mm_loadl_epi64( (const __m128i *)( p + 12 ) ) );
+    r1 = _mm_unpacklo_epi64( _mm_loadl_epi64( (const __m128i *)( p + 22 ) ), _mm_loadl_epi64( (const __m128i *)( p + 32 ) ) );
+    r2 = _mm_unpacklo_epi64( _mm_loadl_epi64( (const __m128i *)( p + 42 ) ), _mm_loadl_epi64( (const __m128i *)( p + 52 ) ) );
+    r3 = _mm_unpacklo_epi64( _mm_loadl_epi64( (const __m128i *)( p + 62 ) ), _mm_loadl_epi64( (const __m128i *)( p + 72 ) ) );
+    t0 = _mm_unpacklo_epi16( r0, r1 );
+    t1 = _mm_unpackhi_epi16( r0, r1 );
+    t2 = _mm_unpacklo_epi16( r2, r3 );
+    t3 = _mm_unpackhi_epi16( r2, r3 );
+    r0 = _mm_unpacklo_epi16( t0, t1 );
+    r1 = _mm_unpackhi_epi16( t0, t1 );
+    r2 = _mm_unpacklo_epi16( t2, t3 );
+    r3 = _mm_unpackhi_epi16( t2, t3 );
+    pm25 = _mm_unpacklo_epi64( r0, r2 );
+    pm10 = _mm_unpackhi_epi64( r0, r2 );
+    id = _mm_unpacklo_epi64( r1, r3 );
+    check = _mm_unpackhi_epi64( r1, r3 );
+    h = _mm_setr_epi16( (short)word( p ), (short)word( p + 10 ), (short)word( p + 20 ), (short)word( p + 30 ),
+                        (short)word( p + 40 ), (short)word( p + 50 ), (short)word( p + 60 ), (short)word( p + 70 ) );
+
+    sum = _mm_add_epi16( _mm_add_epi16( _mm_and_si128( pm25, low ), _mm_srli_epi16( pm25, 8 ) ),
+                         _mm_add_epi16( _mm_and_si128( pm10, low ), _mm_srli_epi16( pm10, 8 ) ) );
+    sum = _mm_add_epi16( sum, _mm_add_epi16( _mm_and_si128( id, low ), _mm_srli_epi16( id, 8 ) ) );
+    ok = _mm_and_si128( _mm_cmpeq_epi16( _mm_and_si128( _mm_xor_si128( sum, check ), low ), _mm_setzero_si128() ),
+                        _mm_and_si128( _mm_cmpeq_epi16( _mm_srli_epi16( check, 8 ), tail ), _mm_cmpeq_epi16( h, head ) ) );
+    ok = _mm_packs_epi16( ok, ok );
+
+    _mm_storeu_si128( (__m128i *)( out.pm25 + i ), pm25 );
+    _mm_storeu_si128( (__m128i *)( out.pm10 + i ), pm10 );
+    _mm_storeu_si128( (__m128i *)( out.id + i ), id );
+    _mm_storel_epi64( (__m128i *)( out.valid + i ), _mm_and_si128( ok, one ) );
+    valid += __builtin_popcount( _mm_movemask_epi8( ok ) & 0xff );
+  }
+#elif !defined(SDS011_BATCH_SCALAR) && defined(__ARM_NEON) && defined(__aarch64__)
+  const uint16x8_t low = vdupq_n_u16( 0xff );
+  uint16x8_t r0, r1, r2, r3, t0, t1, t2, t3, pm25, pm10, id, check, h, sum, ok;
+  uint16_t heads[8];
+  uint8x8_t flags;
+  const uint8_t *p;
+  int k;
+
+  for ( ; i + 8 <= count; i += 8 )
+  {
+    p = frames + i * SDS011_REPLY_LEN;
+    // two frames per register: DATA1..DATA6, check-sum, tail
+    r0 = vcombine_u16( vreinterpret_u16_u8( vld1_u8( p + 2 ) ), vreinterpret_u16_u8( vld1_u8( p + 12 ) ) );
+    r1 = vcombine_u16( vreinterpret_u16_u8( vld1_u8( p + 22 ) ), vreinterpret_u16_u8( vld1_u8( p + 32 ) ) );
+    r2 = vcombine_u16( vreinterpret_u16_u8( vld1_u8( p + 42 ) ), vreinterpret_u16_u8( vld1_u8( p + 52 ) ) );
+    r3 = vcombine_u16( vreinterpret_u16_u8( vld1_u8( p + 62 ) ), vreinterpret_u16_u8( vld1_u8( p + 72 ) ) );
+    t0 = vuzp1q_u16( r0, r1 );
+    t1 = vuzp2q_u16( r0, r1 );
+    t2 = vuzp1q_u16( r2, r3 );
+    t3 = vuzp2q_u16( r2, r3 );
+    pm25 = vuzp1q_u16( t0, t2 );
+    id = vuzp2q_u16( t0, t2 );
+    pm10 = vuzp1q_u16( t1, t3 );
+    check = vuzp2q_u16( t1, t3 );
+    for ( k = 0; k < 8; ++k ) heads[k] = word( p + k * SDS011_REPLY_LEN );
+    h = vld1q_u16( heads );
+
+    // adds the two bytes of every lane
+    sum = vaddq_u16( vaddq_u16( vpaddlq_u8( vreinterpretq_u8_u16( pm25 ) ), vpaddlq_u8( vreinterpretq_u8_u16( pm10 ) ) ),
+                     vpaddlq_u8( vreinterpretq_u8_u16( id ) ) );
+    ok = vandq_u16( vceqq_u16( vandq_u16( sum, low ), vandq_u16( check, low ) ),
+                    vandq_u16( vceqq_u16( vshrq_n_u16( check, 8 ), vdupq_n_u16( MSG_TAIL ) ),
+                               vceqq_u16( h, vdupq_n_u16( MSG_HEAD | ( REPLY_DATA << 8 ) ) ) ) );
+    flags = vand_u8( vmovn_u16( ok ), vdup_n_u8( 1 ) );
+
+    vst1q_u16( out.pm25 + i, pm25 );
+    vst1q_u16( out.pm10 + i, pm10 );
+    vst1q_u16( out.id + i, id );
+    vst1_u8( out.valid + i, flags );
+    valid += vaddv_u8( flags );
+  }
+#endif
+  for ( ; i < count; ++i ) valid += decodeOne( frames + i * SDS011_REPLY_LEN, out, i );
+  return( valid );
+}
+
+/**************************************************************************/
+/*!
+    @brief  converts 0.1 ug/m3 values to float ug/m3, bit for bit as
+    sds011DeciToFloat() does
+    @param deci the values
+    @param out receives count floats
+    @param count number of values
+    @returns void
+*/
+/**************************************************************************/
+void sds011DeciToFloatBatch( const uint16_t *deci, float *out, size_t count ) {
+  size_t i = 0;
+#if !defined(SDS011_BATCH_SCALAR) && defined(__SSE2__)
+  const __m128 tenth = _mm_set1_ps( 0.1f );
+  const __m128i zero = _mm_setzero_si128();
+  __m128i v;
+
+  for ( ; i + 8 <= count; i += 8 )
+  {
+    v = _mm_loadu_si128( (const __m128i *)( deci + i ) );
+    _mm_storeu_ps( out + i, _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( v, zero ) ), tenth ) );
+    _mm_storeu_ps( out + i + 4, _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( v, zero ) ), tenth ) );
+  }
+#elif !defined(SDS011_BATCH_SCALAR) && defined(__ARM_NEON) && defined(__aarch64__)
+  uint16x8_t v;
+
+  for ( ; i + 8 <= count; i += 8 )
+  {
+    v = vld1q_u16( deci + i );
+    vst1q_f32( out + i, vmulq_n_f32( vcvtq_f32_u32( vmovl_u16( vget_low_u16( v ) ) ), 0.1f ) );
+    vst1q_f32( out + i + 4, vmulq_n_f32( vcvtq_f32_u32( vmovl_u16( vget_high_u16( v ) ) ), 0.1f ) );
+  }
+#endif
+  for ( ; i < count; ++i ) out[i] = sds011DeciToFloat( deci[i] );
+}
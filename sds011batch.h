@@ -0,0 +1,48 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (batch frame decoder interface)
+
+/// @file sds011batch.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Decodes many data replies at once, for gateways and servers receiving
+/// frames from a lot of sensors. The input is a contiguous array of 10 byte
+/// frames, the output structure-of-arrays: id, PM2.5 and PM10 (0.1 ug/m3)
+/// and a valid flag per frame. A frame is valid when header, the data reply
+/// id C0, the DATA1..DATA6 check-sum and the tail are right; the values of
+/// an invalid frame are decoded all the same and must be ignored.
+///
+/// The kernels use SSE2 on x86-64 and NEON on AArch64 and fall back to
+/// portable code elsewhere, e.g. on the ESP32, or when SDS011_BATCH_SCALAR
+/// is defined. sds011bench compares both.
+
+#ifndef PM_SDS011_BATCH_h
+#define PM_SDS011_BATCH_h
+
+#include "sds011sample.h"
+
+#if !defined(SDS011_BATCH_SCALAR) && defined(__SSE2__)
+/// name of the kernels in use
+#define SDS011_BATCH_KERNEL "sse2"
+#elif !defined(SDS011_BATCH_SCALAR) && defined(__ARM_NEON) && defined(__aarch64__)
+#define SDS011_BATCH_KERNEL "neon"
+#else
+#define SDS011_BATCH_KERNEL "scalar"
+#endif
+
+/// decoded frames, one entry per input frame in every array
+struct sds011Batch {
+	/// device ids, ID byte 1 as the lower byte
+	uint16_t *id;
+	/// PM2.5 in 0.1 ug/m3
+	uint16_t *pm25;
+	/// PM10 in 0.1 ug/m3
+	uint16_t *pm10;
+	/// 1 for a valid data frame, 0 otherwise
+	uint8_t *valid;
+};
+
+size_t sds011DecodeBatch( const uint8_t *frames, size_t count, const sds011Batch &out );
+size_t sds011DecodeBatchScalar( const uint8_t *frames, size_t count, const sds011Batch &out );
+void sds011DeciToFloatBatch( const uint16_t *deci, float *out, size_t count );
+
+#endif
@@ -0,0 +1,210 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (cadence-locked auto report reader implementation)
+
+/// @file sds011cadence.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011cadence.h"
+#include "sds011frame.h"
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011Cadence::sds011Cadence(void) {
+  reset();
+}
+
+/**************************************************************************/
+/*!
+    @brief  forgets the cadence, e.g. after the work period was changed
+    @returns void
+*/
+/**************************************************************************/
+void sds011Cadence::reset(void) {
+  _last = 0;
+  _period = 0;
+  _jitter = 0;
+  _frames = 0;
+  _consistent = 0;
+  _gaps = 0;
+  _late = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  time a frame may be behind its slot before it counts as late
+    @returns the tolerance in ms
+*/
+/**************************************************************************/
+uint32_t sds011Cadence::tolerance(void) const {
+  uint32_t t = 4 * jitter() + SDS011_CADENCE_GUARD;
+
+  return( t > period() / 4 ? period() / 4 : t );
+}
+
+/**************************************************************************/
+/*!
+    @brief  takes the arrival of a data frame
+    @param time millis() of the arrival
+    @returns number of frames missed before this one, at most 65535;
+    gaps() counts them all
+*/
+/**************************************************************************/
+uint16_t sds011Cadence::observe( uint32_t time ) {
+  uint32_t dt = time - _last, n, err;
+  // the interval in 1/16 ms, 64 bits as gaps past 2^28 ms (74.6 h) do not fit 32
+  uint64_t scaled = (uint64_t)dt << 4, slots;
+  int32_t diff;
+
+  if ( _frames++ == 0 )
+  {
+    _last = time;
+    return( 0 );
+  }
+  if ( _period == 0 || ( !locked() && dt >= SDS011_CADENCE_MIN && scaled < (uint64_t)_period * 3 / 4 ) )
+  {
+    // first interval, or a shorter one while learning: the earlier one spanned a lost frame
+    if ( dt < SDS011_CADENCE_MIN ) return( 0 );
+    _last = time;
+    // too long for a period in 1/16 ms: no period to learn, start from this frame
+    if ( scaled > 0xffffffffUL ) return( 0 );
+    _period = (uint32_t)scaled;
+    _jitter = 0;
+    _consistent = 0;
+    return( 0 );
+  }
+
+  slots = ( scaled + _period / 2 ) / _period;
+  // off the grid: a reply to a query between two reports
+  if ( slots == 0 ) return( 0 );
+  // within half a period of the grid, so it fits 32 bits
+  diff = (int32_t)( (int64_t)scaled - (int64_t)( slots * _period ) );
+  err = diff < 0 ? -diff : diff;
+  if ( err > _period / 4 )
+  {
+    // far from any slot: the sensor was reconfigured or restarted, learn again
+    _consistent = 0;
+    _period = 0;
+    _last = time;
+    return( 0 );
+  }
+  // at most 2^32 ms of 200 ms or more
+  n = (uint32_t)slots;
+  // period += ( dt / n - period ) / 8, jitter += ( |err| - jitter ) / 4
+  _period = (uint32_t)( (int32_t)_period + diff / (int32_t)( 8 * n ) );
+  _jitter += ( (int32_t)err - (int32_t)_jitter ) / 4;
+  if ( _consistent < SDS011_CADENCE_LOCK ) ++_consistent;
+  if ( diff > 0 && ( (uint32_t)diff >> 4 ) > tolerance() ) ++_late;
+  _gaps += n - 1;
+  _last = time;
+  return( (uint16_t)( n - 1 > 0xffff ? 0xffff : n - 1 ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  expected arrival of the next frame. A slot stays expected for a
+    quarter period after its time, frames later than that are taken as
+    missed and the following slot is expected.
+    @param now millis()
+    @returns millis() of the expected arrival, now while not locked
+*/
+/**************************************************************************/
+uint32_t sds011Cadence::next( uint32_t now ) const {
+  uint32_t p = period(), since = now - _last;
+
+  if ( !locked() || p == 0 ) return( now );
+  if ( since <= p + p / 4 ) return( _last + p );
+  return( _last + ( ( since - p / 4 + p - 1 ) / p ) * p );
+}
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011CadenceReader::sds011CadenceReader(void) : _uart(NULL), _id_1(MSG_FF), _id_2(MSG_FF), _missed(0) {
+}
+
+/**************************************************************************/
+/*!
+    @brief  starts reading auto reports; put the sensor in auto report mode first
+    @param transport the transport connected to the sensor
+    @param id_1 id byte 1 of the sensor, MSG_FF for any
+    @param id_2 id byte 2 of the sensor, MSG_FF for any
+    @returns false without a transport
+*/
+/**************************************************************************/
+bool sds011CadenceReader::begin( sds011Transport *transport, uint8_t id_1, uint8_t id_2 ) {
+  _uart = transport;
+  _id_1 = id_1;
+  _id_2 = id_2;
+  _missed = 0;
+  _parser.reset();
+  _cadence.reset();
+  return( transport != NULL );
+}
+
+/**************************************************************************/
+/*!
+    @brief  takes the next data frame received, without waiting
+    @param sample the decoded frame, stamped with its arrival
+    @returns true when a frame was read
+*/
+/**************************************************************************/
+bool sds011CadenceReader::read( sds011Sample *sample ) {
+  const uint8_t *frame;
+
+  if ( _uart == NULL ) return( false );
+  while ( _uart->available() > 0 )
+  {
+    if ( !_parser.push( (uint8_t)_uart->read() ) ) continue;
+    frame = _parser.frame();
+    if ( frame[1] != REPLY_DATA ) continue;
+    if ( ( _id_1 != MSG_FF || _id_2 != MSG_FF ) && ( frame[6] != _id_1 || frame[7] != _id_2 ) ) continue;
+    sample->time = millis();
+    sample->id = sds011ReplyId( frame );
+    sample->pm25 = sds011ReplyPm25( frame );
+    sample->pm10 = sds011ReplyPm10( frame );
+    _missed = _cadence.observe( sample->time );
+    return( true );
+  }
+  return( false );
+}
+
+/**************************************************************************/
+/*!
+    @brief  time the application may spend elsewhere before the next frame
+    @returns ms until just before the next expected frame, 0 when it is due
+    or the cadence is not known yet
+*/
+/**************************************************************************/
+uint32_t sds011CadenceReader::idle(void) const {
+  uint32_t now = millis(), wake = _cadence.next( now ) - SDS011_CADENCE_GUARD;
+
+  return( (int32_t)( wake - now ) > 0 ? wake - now : 0 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  waits for the next data frame, idling until just before it is due
+    @param sample the decoded frame, stamped with its arrival
+    @param timeout longest wait in ms
+    @returns false when no frame arrived in time
+*/
+/**************************************************************************/
+bool sds011CadenceReader::wait( sds011Sample *sample, uint32_t timeout ) {
+  uint32_t start = millis(), rest, pause;
+
+  for(;;)
+  {
+    if ( read( sample ) ) return( true );
+    rest = timeout - ( millis() - start );
+    if ( (int32_t)rest <= 0 ) return( false );
+    pause = idle();
+    // a byte takes about 1 ms at 9600 baud
+    if ( pause == 0 ) pause = 1;
+    delay( pause < rest ? pause : rest );
+  }
+}
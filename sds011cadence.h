@@ -0,0 +1,90 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (cadence-locked auto report reader interface)
+
+/// @file sds011cadence.h
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#ifndef PM_SDS011_CADENCE_h
+#define PM_SDS011_CADENCE_h
+
+#include "sds011lib.h"
+
+/// time to wake up before an expected frame in ms, about two bytes at 9600 baud
+#define SDS011_CADENCE_GUARD 3
+/// consistent intervals before the cadence counts as locked
+#define SDS011_CADENCE_LOCK 3
+/// shortest report interval taken for a period in ms; closer frames are query replies
+#define SDS011_CADENCE_MIN 200
+
+/// learns the period and phase of the auto reports from the arrival times
+/// of data frames. Frames are placed on the grid of the period: an interval
+/// of n periods means n - 1 frames were missed, a frame well off the grid
+/// (a reply to a query) is not counted. The period follows slow drift of
+/// the sensor clock.
+class sds011Cadence {
+	public:
+		sds011Cadence(void);
+		void reset(void);
+		uint16_t observe( uint32_t time );
+		uint32_t next( uint32_t now ) const;
+		/// true once the period is known
+		bool locked(void) const { return( _consistent >= SDS011_CADENCE_LOCK ); }
+		/// learned report period in ms, 0 while unknown
+		uint32_t period(void) const { return( ( _period + 8 ) >> 4 ); }
+		/// mean deviation of the arrivals from the grid in ms
+		uint32_t jitter(void) const { return( ( _jitter + 8 ) >> 4 ); }
+		/// time a frame may arrive after its slot before it counts as late, in ms
+		uint32_t tolerance(void) const;
+		/// frames missed in total
+		uint32_t gaps(void) const { return( _gaps ); }
+		/// frames arrived later than tolerance() after their slot
+		uint32_t late(void) const { return( _late ); }
+	private:
+		/// arrival of the last frame on the grid
+		uint32_t _last;
+		/// period in 1/16 ms
+		uint32_t _period;
+		/// mean absolute deviation in 1/16 ms
+		uint32_t _jitter;
+		/// frames seen
+		uint32_t _frames;
+		/// intervals in a row that matched the period
+		uint8_t _consistent;
+		/// frames missed
+		uint32_t _gaps;
+		/// late frames
+		uint32_t _late;
+};
+
+/// reads auto reports in step with the sensor. wait() idles (delay(),
+/// which lets the ESP32 light-sleep) until just before the next expected
+/// frame, then polls closely, so the sample reaches the application within
+/// about a millisecond of its last byte. Bytes arriving meanwhile wait in
+/// the UART buffer, so nothing is lost while idling.
+class sds011CadenceReader {
+	public:
+		sds011CadenceReader(void);
+		bool begin( sds011Transport *transport, uint8_t id_1 = MSG_FF, uint8_t id_2 = MSG_FF );
+		bool read( sds011Sample *sample );
+		bool wait( sds011Sample *sample, uint32_t timeout );
+		uint32_t idle(void) const;
+		/// frames missed right before the last sample
+		uint16_t missed(void) const { return( _missed ); }
+		/// the learned cadence
+		const sds011Cadence &cadence(void) const { return( _cadence ); }
+	private:
+		/// the transport connected to the sensor
+		sds011Transport *_uart;
+		/// the reply frame parser
+		sds011Parser _parser;
+		/// the cadence of the reports
+		sds011Cadence _cadence;
+		/// id byte 1 of the sensor, MSG_FF for any
+		uint8_t _id_1;
+		/// id byte 2 of the sensor, MSG_FF for any
+		uint8_t _id_2;
+		/// frames missed before the last sample
+		uint16_t _missed;
+};
+
+#endif
@@ -0,0 +1,259 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (raw UART capture implementation)
+
+/// @file sds011capture.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011capture.h"
+
+#if defined(ESP32)
+#include "esp_timer.h"
+#endif
+
+/// the header starting every capture
+static const uint8_t captureHeader[SDS011_CAPTURE_HEADER] = { 'S', 'D', 'S', 'C', 2, 0, 0, 0 };
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011CaptureTransport::sds011CaptureTransport(void) : _inner(NULL), _sink(NULL), _ctx(NULL), _len(0), _chunkLen(0), _bytes(0), _lost(0) {
+}
+
+/**************************************************************************/
+/*!
+    @brief  starts a capture; the header is written with the first save()
+    @param inner the transport to the sensor
+    @param sink receives the capture, e.g. a file or SD card writer
+    @param ctx passed to sink
+    @returns void
+*/
+/**************************************************************************/
+void sds011CaptureTransport::begin( sds011Transport *inner, sds011LogSink sink, void *ctx ) {
+  _inner = inner;
+  _sink = sink;
+  _ctx = ctx;
+  memcpy( _buf, captureHeader, SDS011_CAPTURE_HEADER );
+  _len = SDS011_CAPTURE_HEADER;
+  _chunkLen = 0;
+#if defined(ESP32)
+  _clock = (uint64_t)esp_timer_get_time();
+#else
+  _clockAt = micros();
+  _clock = 0;
+#endif
+  _prevAt = 0;
+  _bytes = 0;
+  _lost = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  reads a byte from the sensor and records it
+    @returns the byte, -1 when none is available
+*/
+/**************************************************************************/
+int sds011CaptureTransport::read(void) {
+  int c = _inner->read();
+  uint8_t b;
+
+  if ( c >= 0 )
+  {
+    b = (uint8_t)c;
+    record( SDS011_CAPTURE_RX, &b, 1, now() );
+  }
+  return( c );
+}
+
+/**************************************************************************/
+/*!
+    @brief  writes bytes to the sensor and records them
+    @param buf the bytes
+    @param len number of bytes
+    @returns number of bytes accepted
+*/
+/**************************************************************************/
+size_t sds011CaptureTransport::write( const uint8_t *buf, size_t len ) {
+  size_t n = _inner->write( buf, len );
+
+  record( SDS011_CAPTURE_TX, buf, n, now() );
+  return( n );
+}
+
+/**************************************************************************/
+/*!
+    @brief  64 bit microseconds since begin(). On ESP32 the 64 bit system
+    timer is read; elsewhere the wrapping micros() is extended, which needs
+    a read(), write() or available() at least every 71 minutes, as a
+    library waiting for a reply or a report does.
+    @returns the time in us
+*/
+/**************************************************************************/
+uint64_t sds011CaptureTransport::now(void) {
+#if defined(ESP32)
+  return( (uint64_t)esp_timer_get_time() - _clock );
+#else
+  unsigned long us = micros();
+
+  _clock += (unsigned long)( us - _clockAt );
+  _clockAt = us;
+  return( _clock );
+#endif
+}
+
+/**************************************************************************/
+/*!
+    @brief  records bytes, also usable on its own for bytes seen elsewhere
+    (a sniffer on the line, a generator). Received bytes extend the open
+    chunk while they follow within SDS011_CAPTURE_GAP.
+    @param dir SDS011_CAPTURE_RX or SDS011_CAPTURE_TX
+    @param buf the bytes
+    @param len number of bytes
+    @param now time in us, 64 bit so it does not wrap
+    @returns void
+*/
+/**************************************************************************/
+void sds011CaptureTransport::record( uint8_t dir, const uint8_t *buf, size_t len, uint64_t now ) {
+  size_t n;
+
+  if ( _chunkLen && ( dir != _dir || dir == SDS011_CAPTURE_TX || now - _lastAt > SDS011_CAPTURE_GAP ) ) close();
+  while ( len )
+  {
+    if ( _chunkLen == 0 )
+    {
+      _dir = dir;
+      _chunkAt = now;
+    }
+    n = len < (size_t)( SDS011_CAPTURE_CHUNK - _chunkLen ) ? len : SDS011_CAPTURE_CHUNK - _chunkLen;
+    memcpy( _chunk + _chunkLen, buf, n );
+    _chunkLen += n;
+    _bytes += n;
+    buf += n;
+    len -= n;
+    if ( _chunkLen == SDS011_CAPTURE_CHUNK ) close();
+  }
+  _lastAt = now;
+  // a command goes out in one write, its chunk is complete
+  if ( dir == SDS011_CAPTURE_TX ) close();
+}
+
+/**************************************************************************/
+/*!
+    @brief  encodes the open chunk into the buffer, handing the buffer to
+    the sink first when the chunk does not fit
+    @returns void
+*/
+/**************************************************************************/
+void sds011CaptureTransport::close(void) {
+  uint64_t dt = _chunkAt - _prevAt;
+
+  if ( _chunkLen == 0 ) return;
+  if ( _len + 10 + 1 + _chunkLen > SDS011_CAPTURE_BUFFER ) drain();
+  while ( dt >= 0x80 )
+  {
+    _buf[_len++] = (uint8_t)( dt | 0x80 );
+    dt >>= 7;
+  }
+  _buf[_len++] = (uint8_t)dt;
+  _buf[_len++] = (uint8_t)( ( _chunkLen << 1 ) | _dir );
+  memcpy( _buf + _len, _chunk, _chunkLen );
+  _len += _chunkLen;
+  _prevAt = _chunkAt;
+  _chunkLen = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  hands the buffer to the sink
+    @returns false when the sink did not take all bytes
+*/
+/**************************************************************************/
+bool sds011CaptureTransport::drain(void) {
+  size_t n;
+  bool ok;
+
+  if ( _len == 0 ) return( true );
+  n = _sink ? _sink( _buf, _len, _ctx ) : 0;
+  ok = n >= _len;
+  if ( !ok ) _lost += _len - n;
+  _len = 0;
+  return( ok );
+}
+
+/**************************************************************************/
+/*!
+    @brief  hands everything recorded so far to the sink. The open chunk
+    is closed, so call it when the line is quiet, e.g. before deep sleep.
+    @returns false when the sink did not take all bytes
+*/
+/**************************************************************************/
+bool sds011CaptureTransport::save(void) {
+  close();
+  return( drain() );
+}
+
+/**************************************************************************/
+/*!
+    @brief  starts reading a capture
+    @param data the capture
+    @param len its length
+    @returns false when the header is not a capture header
+*/
+/**************************************************************************/
+bool sds011CaptureReader::begin( const uint8_t *data, size_t len ) {
+  _time = 0;
+  _truncated = false;
+  _pos = _end = data;
+  if ( data == NULL ) return( false );
+  // version 1 wrote pauses up to 32 bit, version 2 up to 64 bit, in the same varint
+  if ( len < SDS011_CAPTURE_HEADER || memcmp( data, captureHeader, 4 ) != 0 || data[4] < 1 || data[4] > 2 )
+  {
+    _truncated = true;
+    return( false );
+  }
+  _pos = data + SDS011_CAPTURE_HEADER;
+  _end = data + len;
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  reads the next chunk
+    @param chunk the chunk, its data points into the capture
+    @returns false at the end of the capture
+*/
+/**************************************************************************/
+bool sds011CaptureReader::next( sds011CaptureChunk *chunk ) {
+  const uint8_t *p = _pos;
+  uint64_t dt = 0;
+  uint8_t shift = 0, head;
+
+  if ( p >= _end ) return( false );
+  do
+  {
+    if ( p >= _end || shift > 63 ) break;
+    dt |= (uint64_t)( *p & 0x7f ) << shift;
+    shift += 7;
+  } while ( *p++ & 0x80 );
+  if ( p >= _end || ( p[-1] & 0x80 ) )
+  {
+    _truncated = true;
+    _pos = _end;
+    return( false );
+  }
+  head = *p++;
+  if ( ( head >> 1 ) == 0 || ( head >> 1 ) > SDS011_CAPTURE_CHUNK || p + ( head >> 1 ) > _end )
+  {
+    _truncated = true;
+    _pos = _end;
+    return( false );
+  }
+  _time += dt;
+  chunk->time = _time;
+  chunk->dir = head & 1;
+  chunk->len = head >> 1;
+  chunk->data = p;
+  _pos = p + chunk->len;
+  return( true );
+}
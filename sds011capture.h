@@ -0,0 +1,133 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (raw UART capture)
+
+/// @file sds011capture.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Records the raw bytes between the library and the sensor, both
+/// directions, with their times, so a misbehaving unit can be reproduced
+/// offline. A capture is an 8 byte header followed by chunks:
+///
+/// | Size    | Capture header                                  |
+/// | :-----: | :---------------------------------------------- |
+/// | 4       | magic "SDSC"                                    |
+/// | 1       | version, 2                                      |
+/// | 3       | reserved, 0                                     |
+///
+/// | Size    | Chunk                                           |
+/// | :-----: | :---------------------------------------------- |
+/// | 1 - 10  | varint: microseconds since the previous chunk   |
+/// | 1       | length << 1 \| direction (0: received, 1: sent) |
+/// | length  | the bytes, 1 to SDS011_CAPTURE_CHUNK            |
+///
+/// Received bytes are gathered into one chunk while they follow each other
+/// within SDS011_CAPTURE_GAP, so a report a second takes 14 bytes: 10 bytes
+/// of data, 3 of time and the length. Times are 64 bit, so a pause of hours
+/// or days between chunks (deep sleep, long work periods) replays as
+/// recorded; version 1 captures, with pauses below 2^32 us, read the same.
+
+#ifndef PM_SDS011_CAPTURE_h
+#define PM_SDS011_CAPTURE_h
+
+#include "sds011transport.h"
+#include "sds011log.h"
+
+/// bytes buffered before they are handed to the sink
+#define SDS011_CAPTURE_BUFFER 256
+/// largest chunk, in bytes of data
+#define SDS011_CAPTURE_CHUNK 64
+#ifndef SDS011_CAPTURE_GAP
+/// a longer pause between received bytes in us starts a new chunk, about 3 byte times at 9600 baud
+#define SDS011_CAPTURE_GAP 3000
+#endif
+/// length of the capture header
+#define SDS011_CAPTURE_HEADER 8
+/// chunk direction: bytes from the sensor
+#define SDS011_CAPTURE_RX 0
+/// chunk direction: bytes to the sensor
+#define SDS011_CAPTURE_TX 1
+
+/// transport wrapper recording all bytes read from and written to another
+/// transport. Give it to sds011::begin() in place of the real transport.
+class sds011CaptureTransport : public sds011Transport {
+	public:
+		sds011CaptureTransport(void);
+		void begin( sds011Transport *inner, sds011LogSink sink, void *ctx = NULL );
+		int available(void) { now(); return( _inner->available() ); }
+		int read(void);
+		size_t write( const uint8_t *buf, size_t len );
+		void flush(void) { _inner->flush(); }
+		void record( uint8_t dir, const uint8_t *buf, size_t len, uint64_t now );
+		bool save(void);
+		/// bytes recorded, both directions
+		uint32_t bytes(void) const { return( _bytes ); }
+		/// bytes of the capture the sink did not take
+		uint32_t lost(void) const { return( _lost ); }
+	private:
+		/// the transport to the sensor
+		sds011Transport *_inner;
+		/// receives the capture
+		sds011LogSink _sink;
+		/// context for _sink
+		void *_ctx;
+		/// encoded chunks not yet handed to the sink
+		uint8_t _buf[SDS011_CAPTURE_BUFFER];
+		/// bytes in _buf
+		uint16_t _len;
+		/// data of the open chunk
+		uint8_t _chunk[SDS011_CAPTURE_CHUNK];
+		/// bytes in _chunk, 0 when no chunk is open
+		uint8_t _chunkLen;
+		/// direction of the open chunk
+		uint8_t _dir;
+		/// time of the first byte of the open chunk
+		uint64_t _chunkAt;
+		/// time of the last byte of the open chunk
+		uint64_t _lastAt;
+		/// time of the previous chunk written
+		uint64_t _prevAt;
+		/// micros() at the last now()
+		unsigned long _clockAt;
+		/// 64 bit microseconds at the last now(); on ESP32 the system timer at begin()
+		uint64_t _clock;
+		/// bytes recorded
+		uint32_t _bytes;
+		/// bytes lost at the sink
+		uint32_t _lost;
+		void close(void);
+		bool drain(void);
+		uint64_t now(void);
+};
+
+/// one chunk of a capture
+struct sds011CaptureChunk {
+	/// microseconds since the capture started
+	uint64_t time;
+	/// SDS011_CAPTURE_RX or SDS011_CAPTURE_TX
+	uint8_t dir;
+	/// number of bytes
+	uint8_t len;
+	/// the bytes, inside the capture
+	const uint8_t *data;
+};
+
+/// reader over a capture held in memory, e.g. mapped with sds011LogFile
+class sds011CaptureReader {
+	public:
+		sds011CaptureReader(void) { begin( NULL, 0 ); }
+		bool begin( const uint8_t *data, size_t len );
+		bool next( sds011CaptureChunk *chunk );
+		/// true when the capture ended inside a chunk or has a bad header
+		bool truncated(void) const { return( _truncated ); }
+	private:
+		/// read position
+		const uint8_t *_pos;
+		/// end of the capture
+		const uint8_t *_end;
+		/// time of the previous chunk
+		uint64_t _time;
+		/// set by a bad header or a cut chunk
+		bool _truncated;
+};
+
+#endif
@@ -0,0 +1,151 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (clock implementation)
+
+/// @file sds011clock.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011clock.h"
+
+#ifdef ARDUINO
+
+/**************************************************************************/
+/*!
+    @brief  microseconds of the Arduino core
+    @returns microseconds, wrapping
+*/
+/**************************************************************************/
+unsigned long sds011RealClock::micros(void) {
+  return( ::micros() );
+}
+
+/**************************************************************************/
+/*!
+    @brief  milliseconds of the Arduino core
+    @returns milliseconds
+*/
+/**************************************************************************/
+unsigned long sds011RealClock::millis(void) {
+  return( ::millis() );
+}
+
+/**************************************************************************/
+/*!
+    @brief  waits with the Arduino delay(), which lets other tasks run
+    @param ms milliseconds to wait
+    @returns void
+*/
+/**************************************************************************/
+void sds011RealClock::delay( unsigned long ms ) {
+  ::delay( ms );
+}
+
+/**************************************************************************/
+/*!
+    @brief  the Arduino yield()
+    @returns void
+*/
+/**************************************************************************/
+void sds011RealClock::yield(void) {
+  ::yield();
+}
+
+#elif SDS011_HOST
+
+#include <time.h>
+#include <sched.h>
+
+/// the clock behind millis(), micros(), delay() and yield()
+static sds011RealClock realClock;
+/// the installed clock
+static sds011Clock *current = &realClock;
+
+/**************************************************************************/
+/*!
+    @brief  monotonic time
+    @returns CLOCK_MONOTONIC in microseconds
+*/
+/**************************************************************************/
+static int64_t monotonic(void) {
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  return( now.tv_sec * 1000000LL + now.tv_nsec / 1000 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  monotonic microseconds since the first call, as on Arduino
+    @returns microseconds, wrapping like the Arduino counter
+*/
+/**************************************************************************/
+unsigned long sds011RealClock::micros(void) {
+  // initialized once, also when the main and a receiver thread make the first call together
+  static const int64_t start = monotonic();
+
+  return( (unsigned long)( monotonic() - start ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  monotonic milliseconds since the first call, as on Arduino
+    @returns milliseconds
+*/
+/**************************************************************************/
+unsigned long sds011RealClock::millis(void) {
+  return( micros() / 1000 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  sleeps the calling thread
+    @param ms milliseconds to sleep
+    @returns void
+*/
+/**************************************************************************/
+void sds011RealClock::delay( unsigned long ms ) {
+  struct timespec t;
+
+  t.tv_sec = ms / 1000;
+  t.tv_nsec = ( ms % 1000 ) * 1000000L;
+  while ( nanosleep( &t, &t ) != 0 ) { }
+}
+
+/**************************************************************************/
+/*!
+    @brief  gives up the processor, as the Arduino yield()
+    @returns void
+*/
+/**************************************************************************/
+void sds011RealClock::yield(void) {
+  sched_yield();
+}
+
+/**************************************************************************/
+/*!
+    @brief  installs the clock behind millis(), micros(), delay() and
+    yield() for the whole program. Install it before threads are started
+    and with no command in flight; the time jumps to the new clock. A clock
+    that is not threadSafe(), as the virtual one, must not be installed
+    while an sds011Receiver thread runs.
+    @param clock the clock, NULL for the real one
+    @returns the clock installed before
+*/
+/**************************************************************************/
+sds011Clock *sds011UseClock( sds011Clock *clock ) {
+  sds011Clock *previous = current;
+
+  current = clock ? clock : &realClock;
+  return( previous );
+}
+
+/**************************************************************************/
+/*!
+    @brief  the installed clock
+    @returns the clock behind millis() and delay()
+*/
+/**************************************************************************/
+sds011Clock *sds011CurrentClock(void) {
+  return( current );
+}
+
+#endif
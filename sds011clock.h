@@ -0,0 +1,78 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (clock interface)
+
+/// @file sds011clock.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// The library reads time with millis() and micros() and waits with
+/// delay(), as on Arduino. On a Linux host these calls go through an
+/// sds011Clock: the real clock by default, or an sds011VirtualClock
+/// installed with sds011UseClock(). Virtual time only moves when someone
+/// waits, so a command that times out after seconds returns at once, the
+/// software sensor's replies are timed against the same clock, and every
+/// run of a scenario takes exactly the same number of milliseconds. On
+/// Arduino the core's calls stay in charge; the classes can still drive
+/// code that takes the time as an argument.
+
+#ifndef PM_SDS011_CLOCK_h
+#define PM_SDS011_CLOCK_h
+
+#include "sds011port.h"
+
+/// source of time and waits
+class sds011Clock {
+	public:
+		virtual ~sds011Clock(void) {}
+		/// microseconds, wrapping like the Arduino counter
+		virtual unsigned long micros(void) = 0;
+		/// milliseconds
+		virtual unsigned long millis(void) = 0;
+		/// waits ms milliseconds
+		virtual void delay( unsigned long ms ) = 0;
+		/// gives up the processor
+		virtual void yield(void) {}
+		/// true when several threads may read and wait on the clock at once
+		virtual bool threadSafe(void) const { return( true ); }
+};
+
+/// wall clock time: the Arduino core, or CLOCK_MONOTONIC and nanosleep() on a host
+class sds011RealClock : public sds011Clock {
+	public:
+		unsigned long micros(void);
+		unsigned long millis(void);
+		void delay( unsigned long ms );
+		void yield(void);
+};
+
+/// time that moves only when a wait or advance() moves it. Single threaded:
+/// install it for tests and tools that run the library and the software
+/// sensor on one thread. sds011Receiver::start() refuses to run its thread
+/// while it is installed; call service() from the test instead.
+class sds011VirtualClock : public sds011Clock {
+	public:
+		sds011VirtualClock( uint64_t start = 0 ) : _now(start), _waited(0) {}
+		unsigned long micros(void) { return( (unsigned long)_now ); }
+		unsigned long millis(void) { return( (unsigned long)( _now / 1000 ) ); }
+		/// moves the time on at once
+		void delay( unsigned long ms ) { _now += (uint64_t)ms * 1000; _waited += ms; }
+		/// moves the time on by us microseconds
+		void advance( uint64_t us ) { _now += us; }
+		/// virtual microseconds since the start of the count
+		uint64_t now(void) const { return( _now ); }
+		/// false, the time is moved without a lock
+		bool threadSafe(void) const { return( false ); }
+		/// milliseconds spent in delay()
+		uint64_t waited(void) const { return( _waited ); }
+	private:
+		/// the time in microseconds
+		uint64_t _now;
+		/// sum of the delays in ms
+		uint64_t _waited;
+};
+
+#if SDS011_HOST
+sds011Clock *sds011UseClock( sds011Clock *clock );
+sds011Clock *sds011CurrentClock(void);
+#endif
+
+#endif
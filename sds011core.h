@@ -0,0 +1,281 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (request / response core)
+
+/// @file sds011core.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// The protocol code sds011 and sds011Lite<F> share. A command goes out as
+/// one frame, its reply is collected by the parser within the timeout of
+/// sds011timeout.h, and the command is sent again by the rules there. An
+/// auto report met on the way is held back for the next read, and dropped
+/// when a query was answered, as the answer is newer. A setting or id the
+/// reply does not confirm is SDS011_ERR_REFUSED, and after a new id the
+/// sensor is addressed by it, unless all sensors (FF FF) are.
+///
+/// sds011Core is a base of both classes. It takes the class itself, which
+/// provides learn( frame ), called for every valid frame received, and
+/// debug( fmt, ... ); the timeouts, learned (sds011Timeouts) or fixed; and
+/// what holds a report back, sds011Pending<true> or sds011Pending<false>
+/// for nothing. Include sds011lib.h or sds011lite.h rather than this file.
+
+#ifndef PM_SDS011_CORE_h
+#define PM_SDS011_CORE_h
+
+#include <string.h>
+
+#include "sds011frame.h"
+#include "sds011metrics.h"
+#include "sds011result.h"
+#include "sds011transport.h"
+
+/// an auto report received while a command waited for its reply, kept for the next read
+template <bool On>
+struct sds011Pending {
+	sds011Pending(void) : held(false) {}
+	/// keeps a data frame
+	void keep( const uint8_t *frame, unsigned long now ) { memcpy( bytes, frame, SDS011_REPLY_LEN ); time = now; held = true; }
+	/// hands out the frame kept, false when there is none
+	bool take( uint8_t *frame, unsigned long *at ) {
+		if ( !held ) return( false );
+		memcpy( frame, bytes, SDS011_REPLY_LEN );
+		*at = time;
+		held = false;
+		return( true );
+	}
+	/// drops the frame kept
+	void clear(void) { held = false; }
+	/// the frame
+	uint8_t bytes[SDS011_REPLY_LEN];
+	/// millis() when it was received
+	unsigned long time;
+	/// true when bytes holds a frame
+	bool held;
+};
+
+/// nothing is kept, for a sensor that reads no auto reports or sends no commands
+template <>
+struct sds011Pending<false> {
+	void keep( const uint8_t *frame, unsigned long now ) { (void)frame; (void)now; }
+	bool take( uint8_t *frame, unsigned long *at ) { (void)frame; (void)at; return( false ); }
+	void clear(void) {}
+};
+
+/// request / response core of sds011 and sds011Lite<F>, see the top of the file
+template <class Host, class Timeouts, class Pending>
+class sds011Core {
+	public:
+		/// drops the bytes waiting in the transport, the partial frame of the parser and a
+		/// held back report, e.g. after a glitch on the line; returns the number of bytes dropped
+		size_t resync(void) {
+			size_t dropped = _parser.pending();
+
+			_parser.reset();
+			_pending.clear();
+			while ( _uart->available() > 0 && _uart->read() >= 0 ) ++dropped;
+			return( dropped );
+		}
+
+	protected:
+		sds011Core(void) : _uart(NULL), _id_1(MSG_FF), _id_2(MSG_FF) {}
+
+		/// the transport connected to the sensor
+		sds011Transport *_uart;
+		/// the reply frame parser, keeps partial frames between calls
+		sds011Parser _parser;
+		/// reply timeouts, learned or fixed
+		Timeouts _timeouts;
+		/// a data frame received while waiting for another reply
+		Pending _pending;
+		/// id byte 1 of the sensor, MSG_FF for any
+		uint8_t _id_1;
+		/// id byte 2 of the sensor, MSG_FF for any
+		uint8_t _id_2;
+
+		/// attaches the transport (already set up for 9600 8N1) and the device id, and forgets
+		/// what an earlier transport left
+		void attach( sds011Transport *transport, uint8_t id_1, uint8_t id_2 ) {
+			_uart = transport;
+			_id_1 = id_1;
+			_id_2 = id_2;
+			_parser.reset();
+			_timeouts.reset();
+			_pending.clear();
+		}
+
+		/// writes a command frame in one go, see sds011RequestBytes()
+		void send( uint8_t command, uint8_t option_1, uint8_t option_2, uint8_t id_1, uint8_t id_2 ) {
+			sds011Request frame;
+
+			host().debug( "Sending command %02X\n", command );
+			_uart->write( sds011RequestBytes( &frame, command, option_1, option_2, id_1, id_2 ), SDS011_REQUEST_LEN );
+			_uart->flush();
+		}
+
+		/// feeds received bytes to the parser until the reply to command is complete or the deadline
+		/// passed; SDS011_ERR_SILENT when not a byte arrived, SDS011_ERR_NO_REPLY when bytes but not the reply did
+		sds011Error receive( uint8_t command, uint8_t reply[SDS011_REPLY_LEN], unsigned long deadline ) {
+			const uint8_t *frame;
+			bool heard = false;
+
+			for (;;)
+			{
+				while ( _uart->available() )
+				{
+					heard = true;
+					if ( !_parser.push( (uint8_t)_uart->read() ) ) continue;
+					frame = _parser.frame();
+					host().learn( frame );
+					if ( sds011ReplyAnswers( frame, command ) )
+					{
+						memcpy( reply, frame, SDS011_REPLY_LEN );
+						// a report held back is older than the answer to a query
+						if ( command == CMD_QUERY_DATA ) _pending.clear();
+						return( SDS011_OK );
+					}
+					if ( frame[1] == REPLY_DATA ) _pending.keep( frame, millis() );
+					host().debug( " skipped reply %02X %02X\n", frame[1], frame[2] );
+				}
+				if ( (long)( millis() - deadline ) >= 0 ) break;
+				// a byte takes about 1 ms at 9600 baud
+				delay( 1 );
+			}
+			host().debug( "no response, %u bytes of a partial frame kept\n", (unsigned)_parser.pending() );
+			return( heard ? SDS011_ERR_NO_REPLY : SDS011_ERR_SILENT );
+		}
+
+		/// sends a command to the id given and waits for its reply, sending again by the rules of sds011timeout.h
+		sds011Error communicate( uint8_t command, uint8_t option_1, uint8_t option_2, uint8_t id_1, uint8_t id_2,
+		                         uint8_t reply[SDS011_REPLY_LEN] ) {
+			bool wake = command == CMD_SLEEP_AND_WORK && option_1 == WRITE_MODE && option_2 == WORK_MODE;
+			uint8_t silent = 0, wrong = 0;
+			sds011Error outcome;
+			unsigned long start;
+
+			for (;;)
+			{
+				SDS011_METRIC_STAMP( sent );
+				if ( silent + wrong == 0 ) SDS011_METRIC_COUNT( commands ); else SDS011_METRIC_COUNT( retries );
+				start = millis();
+				send( command, option_1, option_2, id_1, id_2 );
+				outcome = receive( command, reply, start + ( wake ? SDS011_WAKE_TIMEOUT : _timeouts.timeout( command ) ) );
+				if ( outcome == SDS011_OK )
+				{
+					// a reply to a resent command may answer the earlier send, do not learn from it
+					if ( silent + wrong == 0 ) _timeouts.observe( command, millis() - start );
+					SDS011_METRIC_LATENCY( command, sent );
+					return( SDS011_OK );
+				}
+				SDS011_METRIC_COUNT( timeouts );
+				// a waking sensor often does not answer, sending again does not help
+				if ( wake ) break;
+				if ( outcome == SDS011_ERR_SILENT )
+				{
+					// nothing at all came back: the sensor sleeps or is gone, wait longer once more
+					_timeouts.expired( command );
+					if ( ++silent >= SDS011_TRIES_SILENT ) break;
+				}else if ( ++wrong >= SDS011_TRIES_WRONG )
+				{
+					// reports or noise got in the way: send again right away
+					break;
+				}
+			}
+			host().debug( "no reply to %02X\n", command );
+			return( outcome );
+		}
+
+		/// sends a reporting mode, sleep / work or work period setting, or reads it with READ_MODE;
+		/// current receives the value of the reply, unchanged when there was none
+		sds011Error configure( uint8_t command, uint8_t wr, uint8_t value, uint8_t *current ) {
+			uint8_t reply[SDS011_REPLY_LEN];
+			sds011Error error;
+
+			if ( ( error = communicate( command, wr, value, _id_1, _id_2, reply ) ) != SDS011_OK ) return( error );
+			*current = sds011ReplyValue( reply );
+			return( wr == WRITE_MODE && *current != value ? SDS011_ERR_REFUSED : SDS011_OK );
+		}
+
+		/// sets a new device id, ID byte 1 as the lower byte, and gives the id of the reply
+		sds011IdResult changeId( uint16_t id ) {
+			sds011IdResult result = { SDS011_OK, 0 };
+			uint8_t reply[SDS011_REPLY_LEN];
+
+			if ( ( result.error = communicate( CMD_SET_DEVICE_ID, (uint8_t)id, (uint8_t)( id >> 8 ), _id_1, _id_2, reply ) ) != SDS011_OK ) return( result );
+			result.id = sds011ReplyId( reply );
+			if ( result.id != id )
+			{
+				host().debug( "Setting Device Id Failed. Tried = %04X, Returned = %04X\n", id, result.id );
+				result.error = SDS011_ERR_REFUSED;
+			}else
+			{
+				useId( (uint8_t)id, (uint8_t)( id >> 8 ) );
+			}
+			return( result );
+		}
+
+		/// addresses the sensor by its new id after a confirmed id change, unless all sensors are addressed
+		void useId( uint8_t id_1, uint8_t id_2 ) {
+			if ( _id_1 != MSG_FF || _id_2 != MSG_FF )
+			{
+				_id_1 = id_1;
+				_id_2 = id_2;
+			}
+		}
+
+		/// the next auto report: one held back, or the next within MAX_WAIT * 20 ms
+		sds011Error report( sds011Sample *sample ) {
+			uint8_t reply[SDS011_REPLY_LEN];
+			unsigned long at;
+			sds011Error error;
+
+			if ( _pending.take( reply, &at ) )
+			{
+				decode( reply, at, sample );
+				return( SDS011_OK );
+			}
+			if ( ( error = receive( CMD_QUERY_DATA, reply, millis() + MAX_WAIT * 20 ) ) != SDS011_OK )
+			{
+				host().debug( "no report\n" );
+				return( error );
+			}
+			decode( reply, millis(), sample );
+			return( SDS011_OK );
+		}
+
+		/// queries one measurement
+		sds011Error measure( sds011Sample *sample ) {
+			uint8_t reply[SDS011_REPLY_LEN];
+			sds011Error error;
+
+			if ( ( error = communicate( CMD_QUERY_DATA, 0, 0, _id_1, _id_2, reply ) ) == SDS011_OK ) decode( reply, millis(), sample );
+			return( error );
+		}
+
+		/// reads the firmware date and the id of the device, a zero date on failure
+		sds011Firmware readFirmware(void) {
+			sds011Firmware result = { SDS011_OK, 0, 0, 0, 0 };
+			uint8_t reply[SDS011_REPLY_LEN];
+
+			if ( ( result.error = communicate( CMD_FIRMWARE_VERSION, 0, 0, _id_1, _id_2, reply ) ) != SDS011_OK ) return( result );
+			result.year = (uint16_t)( 2000 + reply[3] );
+			result.month = reply[4];
+			result.day = reply[5];
+			result.id = sds011ReplyId( reply );
+			host().debug( "Device Id = %04X and Firmware Version = %u-%02u-%02u\n", result.id, result.year, result.month, result.day );
+			return( result );
+		}
+
+		/// fills a sample from a data reply received at millis() time
+		void decode( const uint8_t reply[SDS011_REPLY_LEN], unsigned long time, sds011Sample *sample ) {
+			sample->time = (uint32_t)time;
+			sample->id = sds011ReplyId( reply );
+			sample->pm25 = sds011ReplyPm25( reply );
+			sample->pm10 = sds011ReplyPm10( reply );
+			host().debug( "Data : pm10 %u.%u pm2.5 %u.%u\n", sample->pm10 / 10, sample->pm10 % 10, sample->pm25 / 10, sample->pm25 % 10 );
+		}
+
+	private:
+		/// the class deriving from the core
+		Host &host(void) { return( *static_cast<Host *>( this ) ); }
+};
+
+#endif
@@ -0,0 +1,322 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (C++20 coroutine interface)
+
+/// @file sds011coro.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Awaitable sensor commands and a small single-threaded executor, so a
+/// workflow reads as straight code and many of them share one core:
+///
+///     sds011Task cycle( sds011CoSensor &sensor ) {
+///         co_await sensor.setPower( SDS011_POWER_WORK );
+///         co_await sensor.sleepFor( SDS011_DUTY_SPINUP );
+///         sds011SampleResult r = co_await sensor.query();
+///         co_await sensor.setPower( SDS011_POWER_SLEEP );
+///     }
+///
+///     executor.spawn( cycle( sensor ) );
+///     executor.run();
+///
+/// The commands run on the non-blocking sds011Async engine of each sensor;
+/// the executor polls the engines and resumes a coroutine once its reply,
+/// its timeout or its timer is due. Nothing blocks and no thread is used.
+/// Waiting coroutines are linked through their awaiters, so there is no
+/// fixed limit; only the coroutine frames themselves are allocated, once
+/// per spawned task.
+///
+/// Header only and compiled only with coroutine support (C++20, e.g.
+/// -std=gnu++20 on the ESP32 and host toolchains), as the rest of the
+/// library is built as C++11.
+
+#ifndef PM_SDS011_CORO_h
+#define PM_SDS011_CORO_h
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <coroutine>
+#include <exception>
+
+#include "sds011async.h"
+#include "sds011frame.h"
+#include "sds011result.h"
+
+/// number of command engines an executor polls
+#define SDS011_CO_ENGINES 8
+
+class sds011Executor;
+
+/// a suspended coroutine in one of the executor's lists
+struct sds011CoNode {
+	/// the coroutine to resume
+	std::coroutine_handle<> handle;
+	/// millis() at which a timer is due
+	unsigned long due;
+	/// next node of the list
+	sds011CoNode *next;
+};
+
+/// coroutine type of a workflow. A task starts when spawned on an executor
+/// and is destroyed by it when it returns.
+class sds011Task {
+	public:
+		struct promise_type {
+			/// queues the task on its first run
+			sds011CoNode node;
+			sds011Task get_return_object() { return( sds011Task( std::coroutine_handle<promise_type>::from_promise( *this ) ) ); }
+			std::suspend_always initial_suspend() noexcept { return( std::suspend_always() ); }
+			std::suspend_always final_suspend() noexcept { return( std::suspend_always() ); }
+			void return_void() {}
+			void unhandled_exception() { std::terminate(); }
+		};
+		explicit sds011Task( std::coroutine_handle<promise_type> handle ) : _handle( handle ) {}
+		sds011Task( sds011Task &&other ) : _handle( other._handle ) { other._handle = nullptr; }
+		sds011Task( const sds011Task & ) = delete;
+		~sds011Task() { if ( _handle ) _handle.destroy(); }
+		/// hands the coroutine over, to the executor
+		std::coroutine_handle<promise_type> release() { std::coroutine_handle<promise_type> h = _handle; _handle = nullptr; return( h ); }
+	private:
+		/// the coroutine, until it is spawned
+		std::coroutine_handle<promise_type> _handle;
+};
+
+/// single-threaded executor: resumes coroutines whose reply arrived or
+/// whose timer expired, and polls the command engines in between
+class sds011Executor {
+	public:
+		sds011Executor(void) : _ready( nullptr ), _last( nullptr ), _timers( nullptr ), _engineCount( 0 ), _tasks( 0 ) {}
+
+		/// starts a task, it first runs in the next step()
+		void spawn( sds011Task task ) {
+			std::coroutine_handle<sds011Task::promise_type> h = task.release();
+
+			h.promise().node.handle = h;
+			++_tasks;
+			ready( &h.promise().node );
+		}
+
+		/// adds an engine to be polled, done by sds011CoSensor::begin()
+		bool attach( sds011Async *engine ) {
+			if ( _engineCount >= SDS011_CO_ENGINES ) return( false );
+			_engines[_engineCount++] = engine;
+			return( true );
+		}
+
+		/// queues a coroutine to be resumed, called from engine callbacks
+		void ready( sds011CoNode *node ) {
+			node->next = nullptr;
+			if ( _last ) _last->next = node; else _ready = node;
+			_last = node;
+		}
+
+		/// suspends a coroutine until millis() reaches node->due
+		void at( sds011CoNode *node ) {
+			sds011CoNode **p = &_timers;
+
+			while ( *p && (long)( (*p)->due - node->due ) <= 0 ) p = &(*p)->next;
+			node->next = *p;
+			*p = node;
+		}
+
+		/// one round: polls the engines, then resumes expired timers and ready coroutines
+		/// @returns true while tasks remain
+		bool step(void) {
+			unsigned long now = millis();
+			sds011CoNode *node;
+			uint8_t i;
+
+			for ( i = 0; i < _engineCount; ++i ) _engines[i]->poll();
+			while ( _timers && (long)( now - _timers->due ) >= 0 )
+			{
+				node = _timers;
+				_timers = node->next;
+				ready( node );
+			}
+			// coroutines made ready while these run wait for the next round
+			node = _ready;
+			_ready = _last = nullptr;
+			while ( node )
+			{
+				sds011CoNode *next = node->next;
+				std::coroutine_handle<> h = node->handle;
+
+				h.resume();
+				if ( h.done() )
+				{
+					h.destroy();
+					--_tasks;
+				}
+				node = next;
+			}
+			return( _tasks > 0 );
+		}
+
+		/// milliseconds the executor has nothing to do, for a light sleep; 0 when busy
+		unsigned long idle(void) const {
+			uint8_t i;
+			long left;
+
+			if ( _ready ) return( 0 );
+			for ( i = 0; i < _engineCount; ++i ) if ( _engines[i]->queued() ) return( 0 );
+			if ( _timers == nullptr ) return( _tasks ? 1 : 0 );
+			left = (long)( _timers->due - millis() );
+			return( left > 0 ? (unsigned long)left : 0 );
+		}
+
+		/// runs until every task has returned, sleeping while nothing is due
+		void run(void) {
+			unsigned long wait;
+
+			while ( step() )
+			{
+				wait = idle();
+				// a command in flight is polled every millisecond, about a byte at 9600 baud
+				if ( wait == 0 && _ready == nullptr ) wait = 1;
+				if ( wait ) delay( wait );
+			}
+		}
+
+		/// number of tasks not yet returned
+		uint16_t tasks(void) const { return( _tasks ); }
+	private:
+		/// coroutines to resume in the next round, in order
+		sds011CoNode *_ready;
+		/// tail of _ready
+		sds011CoNode *_last;
+		/// sleeping coroutines, by due time
+		sds011CoNode *_timers;
+		/// engines to poll
+		sds011Async *_engines[SDS011_CO_ENGINES];
+		/// number of engines
+		uint8_t _engineCount;
+		/// spawned tasks not yet returned
+		uint16_t _tasks;
+};
+
+/// awaiter of sleepFor()
+class sds011CoSleep {
+	public:
+		sds011CoSleep( sds011Executor *exec, unsigned long ms ) : _exec( exec ), _ms( ms ) {}
+		bool await_ready() const { return( _ms == 0 ); }
+		void await_suspend( std::coroutine_handle<> h ) {
+			_node.handle = h;
+			_node.due = millis() + _ms;
+			_exec->at( &_node );
+		}
+		void await_resume() const {}
+	private:
+		/// the executor keeping the timer
+		sds011Executor *_exec;
+		/// the delay
+		unsigned long _ms;
+		/// the timer
+		sds011CoNode _node;
+};
+
+/// @name typed results of a completed command, see sds011result.h
+/// A failed command gives SDS011_ERR_NO_REPLY; the engine does not tell a
+/// silent sensor from a garbled line or a refused value.
+/// @{
+inline void sds011CoMake( const sds011AsyncResult &r, uint8_t, sds011SampleResult *out ) {
+	out->error = r.status ? SDS011_OK : SDS011_ERR_NO_REPLY;
+	out->sample.time = (uint32_t)millis();
+	out->sample.id = r.status ? sds011ReplyId( r.reply ) : 0;
+	out->sample.pm25 = r.status ? sds011ReplyPm25( r.reply ) : 0;
+	out->sample.pm10 = r.status ? sds011ReplyPm10( r.reply ) : 0;
+}
+inline void sds011CoMake( const sds011AsyncResult &r, uint8_t value, sds011PeriodResult *out ) {
+	out->error = r.status ? SDS011_OK : SDS011_ERR_NO_REPLY;
+	out->minutes = r.status ? r.reply[4] : value;
+}
+inline void sds011CoMake( const sds011AsyncResult &r, uint8_t value, sds011ModeResult *out ) {
+	out->error = r.status ? SDS011_OK : SDS011_ERR_NO_REPLY;
+	out->mode = ( r.status ? r.reply[4] : value ) == QUERY_MODE ? SDS011_REPORT_QUERY : SDS011_REPORT_AUTO;
+}
+inline void sds011CoMake( const sds011AsyncResult &r, uint8_t value, sds011PowerResult *out ) {
+	out->error = r.status ? SDS011_OK : SDS011_ERR_NO_REPLY;
+	out->power = ( r.status ? r.reply[4] : value ) == WORK_MODE ? SDS011_POWER_WORK : SDS011_POWER_SLEEP;
+}
+inline void sds011CoMake( const sds011AsyncResult &r, uint8_t, sds011Firmware *out ) {
+	out->error = r.status ? SDS011_OK : SDS011_ERR_NO_REPLY;
+	out->year = r.status ? (uint16_t)( 2000 + r.reply[3] ) : 0;
+	out->month = r.status ? r.reply[4] : 0;
+	out->day = r.status ? r.reply[5] : 0;
+	out->id = r.status ? sds011ReplyId( r.reply ) : 0;
+}
+/// @}
+
+/// awaiter of a sensor command, resumes with the typed result R
+template <class R>
+class sds011CoCommand {
+	public:
+		sds011CoCommand( sds011Executor *exec, sds011Async *engine, uint8_t command, uint8_t option_1, uint8_t option_2 )
+			: _exec( exec ), _engine( engine ), _command( command ), _option_1( option_1 ), _option_2( option_2 ) {}
+		bool await_ready() const { return( false ); }
+		bool await_suspend( std::coroutine_handle<> h ) {
+			_node.handle = h;
+			_result.status = false;
+			// a full queue fails the command at once
+			return( _engine->enqueue( _command, _option_1, _option_2, &_result, done, this ) );
+		}
+		R await_resume() const {
+			R r;
+
+			sds011CoMake( _result, _option_2, &r );
+			return( r );
+		}
+	private:
+		/// the executor to resume on
+		sds011Executor *_exec;
+		/// the engine of the sensor
+		sds011Async *_engine;
+		/// the command
+		uint8_t _command;
+		/// first parameter
+		uint8_t _option_1;
+		/// second parameter, the value of a write
+		uint8_t _option_2;
+		/// filled by the engine
+		sds011AsyncResult _result;
+		/// the waiting coroutine
+		sds011CoNode _node;
+		/// engine callback
+		static void done( const sds011AsyncResult *, void *ctx ) {
+			sds011CoCommand *self = (sds011CoCommand *)ctx;
+
+			self->_exec->ready( &self->_node );
+		}
+};
+
+/// a sensor with awaitable commands. Every sensor has its own engine and
+/// transport; commands of one sensor run one after the other, commands of
+/// different sensors at the same time.
+class sds011CoSensor {
+	public:
+		/// connects the sensor and registers its engine with the executor
+		bool begin( sds011Executor *exec, sds011Transport *transport, uint8_t id_1 = MSG_FF, uint8_t id_2 = MSG_FF ) {
+			_exec = exec;
+			return( _engine.begin( transport, id_1, id_2 ) && exec->attach( &_engine ) );
+		}
+		/// queries a measurement
+		sds011CoCommand<sds011SampleResult> query(void) { return( sds011CoCommand<sds011SampleResult>( _exec, &_engine, CMD_QUERY_DATA, 0, 0 ) ); }
+		/// reads the firmware date and id
+		sds011CoCommand<sds011Firmware> firmware(void) { return( sds011CoCommand<sds011Firmware>( _exec, &_engine, CMD_FIRMWARE_VERSION, 0, 0 ) ); }
+		/// sets the reporting mode
+		sds011CoCommand<sds011ModeResult> setReportMode( sds011ReportMode mode ) { return( sds011CoCommand<sds011ModeResult>( _exec, &_engine, CMD_REPORTING_MODE, WRITE_MODE, mode ) ); }
+		/// wakes the sensor or puts it to sleep
+		sds011CoCommand<sds011PowerResult> setPower( sds011Power power ) { return( sds011CoCommand<sds011PowerResult>( _exec, &_engine, CMD_SLEEP_AND_WORK, WRITE_MODE, power ) ); }
+		/// sets the work period in minutes, 0 for continuous
+		sds011CoCommand<sds011PeriodResult> setWorkPeriod( uint8_t minutes ) { return( sds011CoCommand<sds011PeriodResult>( _exec, &_engine, CMD_WORKING_PERIOD, WRITE_MODE, minutes ) ); }
+		/// waits without blocking the other coroutines
+		sds011CoSleep sleepFor( unsigned long ms ) { return( sds011CoSleep( _exec, ms ) ); }
+		/// the command engine, e.g. for onData()
+		sds011Async &engine(void) { return( _engine ); }
+	private:
+		/// the executor running the coroutines
+		sds011Executor *_exec;
+		/// command engine
+		sds011Async _engine;
+};
+
+#endif
+
+#endif
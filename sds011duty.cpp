@@ -0,0 +1,210 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (adaptive duty cycle implementation)
+
+/// @file sds011duty.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011duty.h"
+
+/// pause before a failed command is tried again, in ms
+#define SDS011_DUTY_RETRY 1000UL
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011DutyPolicy::sds011DutyPolicy(void) {
+  begin();
+}
+
+/**************************************************************************/
+/*!
+    @brief  sets the limits and the tolerance, starting at the shortest interval
+    @param min_ms shortest interval between samples in ms
+    @param max_ms longest interval between samples in ms
+    @param tolerance change in 0.1 ug/m3 that counts as stable
+    @param percent change in percent of the reading that counts as stable;
+    the larger of both applies
+    @returns void
+*/
+/**************************************************************************/
+void sds011DutyPolicy::begin( uint32_t min_ms, uint32_t max_ms, uint16_t tolerance, uint8_t percent ) {
+  _min = min_ms ? min_ms : 1;
+  _max = max_ms < _min ? _min : max_ms;
+  _interval = _min;
+  _tolerance = tolerance;
+  _percent = percent;
+  _primed = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  grades the change of one channel against the tolerance
+    @param prev the previous reading
+    @param value the new reading
+    @returns 0 within half the tolerance, 1 within the tolerance,
+    2 within twice the tolerance, 3 beyond
+*/
+/**************************************************************************/
+uint8_t sds011DutyPolicy::grade( uint16_t prev, uint16_t value ) const {
+  uint32_t tol = (uint32_t)prev * _percent / 100;
+  uint32_t change = value > prev ? value - prev : prev - value;
+
+  if ( tol < _tolerance ) tol = _tolerance;
+  if ( 2 * change <= tol ) return( 0 );
+  if ( change <= tol ) return( 1 );
+  if ( change <= 2 * tol ) return( 2 );
+  return( 3 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  takes a new reading and adapts the interval
+    @param sample the reading
+    @returns the interval to the next sample in ms
+*/
+/**************************************************************************/
+uint32_t sds011DutyPolicy::update( const sds011Sample &sample ) {
+  uint8_t g25, g10, g;
+
+  if ( _primed )
+  {
+    g25 = grade( _prev.pm25, sample.pm25 );
+    g10 = grade( _prev.pm10, sample.pm10 );
+    g = g25 > g10 ? g25 : g10;
+    if ( g == 3 )
+    {
+      _interval = _min;
+    }else if ( g == 2 )
+    {
+      _interval = _interval / 2 < _min ? _min : _interval / 2;
+    }else if ( g == 0 )
+    {
+      _interval = _interval + _interval / 2 > _max ? _max : _interval + _interval / 2;
+    }
+  }
+  _prev = sample;
+  _primed = true;
+  return( _interval );
+}
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011Duty::sds011Duty(void) : _sensor(NULL), _spinup(SDS011_DUTY_SPINUP), _state(SLEEP_MODE), _due(0), _last(0),
+  _awake(0), _asleep(0), _samples(0), _wakes(0), _errors(0) {
+}
+
+/**************************************************************************/
+/*!
+    @brief  wakes the sensor, sets query mode and continuous work period
+    (the device's own work period has one minute steps and no control of
+    the spin-up, so the sleep / work command does the duty cycling)
+    @param sensor the sensor, begun
+    @param spinup fan spin-up after waking in ms
+    @returns false when the sensor did not accept the configuration
+*/
+/**************************************************************************/
+bool sds011Duty::begin( sds011 *sensor, uint32_t spinup ) {
+  uint8_t response;
+  bool status;
+
+  _sensor = sensor;
+  _spinup = spinup;
+  // a sleeping sensor answers nothing but this, and may not answer it either
+  _sensor->sleepWorkModeCmd( &response, WORK_MODE, WRITE_MODE );
+  status = _sensor->dataReportingModeCmd( &response, QUERY_MODE, WRITE_MODE );
+  status = _sensor->workPeriodCmd( &response, 0, WRITE_MODE ) && status;
+  _state = WORK_MODE;
+  _last = millis();
+  _due = _last + _spinup;
+  ++_wakes;
+  if ( !status ) ++_errors;
+  return( status );
+}
+
+/**************************************************************************/
+/*!
+    @brief  adds the time since the last call to the awake or asleep total
+    @param now current time in ms
+    @returns void
+*/
+/**************************************************************************/
+void sds011Duty::account( uint32_t now ) {
+  if ( _state == WORK_MODE ) _awake += now - _last; else _asleep += now - _last;
+  _last = now;
+}
+
+/**************************************************************************/
+/*!
+    @brief  wakes, samples or puts the sensor to sleep when due
+    @param sample receives the reading when one was taken
+    @returns true when a new reading was taken
+*/
+/**************************************************************************/
+bool sds011Duty::poll( sds011Sample *sample ) {
+  uint32_t now = millis();
+  uint32_t interval;
+  uint8_t response;
+
+  if ( _sensor == NULL ) return( false );
+  account( now );
+  if ( _state == SLEEP_MODE )
+  {
+    if ( (int32_t)( now - ( _due - _spinup ) ) < 0 ) return( false );
+    // the wake command is often not answered, the query below will tell
+    _sensor->sleepWorkModeCmd( &response, WORK_MODE, WRITE_MODE );
+    account( millis() );
+    _state = WORK_MODE;
+    ++_wakes;
+    if ( (int32_t)( _due - _last ) < (int32_t)_spinup ) _due = _last + _spinup;
+    return( false );
+  }
+  if ( (int32_t)( now - _due ) < 0 ) return( false );
+
+  if ( !_sensor->dataQueryRaw( sample ) )
+  {
+    account( millis() );
+    ++_errors;
+    _due = _last + SDS011_DUTY_RETRY;
+    return( false );
+  }
+  account( millis() );
+  ++_samples;
+  interval = _policy.update( *sample );
+  _due = sample->time + interval;
+  if ( _policy.sleeps( _spinup ) )
+  {
+    if ( _sensor->sleepWorkModeCmd( &response, SLEEP_MODE, WRITE_MODE ) )
+    {
+      account( millis() );
+      _state = SLEEP_MODE;
+    }else
+    {
+      ++_errors;
+    }
+  }
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  reports awake time and the energy estimate
+    @param out the report
+    @returns void
+*/
+/**************************************************************************/
+void sds011Duty::report( sds011DutyReport *out ) {
+  account( millis() );
+  out->awake = (uint32_t)( _awake / 1000 );
+  out->asleep = (uint32_t)( _asleep / 1000 );
+  // mA * ms / 3600 = uAh
+  out->charge = (uint32_t)( ( _awake * SDS011_DUTY_AWAKE_MA + _asleep * SDS011_DUTY_SLEEP_MA ) / 3600 );
+  out->samples = _samples;
+  out->wakes = _wakes;
+  out->errors = _errors;
+  out->interval = _policy.interval();
+}
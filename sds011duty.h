@@ -0,0 +1,119 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (adaptive duty cycle interface)
+
+/// @file sds011duty.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// The fan and laser draw about 70 mA and wear out (the laser is rated for
+/// about 8000 hours), so a sensor should sleep whenever the readings allow.
+/// sds011DutyPolicy picks the interval to the next sample from how much the
+/// readings change; sds011Duty drives a sensor in query mode with it,
+/// sleeping between samples and waking early enough for the fan to spin up.
+
+#ifndef PM_SDS011_DUTY_h
+#define PM_SDS011_DUTY_h
+
+#include "sds011lib.h"
+
+#ifndef SDS011_DUTY_SPINUP
+/// fan spin-up after waking before a reading is trusted, in ms (data sheet: 30 s)
+#define SDS011_DUTY_SPINUP 30000UL
+#endif
+/// shortest sleep worth a wake-up, in ms; shorter gaps keep the sensor awake
+#define SDS011_DUTY_MIN_SLEEP 10000UL
+/// current drawn while measuring, in mA (data sheet: 70 mA)
+#define SDS011_DUTY_AWAKE_MA 70
+/// current drawn while sleeping, in mA (data sheet: < 4 mA)
+#define SDS011_DUTY_SLEEP_MA 4
+
+/// awake time and energy estimate of an sds011Duty
+struct sds011DutyReport {
+	/// seconds with fan and laser running, spin-up included
+	uint32_t awake;
+	/// seconds asleep
+	uint32_t asleep;
+	/// estimated charge drawn in uAh
+	uint32_t charge;
+	/// samples taken
+	uint32_t samples;
+	/// wake-ups
+	uint32_t wakes;
+	/// failed commands
+	uint32_t errors;
+	/// current interval between samples in ms
+	uint32_t interval;
+};
+
+/// chooses the interval to the next sample. A change of either channel
+/// beyond the tolerance (the larger of an absolute value and a percentage
+/// of the reading) halves the interval, a change beyond twice the tolerance
+/// returns to the shortest interval, and readings within half the tolerance
+/// stretch the interval by half up to the longest. Pure integer logic
+/// without I/O, so it can also be evaluated offline against recorded data.
+class sds011DutyPolicy {
+	public:
+		sds011DutyPolicy(void);
+		void begin( uint32_t min_ms = 5000UL, uint32_t max_ms = 600000UL, uint16_t tolerance = 20, uint8_t percent = 10 );
+		uint32_t update( const sds011Sample &sample );
+		/// current interval between samples in ms
+		uint32_t interval(void) const { return( _interval ); }
+		/// true when the interval is long enough to sleep through, spin-up included
+		bool sleeps( uint32_t spinup ) const { return( _interval >= spinup + SDS011_DUTY_MIN_SLEEP ); }
+	private:
+		/// shortest interval
+		uint32_t _min;
+		/// longest interval
+		uint32_t _max;
+		/// current interval
+		uint32_t _interval;
+		/// absolute tolerance in 0.1 ug/m3
+		uint16_t _tolerance;
+		/// relative tolerance in percent of the previous reading
+		uint8_t _percent;
+		/// true once _prev holds a reading
+		bool _primed;
+		/// the previous reading
+		sds011Sample _prev;
+		uint8_t grade( uint16_t prev, uint16_t value ) const;
+};
+
+/// runs a sensor on an sds011DutyPolicy. Call poll() from loop(); it
+/// issues the sleep, wake and query commands when they are due, using the
+/// blocking command API of sds011.
+class sds011Duty {
+	public:
+		sds011Duty(void);
+		bool begin( sds011 *sensor, uint32_t spinup = SDS011_DUTY_SPINUP );
+		bool poll( sds011Sample *sample );
+		void report( sds011DutyReport *out );
+		/// the policy, to configure after begin()
+		sds011DutyPolicy &policy(void) { return( _policy ); }
+		/// true while the sensor sleeps
+		bool sleeping(void) const { return( _state == SLEEP_MODE ); }
+	private:
+		/// the sensor
+		sds011 *_sensor;
+		/// the interval policy
+		sds011DutyPolicy _policy;
+		/// fan spin-up in ms
+		uint32_t _spinup;
+		/// SLEEP_MODE or WORK_MODE
+		uint8_t _state;
+		/// time the next sample is due
+		uint32_t _due;
+		/// time accounted up to
+		uint32_t _last;
+		/// ms awake
+		uint64_t _awake;
+		/// ms asleep
+		uint64_t _asleep;
+		/// samples taken
+		uint32_t _samples;
+		/// wake-ups
+		uint32_t _wakes;
+		/// failed commands
+		uint32_t _errors;
+		void account( uint32_t now );
+};
+
+#endif
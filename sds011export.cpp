@@ -0,0 +1,364 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (telemetry exporters implementation)
+
+/// @file sds011export.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include <string.h>
+
+#include "sds011export.h"
+
+/// the numbers 00..99 as digit pairs
+static const char digitPairs[201] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+/// hex digits of the ids
+static const char hexDigits[] = "0123456789ABCDEF";
+
+/**************************************************************************/
+/*!
+    @brief  counts the decimal digits of a number
+    @param v the number
+    @returns 1..20
+*/
+/**************************************************************************/
+static inline uint8_t digits( uint64_t v ) {
+  uint8_t n = 1;
+
+  for ( ; v >= 10000; v /= 10000 ) n += 4;
+  if ( v >= 1000 ) return( n + 3 );
+  if ( v >= 100 ) return( n + 2 );
+  return( v >= 10 ? n + 1 : n );
+}
+
+/**************************************************************************/
+/*!
+    @brief  writes a number in decimal, two digits per step from the end
+    @param p where to write
+    @param v the number
+    @param n its digits() count
+    @returns p past the number
+*/
+/**************************************************************************/
+static inline char *putUint( char *p, uint64_t v, uint8_t n ) {
+  char *end = p + n;
+  unsigned d;
+
+  while ( v >= 100 )
+  {
+    d = (unsigned)( v % 100 ) * 2;
+    v /= 100;
+    *--end = digitPairs[d + 1];
+    *--end = digitPairs[d];
+  }
+  if ( v >= 10 )
+  {
+    d = (unsigned)v * 2;
+    *--end = digitPairs[d + 1];
+    *--end = digitPairs[d];
+  }
+  else *--end = (char)( '0' + v );
+  return( p + n );
+}
+
+/**************************************************************************/
+/*!
+    @brief  length of a deci ug/m3 value as text, e.g. 4 for "12.3"
+    @param deci the value
+    @returns the length
+*/
+/**************************************************************************/
+static inline size_t deciLength( uint16_t deci ) {
+  return( digits( sds011DeciWhole( deci ) ) + 2 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  writes a deci ug/m3 value as ug/m3 with one decimal
+    @param p where to write
+    @param deci the value
+    @returns p past the value
+*/
+/**************************************************************************/
+static inline char *putDeci( char *p, uint16_t deci ) {
+  uint16_t whole = sds011DeciWhole( deci );
+
+  p = putUint( p, whole, digits( whole ) );
+  *p++ = '.';
+  *p++ = (char)( '0' + sds011DeciTenths( deci ) );
+  return( p );
+}
+
+/**************************************************************************/
+/*!
+    @brief  writes a device id as four upper case hex digits
+    @param p where to write
+    @param id the id
+    @returns p past the id
+*/
+/**************************************************************************/
+static inline char *putId( char *p, uint16_t id ) {
+  p[0] = hexDigits[id >> 12];
+  p[1] = hexDigits[( id >> 8 ) & 0xf];
+  p[2] = hexDigits[( id >> 4 ) & 0xf];
+  p[3] = hexDigits[id & 0xf];
+  return( p + 4 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  copies a string of known length
+    @param p where to write
+    @param s the string
+    @param len its length
+    @returns p past the string
+*/
+/**************************************************************************/
+static inline char *put( char *p, const char *s, size_t len ) {
+  memcpy( p, s, len );
+  return( p + len );
+}
+
+/**************************************************************************/
+/*!
+    @brief  tells whether the id of a sample already appears earlier in
+    the batch. A 4096 bit filter of the ids seen, 512 bytes of stack,
+    spares the scan for most
+    new ids.
+    @param samples the batch
+    @param i index of the sample
+    @param seen the filter, 128 words zeroed before the first sample
+    @returns true when an earlier sample has the same id
+*/
+/**************************************************************************/
+static inline bool repeated( const sds011Sample *samples, size_t i, uint32_t seen[128] ) {
+  const uint16_t id = samples[i].id;
+  const unsigned bit = (uint16_t)( id * 40503u ) >> 4;
+  size_t j;
+
+  if ( seen[bit >> 5] & ( 1UL << ( bit & 31 ) ) )
+  {
+    for ( j = 0; j < i; ++j ) if ( samples[j].id == id ) return( true );
+  }
+  seen[bit >> 5] |= 1UL << ( bit & 31 );
+  return( false );
+}
+
+/**************************************************************************/
+/*!
+    @brief  writes samples in InfluxDB line protocol, one line per sample:
+    `sds011,id=1A2B pm25=12.3,pm10=45.6 1700000000000000000`, the time
+    in ns. Lines are written as long as they fit whole. Without a time the
+    server stamps every line of a write alike and keeps one point per id,
+    so the batch is then also cut before the first id that repeats.
+    @param samples the batch
+    @param count number of samples
+    @param buf the buffer
+    @param size its size
+    @param epoch Unix time in ms at millis() 0; 0 leaves the time out
+    @param name the measurement
+    @returns bytes and samples written
+*/
+/**************************************************************************/
+sds011Export sds011ExportInflux( const sds011Sample *samples, size_t count, char *buf, size_t size,
+                                 uint64_t epoch, const char *name ) {
+  const size_t nameLen = strlen( name );
+  // name ",id=" id " pm25=" pm25 ",pm10=" pm10 "\n", 21 bytes besides name and values
+  const size_t fixed = nameLen + 21;
+  sds011Export res = { 0, 0 };
+  char *p = buf, *end = buf + size;
+  uint64_t ns = 0;
+  uint8_t nsLen = 0;
+  uint32_t seen[128] = { 0 };
+  size_t i, len;
+
+  for ( i = 0; i < count; ++i )
+  {
+    const sds011Sample &s = samples[i];
+    if ( !epoch && repeated( samples, i, seen ) ) break;
+    len = fixed + deciLength( s.pm25 ) + deciLength( s.pm10 );
+    if ( epoch )
+    {
+      ns = ( epoch + s.time ) * 1000000ULL;
+      nsLen = digits( ns );
+      len += 1 + nsLen;
+    }
+    if ( len > (size_t)( end - p ) ) break;
+
+    p = put( p, name, nameLen );
+    p = put( p, ",id=", 4 );
+    p = putId( p, s.id );
+    p = put( p, " pm25=", 6 );
+    p = putDeci( p, s.pm25 );
+    p = put( p, ",pm10=", 6 );
+    p = putDeci( p, s.pm10 );
+    if ( epoch )
+    {
+      *p++ = ' ';
+      p = putUint( p, ns, nsLen );
+    }
+    *p++ = '\n';
+  }
+  res.bytes = p - buf;
+  res.samples = i;
+  return( res );
+}
+
+/**************************************************************************/
+/*!
+    @brief  writes samples in the Prometheus text exposition format, as
+    two gauge families <name>_pm25 and <name>_pm10 in ug/m3 with one line
+    per sample, e.g. `sds011_pm25{id="1A2B"} 12.3 1700000000000`, the
+    time in ms. A series may appear only once in an exposition, so the
+    batch is cut before the first id that repeats, as well as before the
+    first sample that does not fit. The number of samples is worked out
+    first, since each family lists all of them.
+    @param samples the batch
+    @param count number of samples
+    @param buf the buffer
+    @param size its size
+    @param epoch Unix time in ms at millis() 0; 0 leaves the time out
+    @param name the metric name prefix
+    @returns bytes and samples written
+*/
+/**************************************************************************/
+sds011Export sds011ExportPrometheus( const sds011Sample *samples, size_t count, char *buf, size_t size,
+                                     uint64_t epoch, const char *name ) {
+  const size_t nameLen = strlen( name );
+  // "# TYPE " name "_pm25 gauge\n", twice
+  const size_t header = 2 * ( nameLen + 19 );
+  // name "_pm25{id=\"" id "\"} " value "\n", twice
+  const size_t fixed = 2 * ( nameLen + 18 );
+  sds011Export res = { 0, 0 };
+  char *p = buf;
+  size_t n, len, family;
+  uint64_t ms;
+  uint32_t seen[128] = { 0 };
+
+  if ( !count || header > size ) return( res );
+  for ( len = header, n = 0; n < count; ++n )
+  {
+    const sds011Sample &s = samples[n];
+    if ( repeated( samples, n, seen ) ) break;
+    family = fixed + deciLength( s.pm25 ) + deciLength( s.pm10 );
+    if ( epoch ) family += 2 * ( 1 + digits( epoch + s.time ) );
+    if ( family > size - len ) break;
+    len += family;
+  }
+  if ( !n ) return( res );
+
+  for ( family = 0; family < 2; ++family )
+  {
+    const char *metric = family ? "_pm10" : "_pm25";
+    size_t i;
+
+    p = put( p, "# TYPE ", 7 );
+    p = put( p, name, nameLen );
+    p = put( p, metric, 5 );
+    p = put( p, " gauge\n", 7 );
+    for ( i = 0; i < n; ++i )
+    {
+      const sds011Sample &s = samples[i];
+      p = put( p, name, nameLen );
+      p = put( p, metric, 5 );
+      p = put( p, "{id=\"", 5 );
+      p = putId( p, s.id );
+      p = put( p, "\"} ", 3 );
+      p = putDeci( p, family ? s.pm10 : s.pm25 );
+      if ( epoch )
+      {
+        ms = epoch + s.time;
+        *p++ = ' ';
+        p = putUint( p, ms, digits( ms ) );
+      }
+      *p++ = '\n';
+    }
+  }
+  res.bytes = p - buf;
+  res.samples = n;
+  return( res );
+}
+
+/**************************************************************************/
+/*!
+    @brief  length of a CBOR unsigned integer, head included
+    @param v the number
+    @returns 1, 2, 3, 5 or 9
+*/
+/**************************************************************************/
+static inline size_t cborLength( uint64_t v ) {
+  if ( v < 24 ) return( 1 );
+  if ( v <= 0xff ) return( 2 );
+  if ( v <= 0xffff ) return( 3 );
+  if ( v <= 0xffffffffULL ) return( 5 );
+  return( 9 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  writes a CBOR head in its shortest form
+    @param p where to write
+    @param major the major type, shifted into the top three bits
+    @param v the argument
+    @returns p past the head
+*/
+/**************************************************************************/
+static inline uint8_t *putCbor( uint8_t *p, uint8_t major, uint64_t v ) {
+  size_t len = cborLength( v ), i;
+
+  if ( len == 1 )
+  {
+    *p = (uint8_t)( major | v );
+    return( p + 1 );
+  }
+  // 24, 25, 26 or 27 for 1, 2, 4 or 8 bytes of argument, big endian
+  *p = (uint8_t)( major | ( len == 2 ? 24 : len == 3 ? 25 : len == 5 ? 26 : 27 ) );
+  for ( i = len - 1; i; --i, v >>= 8 ) p[i] = (uint8_t)v;
+  return( p + len );
+}
+
+/**************************************************************************/
+/*!
+    @brief  writes samples as CBOR (RFC 8949): an array of one array per
+    sample, [id, time in ms, pm25, pm10], all unsigned integers in their
+    shortest form and the PM values in 0.1 ug/m3. A sample of a sensor
+    running a few minutes takes about 12 bytes, with Unix time 16.
+    @param samples the batch
+    @param count number of samples
+    @param buf the buffer
+    @param size its size
+    @param epoch Unix time in ms at millis() 0, added to the times
+    @returns bytes and samples written
+*/
+/**************************************************************************/
+sds011Export sds011ExportCbor( const sds011Sample *samples, size_t count, uint8_t *buf, size_t size, uint64_t epoch ) {
+  sds011Export res = { 0, 0 };
+  uint8_t *p = buf;
+  size_t n, len, item;
+
+  // the outer head is taken at its largest size for the count, then shrunk to the fit
+  for ( len = cborLength( count ), n = 0; n < count; ++n )
+  {
+    const sds011Sample &s = samples[n];
+    item = 1 + cborLength( s.id ) + cborLength( epoch + s.time ) + cborLength( s.pm25 ) + cborLength( s.pm10 );
+    if ( len > size || item > size - len ) break;
+    len += item;
+  }
+  if ( !n ) return( res );
+
+  p = putCbor( p, 0x80, n );
+  for ( size_t i = 0; i < n; ++i )
+  {
+    const sds011Sample &s = samples[i];
+    *p++ = 0x84;
+    p = putCbor( p, 0x00, s.id );
+    p = putCbor( p, 0x00, epoch + s.time );
+    p = putCbor( p, 0x00, s.pm25 );
+    p = putCbor( p, 0x00, s.pm10 );
+  }
+  res.bytes = p - buf;
+  res.samples = n;
+  return( res );
+}
@@ -0,0 +1,45 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (telemetry exporters interface)
+
+/// @file sds011export.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Serializes batches of decoded samples for shipping: InfluxDB line
+/// protocol, Prometheus text exposition and a compact CBOR array. The
+/// exporters write into a buffer of the caller, allocate nothing and format
+/// the 0.1 ug/m3 values with integer arithmetic only (no printf, no float).
+/// A batch that does not fit is cut at a whole sample; the result tells how
+/// many samples were written, so the rest can follow in the next buffer.
+/// A batch is also cut before the first sample of an id already in it when
+/// two samples of a sensor could not be told apart: always in the
+/// Prometheus format, where a series may appear once per exposition, and
+/// in line protocol without timestamps, where the server would stamp both
+/// alike and keep one. Each buffer then holds one sample per sensor.
+///
+/// Timestamps are millis() of the samples plus epoch, the Unix time in ms
+/// at millis() 0 (e.g. from NTP). With epoch 0 the text formats leave the
+/// timestamp out and the server stamps the arrival.
+
+#ifndef PM_SDS011_EXPORT_h
+#define PM_SDS011_EXPORT_h
+
+#include "sds011sample.h"
+
+/// default measurement name, and metric name prefix of the Prometheus format
+#define SDS011_EXPORT_NAME "sds011"
+
+/// how much of a batch an exporter wrote
+struct sds011Export {
+	/// bytes written to the buffer
+	size_t bytes;
+	/// samples written, from the start of the batch; the rest did not fit
+	size_t samples;
+};
+
+sds011Export sds011ExportInflux( const sds011Sample *samples, size_t count, char *buf, size_t size,
+                                 uint64_t epoch = 0, const char *name = SDS011_EXPORT_NAME );
+sds011Export sds011ExportPrometheus( const sds011Sample *samples, size_t count, char *buf, size_t size,
+                                     uint64_t epoch = 0, const char *name = SDS011_EXPORT_NAME );
+sds011Export sds011ExportCbor( const sds011Sample *samples, size_t count, uint8_t *buf, size_t size, uint64_t epoch = 0 );
+
+#endif
@@ -0,0 +1,52 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (compile-time frame checks)
+
+/// @file sds011frame.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Compile-time checks of the constexpr encoder and decoder against the
+/// protocol tables of sds011lib.cpp and the examples of the
+/// Laser Dust Sensor Control Protocol, V1.4. Nothing here generates code,
+/// a wrong frame layout stops the build.
+
+#include "sds011frame.h"
+
+namespace {
+
+/// query data to all devices: AA B4 04 00 .. 00 FF FF 02 AB
+constexpr sds011Request queryData = sds011MakeRequest( CMD_QUERY_DATA, 0, 0 );
+static_assert( queryData.bytes[0] == 0xAA && queryData.bytes[1] == 0xB4 && queryData.bytes[2] == 0x04, "query data header" );
+static_assert( queryData.bytes[3] == 0 && queryData.bytes[4] == 0 && queryData.bytes[13] == 0 && queryData.bytes[14] == 0, "query data options" );
+static_assert( queryData.bytes[15] == 0xFF && queryData.bytes[16] == 0xFF, "query data broadcast id" );
+static_assert( queryData.bytes[17] == 0x02 && queryData.bytes[18] == 0xAB, "query data check-sum and tail" );
+static_assert( sds011QueryDataRequest::frame.bytes[17] == queryData.bytes[17], "precomputed query data frame" );
+
+/// set query reporting mode on device A1 60: AA B4 02 01 01 00 .. 00 A1 60 05 AB
+constexpr sds011Request reportingMode = sds011MakeRequest( CMD_REPORTING_MODE, WRITE_MODE, QUERY_MODE, 0xA1, 0x60 );
+static_assert( reportingMode.bytes[2] == 0x02 && reportingMode.bytes[3] == 0x01 && reportingMode.bytes[4] == 0x01, "reporting mode options in DATA2 / DATA3" );
+static_assert( reportingMode.bytes[15] == 0xA1 && reportingMode.bytes[16] == 0x60 && reportingMode.bytes[17] == 0x05, "reporting mode id and check-sum" );
+
+/// set device id A1 60 to A0 01: options in DATA12 / DATA13 only
+constexpr sds011Request setId = sds011MakeRequest( CMD_SET_DEVICE_ID, 0xA0, 0x01, 0xA1, 0x60 );
+static_assert( setId.bytes[3] == 0 && setId.bytes[4] == 0 && setId.bytes[13] == 0xA0 && setId.bytes[14] == 0x01, "set id options in DATA12 / DATA13" );
+static_assert( setId.bytes[17] == (uint8_t)( 0x05 + 0xA0 + 0x01 + 0xA1 + 0x60 ), "set id check-sum" );
+
+/// work period 3 minutes and firmware version
+constexpr sds011Request workPeriod = sds011MakeRequest( CMD_WORKING_PERIOD, WRITE_MODE, 3 );
+static_assert( workPeriod.bytes[2] == 0x08 && workPeriod.bytes[3] == 1 && workPeriod.bytes[4] == 3 && workPeriod.bytes[17] == (uint8_t)( 0x08 + 1 + 3 + 0xFF + 0xFF ), "work period" );
+static_assert( sds011FirmwareRequest::frame.bytes[2] == 0x07 && sds011FirmwareRequest::frame.bytes[17] == 0x05, "firmware version" );
+
+/// data reply of device A1 60: PM2.5 123.6, PM10 261.8
+constexpr uint8_t dataReply[SDS011_REPLY_LEN] = { 0xAA, 0xC0, 0xD4, 0x04, 0x3A, 0x0A, 0xA1, 0x60, 0x1D, 0xAB };
+static_assert( sds011ReplyValid( dataReply ), "data reply valid" );
+static_assert( sds011ReplyPm25( dataReply ) == 1236 && sds011ReplyPm10( dataReply ) == 2618, "data reply PM values" );
+static_assert( sds011ReplyId( dataReply ) == 0x60A1, "data reply id" );
+
+/// work period reply: continuous mode, broken check-sum and tail
+constexpr uint8_t periodReply[SDS011_REPLY_LEN] = { 0xAA, 0xC5, 0x08, 0x00, 0x00, 0x00, 0xA1, 0x60, 0x09, 0xAB };
+constexpr uint8_t badChecksum[SDS011_REPLY_LEN] = { 0xAA, 0xC5, 0x08, 0x00, 0x00, 0x00, 0xA1, 0x60, 0x0A, 0xAB };
+constexpr uint8_t badTail[SDS011_REPLY_LEN] = { 0xAA, 0xC5, 0x08, 0x00, 0x00, 0x00, 0xA1, 0x60, 0x09, 0xAA };
+static_assert( sds011ReplyValid( periodReply ) && sds011ReplyValue( periodReply ) == 0, "work period reply" );
+static_assert( !sds011ReplyValid( badChecksum ) && !sds011ReplyValid( badTail ), "broken replies rejected" );
+
+}
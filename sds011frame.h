@@ -0,0 +1,135 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (compile-time frame encoder and decoder)
+
+/// @file sds011frame.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// The command and reply layouts of the protocol tables in sds011lib.cpp
+/// (at sdsCommunicate and dataQueryRaw) as constexpr functions. Frames with
+/// constant arguments are computed by the compiler, frames for fixed
+/// commands addressed to all devices (FF FF) are precomputed once, and
+/// every frame is a contiguous array that goes out with a single write.
+
+#ifndef PM_SDS011_FRAME_h
+#define PM_SDS011_FRAME_h
+
+#include "sds011protocol.h"
+#include "sds011parser.h"
+
+/// a complete 19 byte command frame
+struct sds011Request {
+	/// the frame bytes, header to tail
+	uint8_t bytes[SDS011_REQUEST_LEN];
+};
+
+/// true for the commands carrying a query / set flag and a value in DATA2 / DATA3
+constexpr bool sds011RequestHasMode( uint8_t command ) {
+	return( command == CMD_REPORTING_MODE || command == CMD_SLEEP_AND_WORK || command == CMD_WORKING_PERIOD );
+}
+
+/// DATA2 (byte 3) of a command frame
+constexpr uint8_t sds011RequestData2( uint8_t command, uint8_t option_1 ) {
+	return( sds011RequestHasMode( command ) ? option_1 : MSG_RESERVED );
+}
+
+/// DATA3 (byte 4) of a command frame
+constexpr uint8_t sds011RequestData3( uint8_t command, uint8_t option_2 ) {
+	return( sds011RequestHasMode( command ) ? option_2 : MSG_RESERVED );
+}
+
+/// DATA12 (byte 13) of a command frame, new id byte 1 of the set ID command
+constexpr uint8_t sds011RequestData12( uint8_t command, uint8_t option_1 ) {
+	return( command == CMD_SET_DEVICE_ID ? option_1 : MSG_RESERVED );
+}
+
+/// DATA13 (byte 14) of a command frame, new id byte 2 of the set ID command
+constexpr uint8_t sds011RequestData13( uint8_t command, uint8_t option_2 ) {
+	return( command == CMD_SET_DEVICE_ID ? option_2 : MSG_RESERVED );
+}
+
+/// check-sum of a command frame, DATA1 + DATA2 + ... + DATA15
+constexpr uint8_t sds011RequestChecksum( uint8_t command, uint8_t option_1, uint8_t option_2, uint8_t id_1, uint8_t id_2 ) {
+	return( (uint8_t)( command + sds011RequestData2( command, option_1 ) + sds011RequestData3( command, option_2 )
+		+ sds011RequestData12( command, option_1 ) + sds011RequestData13( command, option_2 ) + id_1 + id_2 ) );
+}
+
+/// builds a command frame, at compile time when the arguments are constant
+constexpr sds011Request sds011MakeRequest( uint8_t command, uint8_t option_1, uint8_t option_2, uint8_t id_1 = MSG_FF, uint8_t id_2 = MSG_FF ) {
+	return sds011Request{ {
+		MSG_HEAD, CMD_WRITE_MODE, command,
+		sds011RequestData2( command, option_1 ), sds011RequestData3( command, option_2 ),
+		MSG_RESERVED, MSG_RESERVED, MSG_RESERVED, MSG_RESERVED, MSG_RESERVED, MSG_RESERVED, MSG_RESERVED, MSG_RESERVED,
+		sds011RequestData12( command, option_1 ), sds011RequestData13( command, option_2 ),
+		id_1, id_2, sds011RequestChecksum( command, option_1, option_2, id_1, id_2 ), MSG_TAIL } };
+}
+
+/// a command frame fixed at compile time, stored once
+template <uint8_t C, uint8_t O1 = 0, uint8_t O2 = 0, uint8_t I1 = MSG_FF, uint8_t I2 = MSG_FF>
+struct sds011FixedRequest {
+	/// the precomputed frame
+	static constexpr sds011Request frame = sds011MakeRequest( C, O1, O2, I1, I2 );
+};
+
+template <uint8_t C, uint8_t O1, uint8_t O2, uint8_t I1, uint8_t I2>
+constexpr sds011Request sds011FixedRequest<C, O1, O2, I1, I2>::frame;
+
+/// query data, addressed to all devices
+typedef sds011FixedRequest<CMD_QUERY_DATA> sds011QueryDataRequest;
+/// get firmware version, addressed to all devices
+typedef sds011FixedRequest<CMD_FIRMWARE_VERSION> sds011FirmwareRequest;
+
+/**************************************************************************/
+/*!
+    @brief  frame bytes for a command: a precomputed frame for the fixed
+    commands addressed to FF FF, otherwise the frame built into scratch
+    @param scratch storage for a frame that has to be built
+    @param command one byte of the command to be sent
+    @param option_1 first parameter of the command
+    @param option_2 second parameter of the command
+    @param id_1 the id_lsb where commands to be send
+    @param id_2 the id_msb where commands to be send
+    @returns the 19 frame bytes
+*/
+/**************************************************************************/
+inline const uint8_t *sds011RequestBytes( sds011Request *scratch, uint8_t command, uint8_t option_1, uint8_t option_2, uint8_t id_1, uint8_t id_2 ) {
+	if ( id_1 == MSG_FF && id_2 == MSG_FF )
+	{
+		if ( command == CMD_QUERY_DATA ) return( sds011QueryDataRequest::frame.bytes );
+		if ( command == CMD_FIRMWARE_VERSION ) return( sds011FirmwareRequest::frame.bytes );
+	}
+	*scratch = sds011MakeRequest( command, option_1, option_2, id_1, id_2 );
+	return( scratch->bytes );
+}
+
+/// check-sum of a reply frame, DATA1 + DATA2 + ... + DATA6
+constexpr uint8_t sds011ReplyChecksum( const uint8_t *reply ) {
+	return( (uint8_t)( reply[2] + reply[3] + reply[4] + reply[5] + reply[6] + reply[7] ) );
+}
+
+/// true when header, reply id, check-sum and tail of a reply frame are correct
+constexpr bool sds011ReplyValid( const uint8_t *reply ) {
+	return( reply[0] == MSG_HEAD && ( reply[1] == REPLY_DATA || reply[1] == REPLY_CFG )
+		&& reply[8] == sds011ReplyChecksum( reply ) && reply[9] == MSG_TAIL );
+}
+
+/// PM2.5 of a data reply in 0.1 ug/m3
+constexpr uint16_t sds011ReplyPm25( const uint8_t *reply ) {
+	return( (uint16_t)( reply[2] | ( reply[3] << 8 ) ) );
+}
+
+/// PM10 of a data reply in 0.1 ug/m3
+constexpr uint16_t sds011ReplyPm10( const uint8_t *reply ) {
+	return( (uint16_t)( reply[4] | ( reply[5] << 8 ) ) );
+}
+
+/// device id of a reply, ID byte 1 as the lower byte
+constexpr uint16_t sds011ReplyId( const uint8_t *reply ) {
+	return( (uint16_t)( reply[6] | ( reply[7] << 8 ) ) );
+}
+
+/// the mode or period (DATA3) of a configuration reply
+constexpr uint8_t sds011ReplyValue( const uint8_t *reply ) {
+	return( reply[4] );
+}
+
+#endif
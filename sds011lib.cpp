@@ -4,7 +4,11 @@
 /// @author Sajjad Hussain
 /// @version 0.1
 
+#include <stdarg.h>
+#include <stdio.h>
 #include "sds011lib.h"
+#include "sds011frame.h"
+#include "sds011metrics.h"
 
 /**
  * @mainpage 
@@ -38,47 +42,13 @@
 
 /**************************************************************************/
 /*!
-    @brief  constructor for the class
+    @brief  constructor for the class; debugging is off until setDebug(),
+    which may come before begin()
 */
 /**************************************************************************/
-sds011::sds011(void) {
+sds011::sds011(void) : _rx(0), _tx(0), _debug(false), _state(), _error(SDS011_OK) {
 
 }
-/**************************************************************************/
-/*!
-    @brief function to communicate to sensor by sending a command and fetch the response into a buffer.
-    @param command one byte of the command to be sent
-    @param option_1 first parameter of the command, depends on different positions in the command array
-    @param option_2 second parameter of the command, depends on different positions in the command array
-    @param id_1 the id_lsb where commands to be send
-    @param id_2 the id_msb where commands to be send
-    @param reply ten bytes of the command response
-    @returns status tells the seccessful execution
-*/
-/**************************************************************************/
-bool sds011::sdsCommunicate( uint8_t command, uint8_t option_1, uint8_t  option_2, uint8_t id_1, uint8_t id_2, uint8_t reply[10]  )
-{
-  bool status=false;
-  uint8_t i, lc, wait = MAX_WAIT;
-  for(uint8_t lc = 0; lc < 10 && status == false; ++lc)
-  {
-    i = sendCommand(  command,  option_1,   option_2,  id_1,  id_2 );
-    
-    if( i >= wait )
-    {
-      if( _debug)Serial.println("data unavailable, exiting...");
-      i = 0;
-      status = false;
-      if ( (command == CMD_SLEEP_AND_WORK && option_1 == WRITE_MODE && option_2 == WORK_MODE) ) { 
-        // wake from sleep.
-        break;
-      }
-    }
-    status = getResponse( command, reply );
-  }
-  return( status );
-}
-
 /// Sends command to the sensor. 
 /// 
 /// Specification from the Nova Fitness Co. Ltd. Laser Dust Sensor Control Protocol, V1.4  
@@ -113,173 +83,24 @@ bool sds011::sdsCommunicate( uint8_t command, uint8_t option_1, uint8_t  option_
 ///
 /**************************************************************************/
 /*!
-    @brief function to send the command to sensor and fetch the response into a buffer.
+    @brief function to communicate to sensor by sending a command and fetch the response into a buffer.
     When no reply is received, usually this is because device was just reporting.
     This happens when device is in reporting mode, as then the device spits out a
-    a continuous stream of data. In such cases. command has to be sent again to get an answer.    
+    a continuous stream of data. In such cases. command has to be sent again to get an answer.
+    The frame is laid out by sds011MakeRequest (sds011frame.h) and written in one go;
+    the retries and the handling of reports met on the way are those of sds011Core::communicate.
     @param command one byte of the command to be sent
     @param option_1 first parameter of the command, depends on different positions in the command array
     @param option_2 second parameter of the command, depends on different positions in the command array
     @param id_1 the id_lsb where commands to be send
     @param id_2 the id_msb where commands to be send
-    @returns status tells the seccessful execution
-*/
-/**************************************************************************/
-uint8_t sds011::sendCommand( uint8_t command, uint8_t option_1, uint8_t  option_2, uint8_t id_1, uint8_t id_2 )
-{
-  uint8_t wait=MAX_WAIT,i;
-  //bool status=false;  
-  if( _debug)Serial.println("Sending command...       ");
-  
-  uint8_t checksum = command + option_1 + option_2 + id_1 + id_2;
-  _uart->write((uint8_t)MSG_HEAD);
-  _uart->write((uint8_t)CMD_WRITE_MODE);
-  _uart->write(command);
-  if ((command == (uint8_t)CMD_REPORTING_MODE) || (command == (uint8_t)CMD_SLEEP_AND_WORK) || (command == (uint8_t)CMD_WORKING_PERIOD)) 
-  {
-    _uart->write(option_1); 
-    _uart->write(option_2);
-  }
-  for ( i = 0; i < 10; i++) 
-  {
-    _uart->write((uint8_t)MSG_RESERVED);
-  }
-  if (command == (uint8_t)CMD_SET_DEVICE_ID) 
-  {
-    _uart->write(option_1); 
-    _uart->write(option_2);
-  }else if ((command == (uint8_t)CMD_QUERY_DATA) || (command == (uint8_t)CMD_FIRMWARE_VERSION)) 
-  {
-    _uart->write((uint8_t)MSG_RESERVED);
-    _uart->write((uint8_t)MSG_RESERVED);
-  }
-  _uart->write(id_1);
-  _uart->write(id_2);
-  _uart->write(checksum);
-  _uart->write((uint8_t)MSG_TAIL);
-  _uart->flush();
-  
-  delay(300);
-    
-  for( i=0; !_uart->available() && i < wait ; ++i )
-  {
-    delay(20);
-  }
-  
-  //status=true;
-  return(i);
-}
-
-/// Prompts sensor to report measurement data. If sensor is in report query mode, an according query command is sent first, otherwise, the next measurent reported in the 
-/// 
-/// Specification from the Nova Fitness Co. Ltd. Laser Dust Sensor Control Protocol, V1.4  
-/// 
-/// | Byte  |  Name           || Set Mode Reply    | Query Data Reply| Set ID reply    | Sleep / Work Reply | FW Version Reply| Working Period Reply|                 
-/// | :---: | :-------------- || :---------------- | :-------------- | :-------------- | :----------------- | :-------------- | :------------------ |                  
-/// | 0     |  Message header || AA                | AA              | AA              | AA                 | AA              | AA                  |                 
-/// | 1     |  Command ID     || C5                | C0              | C5              | C5                 | C5              | C5                  |                 
-/// | 2     |  DATA 1         || 2                 | PM2.5 Low byte  | 5               | 6                  | 7               | 8                   |                 
-/// | 3     |  DATA 2         || 0: query / 1: set | PM2.5 High byte | 0               | 0: query / 1: set  | Byte 1: year    | 0: query / 1: set   |                 
-/// | 4     |  DATA 3         || 0: auto / 1: query| PM10 Low byte   | 0               | 0: sleep / 1: work | Byte 2: month   | 0: continuous / 1-30: minutes sleep | 
-/// | 5     |  DATA 4         || 0                 | PM10 High byte  | 0               | 0                  | Byte 3: day     | 0                   |
-/// | 6     |  DATA 5         || ID byte 1         | ID byte 1       | New ID byte 1   | ID byte 1          | ID byte 1       | ID byte 1           |
-/// | 7     |  DATA 6         || ID byte 2         | ID byte 2       | New ID byte 2   | ID byte 2          | ID byte 2       | ID byte 2           |
-/// | 8     |  Check-sum      || Check-sum         | Check-sum       | Check-sum       | Check-sum          | Check-sum       | Check-sum           |
-/// | 9     |  Message tail   || AB                | AB              | AB              | AB                 | AB              | AB                  |
-///                                                                
-/// | Calculation  ||
-/// | :----------  | :-------------------------------------------------------------|
-/// | Check-sum:   | Check-sum = DATA1 + DATA2 + ... + DATA6                       |
-/// | PM2.5 value: | PM2.5 (μg /m3) = ((PM2.5 High byte *256) + PM2.5 low byte)/10 |
-/// | PM10 value:  | PM10 (μg /m3) = ((PM10 high byte*256) + PM10 low byte)/10     |
-/// 
-/// @see https://web.archive.org/web/20200525083221/https://www-sd-nf.oss-cn-beijing.aliyuncs.com/%E5%AE%98%E7%BD%91%E4%B8%8B%E8%BD%BD/sds011%20laser%20PM2.5%20sensor%20specification-V1.4.pdf
-/// @see https://www.arduinoforum.de/attachment.php?aid=3023
-/// 
-/**************************************************************************/
-/*!
-    @brief function to send the command to sensor and fetch the response into a buffer.
-    When no reply is received, usually this is because device was just reporting.
-    This happens when device is in reporting mode, as then the device spits out a
-    a continuous stream of data.   
-    In such cases. command has to be sent again to get an answer.    
-    @param cmd one byte of the command to be sent
     @param reply ten bytes of the command response
     @returns status tells the seccessful execution
 */
 /**************************************************************************/
-bool sds011::getResponse(uint8_t cmd, uint8_t reply[10] )
+bool sds011::sdsCommunicate( uint8_t command, uint8_t option_1, uint8_t  option_2, uint8_t id_1, uint8_t id_2, uint8_t reply[10]  )
 {
-  uint8_t checksum=0,i, lc, wait=MAX_WAIT;
-  bool status=false;
-
-  if( _debug )Serial.println("Receiving response... ");
-  
-  for( i=0, status=true, checksum=0; _uart->available() && i < 10; ++i) 
-  {
-    reply[i] = _uart->read();
-    if (i>1 && i < 8)checksum += reply[i];
-    if( _debug){ Serial.print(" "); Serial.print(reply[i], HEX); }
-    switch(i)
-    {
-      case 0:
-        if ( reply[0] != MSG_HEAD )
-        {
-          if( _debug){ Serial.print("invalid header received "); Serial.println( reply[i], HEX );}
-          status = false;
-        }
-        break;
-      case 1:
-        if ( cmd != CMD_QUERY_DATA )
-        { 
-          if ( reply[1] != REPLY_CFG )
-          {
-            if( _debug){ Serial.print(" invalid reply received "); Serial.println( reply[i], HEX ); }
-            status = false;
-          }
-        }else
-        {
-          if ( reply[1] != REPLY_DATA )
-          {
-            if( _debug){ Serial.print(" invalid reply received "); Serial.println( reply[i], HEX);}
-            status = false;
-          }
-        } 
-        break;
-      case 2:
-        if ( cmd != CMD_QUERY_DATA )
-        {
-          if ( reply[2] != cmd )
-          {
-            if( _debug){ Serial.print(" wrong command received "); Serial.println( reply[i], HEX );}
-            status = false;
-          }
-        }
-        break;
-      case 8:
-        if ( checksum != reply[8] )
-        {
-          if( _debug){ Serial.print(" wrong checksum found"); Serial.print( checksum, HEX );Serial.print(" while received "); Serial.println(reply[8], HEX );}
-          status = false;
-        }
-        break;
-      case 9:
-        if( reply[9] != MSG_TAIL )
-        {
-          status = false;
-        }
-        break;
-      default:
-        break;
-    }
-    yield();
-  }
-    
-  if ( i < 10 ) status = false;
-  if( _debug){ Serial.println(""); Serial.print("seccessful response, read "); Serial.print(i); Serial.print( " bytes: "); Serial.print( status?"ok":"error" ); Serial.println("--"); } 
-  
-  return( status );
-
+  return( ( _error = communicate( command, option_1, option_2, id_1, id_2, reply ) ) == SDS011_OK );
 }
 
 /**************************************************************************/
@@ -306,9 +127,7 @@ bool sds011::dataReportingModeCmd( uint8_t *response, uint8_t mod, uint8_t wr ){
 	
     if( (status = sdsCommunicate( CMD_REPORTING_MODE, wr, mod,_id_1, _id_2, reply )) ){ 
 		if( _debug){
-			char str[50];
-			sprintf( str, "Device Id = %02X %02X and  Mode = %s\n", reply[6],reply[7],reply[4] == QUERY_MODE?"Querymode":"Reportingmode" );
-			Serial.println ( str );
+			debugf( "Device Id = %02X %02X and  Mode = %s\n", reply[6],reply[7],reply[4] == QUERY_MODE?"Querymode":"Reportingmode" );
 		}
 	
 		if ( wr == WRITE_MODE && reply[4] != mod ){
@@ -331,25 +150,61 @@ bool sds011::dataReportingModeCmd( uint8_t *response, uint8_t mod, uint8_t wr ){
 */
 /**************************************************************************/
 bool sds011::dataQueryCmd( float *pm10, float *pm25 ){
-	//     0    1    2    3    4    5    6    7    8    9   10   11   12   13   14         15          16    17    18
-	// { 0xAA,0xB4,0x04,  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,_id_1, _id_2, 0x00, 0xAB}; 
-	uint8_t reply[10];
+	sds011Sample sample;
 	bool status=false;
-	
 
-    if( (status = sdsCommunicate( CMD_QUERY_DATA, 0, 0,_id_1, _id_2, reply )) ){ 
-		*pm25 = (float) ( reply[2] + (reply[3]<<8 ) ) / 10.0;
-		*pm10 = (float) ( reply[4] + (reply[5]<<8 ) ) / 10.0;
-		if( _debug){
-			Serial.print("Data : pm10 ");	Serial.print( *pm10, 2);Serial.print(" pm2.5 ");Serial.print( *pm25, 2);Serial.print(" status : ");	Serial.println( status);		}	
+	if( (status = dataQueryRaw( &sample )) ){
+		*pm25 = sds011DeciToFloat( sample.pm25 );
+		*pm10 = sds011DeciToFloat( sample.pm10 );
 	}
-	
 	return( status );	
 }
+
+/// Prompts sensor to report measurement data. If sensor is in report query mode, an according query command is sent first, otherwise, the next measurent reported in the 
+/// 
+/// Specification from the Nova Fitness Co. Ltd. Laser Dust Sensor Control Protocol, V1.4  
+/// 
+/// | Byte  |  Name           || Set Mode Reply    | Query Data Reply| Set ID reply    | Sleep / Work Reply | FW Version Reply| Working Period Reply|                 
+/// | :---: | :-------------- || :---------------- | :-------------- | :-------------- | :----------------- | :-------------- | :------------------ |                  
+/// | 0     |  Message header || AA                | AA              | AA              | AA                 | AA              | AA                  |                 
+/// | 1     |  Command ID     || C5                | C0              | C5              | C5                 | C5              | C5                  |                 
+/// | 2     |  DATA 1         || 2                 | PM2.5 Low byte  | 5               | 6                  | 7               | 8                   |                 
+/// | 3     |  DATA 2         || 0: query / 1: set | PM2.5 High byte | 0               | 0: query / 1: set  | Byte 1: year    | 0: query / 1: set   |                 
+/// | 4     |  DATA 3         || 0: auto / 1: query| PM10 Low byte   | 0               | 0: sleep / 1: work | Byte 2: month   | 0: continuous / 1-30: minutes sleep | 
+/// | 5     |  DATA 4         || 0                 | PM10 High byte  | 0               | 0                  | Byte 3: day     | 0                   |
+/// | 6     |  DATA 5         || ID byte 1         | ID byte 1       | New ID byte 1   | ID byte 1          | ID byte 1       | ID byte 1           |
+/// | 7     |  DATA 6         || ID byte 2         | ID byte 2       | New ID byte 2   | ID byte 2          | ID byte 2       | ID byte 2           |
+/// | 8     |  Check-sum      || Check-sum         | Check-sum       | Check-sum       | Check-sum          | Check-sum       | Check-sum           |
+/// | 9     |  Message tail   || AB                | AB              | AB              | AB                 | AB              | AB                  |
+///                                                                
+/// | Calculation  ||
+/// | :----------  | :-------------------------------------------------------------|
+/// | Check-sum:   | Check-sum = DATA1 + DATA2 + ... + DATA6                       |
+/// | PM2.5 value: | PM2.5 (μg /m3) = ((PM2.5 High byte *256) + PM2.5 low byte)/10 |
+/// | PM10 value:  | PM10 (μg /m3) = ((PM10 high byte*256) + PM10 low byte)/10     |
+/// 
+/// @see https://web.archive.org/web/20200525083221/https://www-sd-nf.oss-cn-beijing.aliyuncs.com/%E5%AE%98%E7%BD%91%E4%B8%8B%E8%BD%BD/sds011%20laser%20PM2.5%20sensor%20specification-V1.4.pdf
+/// @see https://www.arduinoforum.de/attachment.php?aid=3023
+/// 
+/**************************************************************************/
+/*!
+    @brief function to retrieve PM values as raw integers, without any
+    float conversion. A report held back before is dropped, the answer is newer.
+    @param sample returned id, receive time and PM values in 0.1 ug/m3
+    @returns status tells the seccessful execution
+*/
+/**************************************************************************/
+bool sds011::dataQueryRaw( sds011Sample *sample ){
+	//     0    1    2    3    4    5    6    7    8    9   10   11   12   13   14         15          16    17    18
+	// { 0xAA,0xB4,0x04,  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,_id_1, _id_2, 0x00, 0xAB}; 
+	return( ( _error = measure( sample ) ) == SDS011_OK );
+}
+
 /**************************************************************************/
 /*!
     @brief function to retrieve PM values with out Query command, it will send automatically at the interval
-    set by the work period command
+    set by the work period command. A frame reported while another command was
+    waiting for its reply is returned first.
     @param pm10 returned value of PM10 sensor value
     @param pm25 returned value of PM25 sensor value
     @returns status tells the seccessful execution
@@ -357,28 +212,29 @@ bool sds011::dataQueryCmd( float *pm10, float *pm25 ){
 /**************************************************************************/
 bool sds011::dataAutoQueryCmd( float *pm10, float *pm25 )
 {
-  uint8_t reply[10];
+  sds011Sample sample;
   bool status=false;
-  uint8_t i, lc, wait = MAX_WAIT;
-  
-  for(uint8_t lc = 0; lc < 10 && status == false; ++lc)
-  {
-    if( i >= wait )
-    {
-      if( _debug)Serial.println("data unavailable, exiting...");
-      i = 0;
-      status = false;
-    }
-    status = getResponse( (uint8_t)CMD_QUERY_DATA, reply );
-  }
 
-  *pm25 = (float) ( reply[2] + (reply[3]<<8 ) ) / 10.0;
-  *pm10 = (float) ( reply[4] + (reply[5]<<8 ) ) / 10.0;
-  if( _debug){
-    Serial.print("Data : pm10 "); Serial.print( *pm10, 2);Serial.print(" pm2.5 ");Serial.print( *pm25, 2);Serial.print(" status : "); Serial.println( status);    } 
-  
+  if( (status = dataAutoQueryRaw( &sample )) ){
+    *pm25 = sds011DeciToFloat( sample.pm25 );
+    *pm10 = sds011DeciToFloat( sample.pm10 );
+  }
   return( status ); 
 }
+
+/**************************************************************************/
+/*!
+    @brief function to retrieve auto reported PM values as raw integers,
+    without any float conversion
+    @param sample returned id, receive time and PM values in 0.1 ug/m3
+    @returns status tells the seccessful execution
+*/
+/**************************************************************************/
+bool sds011::dataAutoQueryRaw( sds011Sample *sample )
+{
+  return( ( _error = report( sample ) ) == SDS011_OK );
+}
+
 /**************************************************************************/
 /*!
     @brief function to set new id/serial number for the sensor.
@@ -398,35 +254,15 @@ bool sds011::dataAutoQueryCmd( float *pm10, float *pm25 )
 bool sds011::deviceIdCmd( uint8_t response[2], uint8_t new_Id1, uint8_t new_Id2 ){
 	//     0    1    2   3    4    5    6    7    8    9   10   11   12          13          14           15          16     17    18
 	//{ 0xAA,0xB4,0x05,  0,   0,   0,   0,   0,   0,   0,   0,   0,   0, new_Id1, new_Id2, _id_1, _id_2, 0x00, 0xAB}; 
-	uint8_t reply[10];
-	bool status=false;
-	
+	sds011IdResult result;
+
 	response[0] = _id_1;
 	response[1] = _id_2;
-	
-
-		if( (status = sdsCommunicate( CMD_SET_DEVICE_ID, new_Id1, new_Id2,_id_1, _id_2, reply )) ){ 
-		
-		if ( reply[6] != new_Id1 || reply[7] != new_Id2 ) {
-			if( _debug){
-				char str[50];
-				sprintf( str,"Setting Device Id Failed. Tried = %02X %02X, Returned = %02X %02X\n", new_Id1, new_Id2, reply[6], reply[7]  );
-				Serial.println( str );
-			}
-		
-			status = false;
-		}else{
-			if ( _id_1 != MSG_FF || _id_2 != MSG_FF ){
-				_id_1 = new_Id1;
-				_id_2 = new_Id2;	
-			}
-			
-			response[0] = reply[6];
-			response[1] = reply[7];
-		}
-	}
-	
-	return( status );	
+	result = changeId( (uint16_t)( new_Id1 | ( new_Id2 << 8 ) ) );
+	if ( ( _error = result.error ) != SDS011_OK ) return( false );
+	response[0] = (uint8_t)result.id;
+	response[1] = (uint8_t)( result.id >> 8 );
+	return( true );
 }
 
 
@@ -455,9 +291,7 @@ bool sds011::sleepWorkModeCmd( uint8_t *response, uint8_t mod,uint8_t wr){
 
 		if( (status = sdsCommunicate( CMD_SLEEP_AND_WORK, wr, mod,_id_1, _id_2, reply )) ){ 
 		if( _debug){
-			char str[50];
-			sprintf(str, "Device Id = %02X %02X and Mode = %s\n", reply[6],reply[7],reply[4] == WORK_MODE?"Working":"Sleeping" );
-			Serial.println( str );
+			debugf( "Device Id = %02X %02X and Mode = %s\n", reply[6],reply[7],reply[4] == WORK_MODE?"Working":"Sleeping" );
 		}
 		*response = reply[4];
 		if ( wr == WRITE_MODE && reply[4] != mod ){
@@ -465,7 +299,7 @@ bool sds011::sleepWorkModeCmd( uint8_t *response, uint8_t mod,uint8_t wr){
 		}
 	}else{
 		if ( wr == WRITE_MODE && mod == WORK_MODE ){
-			if( _debug)Serial.println("No Reply Received After Entering Working Mode." );
+			if( _debug)debugf("No Reply Received After Entering Working Mode.\n" );
 		}
 	}
 	return( status );	
@@ -495,48 +329,370 @@ bool sds011::workPeriodCmd( uint8_t *response, uint8_t minutes,uint8_t wr ){
 	
 		if( (status = sdsCommunicate( CMD_WORKING_PERIOD, wr, minutes,_id_1, _id_2, reply )) ){ 
 		if( _debug){
-			char str[50];
-			sprintf(str, "Device id = %02X %02X : Work Period = %s %d %s\n", reply[6],reply[7],reply[4] == 0?"Continuous":"Interval = ",reply[4] == 0?0:reply[4], reply[4] == 0?".":"minutes." );
-			Serial.println( str );
+			debugf( "Device id = %02X %02X : Work Period = %s %d %s\n", reply[6],reply[7],reply[4] == 0?"Continuous":"Interval = ",reply[4] == 0?0:reply[4], reply[4] == 0?".":"minutes." );
 			}
-	}	
-	if ( wr == WRITE_MODE && reply[4] != minutes ){
-		status = false;
-	}
-	if ( status ){
 		*response = reply[4];
+		if ( wr == WRITE_MODE && reply[4] != minutes ){
+			status = false;
+		}
 	}
 	return( status );	
 }
 
 
+/**************************************************************************/
+/*!
+    @brief  sends a reporting mode, sleep / work or work period command and
+    checks the reply
+    @param command CMD_REPORTING_MODE, CMD_SLEEP_AND_WORK or CMD_WORKING_PERIOD
+    @param wr READ_MODE or WRITE_MODE
+    @param value the value to write
+    @param current receives the value of the reply, unchanged on failure
+    @returns SDS011_OK or the cause of the failure
+*/
+/**************************************************************************/
+sds011Error sds011::setting( uint8_t command, uint8_t wr, uint8_t value, uint8_t *current ){
+	return( _error = configure( command, wr, value, current ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  queries one measurement, see dataQueryRaw
+    @returns the sample and SDS011_OK, or the cause of the failure
+*/
+/**************************************************************************/
+sds011SampleResult sds011::query(void){
+	sds011SampleResult result;
+
+	memset( &result.sample, 0, sizeof( result.sample ) );
+	result.error = dataQueryRaw( &result.sample ) ? SDS011_OK : _error;
+	return( result );
+}
+
+/**************************************************************************/
+/*!
+    @brief  reads the firmware date and the id of the device
+    @returns the date as integers and SDS011_OK, or the cause of the failure
+    with a zero date
+*/
+/**************************************************************************/
+sds011Firmware sds011::firmware(void){
+	sds011Firmware result = readFirmware();
+
+	_error = result.error;
+	return( result );
+}
+
+/**************************************************************************/
+/*!
+    @brief  sets a new device id, see deviceIdCmd
+    @param id the new id, ID byte 1 as the lower byte; FFFF is not allowed
+    @returns the confirmed id and SDS011_OK, or the cause of the failure
+    with the id of the reply, if any
+*/
+/**************************************************************************/
+sds011IdResult sds011::setId( uint16_t id ){
+	sds011IdResult result = { SDS011_ERR_RANGE, 0 };
+
+	if ( id == 0xFFFF ) return( result );
+	result = changeId( id );
+	_error = result.error;
+	return( result );
+}
+
+/**************************************************************************/
+/*!
+    @brief  reads the reporting mode
+    @returns the mode and SDS011_OK, or the cause of the failure
+*/
+/**************************************************************************/
+sds011ModeResult sds011::reportMode(void){
+	uint8_t mode = AUTO_REPORT_MODE;
+	sds011ModeResult result;
+
+	result.error = setting( CMD_REPORTING_MODE, READ_MODE, DONT_CARE, &mode );
+	result.mode = mode == QUERY_MODE ? SDS011_REPORT_QUERY : SDS011_REPORT_AUTO;
+	return( result );
+}
+
+/**************************************************************************/
+/*!
+    @brief  sets the reporting mode
+    @param mode the new mode
+    @returns the mode of the reply and SDS011_OK, or the cause of the failure
+*/
+/**************************************************************************/
+sds011ModeResult sds011::setReportMode( sds011ReportMode mode ){
+	uint8_t current = mode;
+	sds011ModeResult result;
+
+	result.error = setting( CMD_REPORTING_MODE, WRITE_MODE, mode, &current );
+	result.mode = current == QUERY_MODE ? SDS011_REPORT_QUERY : SDS011_REPORT_AUTO;
+	return( result );
+}
+
+/**************************************************************************/
+/*!
+    @brief  reads the sleep / work state. A sleeping sensor does not answer,
+    so SDS011_ERR_SILENT usually means it sleeps.
+    @returns the state and SDS011_OK, or the cause of the failure
+*/
+/**************************************************************************/
+sds011PowerResult sds011::power(void){
+	uint8_t state = SLEEP_MODE;
+	sds011PowerResult result;
+
+	result.error = setting( CMD_SLEEP_AND_WORK, READ_MODE, DONT_CARE, &state );
+	result.power = state == WORK_MODE ? SDS011_POWER_WORK : SDS011_POWER_SLEEP;
+	return( result );
+}
+
+/**************************************************************************/
+/*!
+    @brief  puts the sensor to sleep or wakes it up. A waking sensor often
+    does not answer; SDS011_ERR_SILENT then does not mean it still sleeps.
+    @param power the new state
+    @returns the state of the reply and SDS011_OK, or the cause of the failure
+*/
+/**************************************************************************/
+sds011PowerResult sds011::setPower( sds011Power power ){
+	uint8_t current = power;
+	sds011PowerResult result;
+
+	result.error = setting( CMD_SLEEP_AND_WORK, WRITE_MODE, power, &current );
+	result.power = current == WORK_MODE ? SDS011_POWER_WORK : SDS011_POWER_SLEEP;
+	return( result );
+}
+
+/**************************************************************************/
+/*!
+    @brief  reads the work period
+    @returns the minutes and SDS011_OK, or the cause of the failure
+*/
+/**************************************************************************/
+sds011PeriodResult sds011::workPeriod(void){
+	sds011PeriodResult result = { SDS011_OK, 0 };
+
+	result.error = setting( CMD_WORKING_PERIOD, READ_MODE, DONT_CARE, &result.minutes );
+	return( result );
+}
+
+/**************************************************************************/
+/*!
+    @brief  sets the work period
+    @param minutes 0 for continuous, or 1 - 30 minutes between measurements
+    @returns the minutes of the reply and SDS011_OK, or the cause of the failure
+*/
+/**************************************************************************/
+sds011PeriodResult sds011::setWorkPeriod( uint8_t minutes ){
+	sds011PeriodResult result = { SDS011_ERR_RANGE, minutes };
+
+	if ( minutes > 30 ) return( result );
+	result.error = setting( CMD_WORKING_PERIOD, WRITE_MODE, minutes, &result.minutes );
+	return( result );
+}
+
 /**************************************************************************/
 /*!
     @brief Used to get the device firmware version and serial number.
-    response[3] contains firmware date as YY, MM, DD if succesful else FF FF FF.
+    ver is set to the firmware date as "20YY-MM-DD" only when the device
+    answered; firmware() gives the same without a String.
     @param ver string version to hold the firware version
     @param id integer to hold the serial number
     @returns status the status of the command
 */
 /**************************************************************************/
+#ifdef ARDUINO
 bool sds011::deviceInfoCmd( String *ver, uint16_t *id ){
-// 0    1    2    3    4    5    6    7    8    9   10   11   12   13   14         15          16    17    18
-//{ 0xAA,0xB4,0x07,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,_id_1, _id_2, 0x00, 0xAB}; 
-	uint8_t reply[10];
-	bool status = false;
-  char str[50];
-		
-		if( (status = sdsCommunicate( CMD_FIRMWARE_VERSION, 0, 0,_id_1, _id_2, reply )) ){ 
-		if ( _debug){
-				
-				sprintf(str, "Device Id = %02X %02X and Firmware Version = 20%02d-%02d-%02d\n", reply[6],reply[7], reply[3],reply[4],reply[5]);
-				Serial.println( str);	
-		}		
+  sds011Firmware fw = firmware();
+  char str[16];
+
+  if ( fw.error != SDS011_OK ) return( false );
+  snprintf( str, sizeof( str ), "%u-%02u-%02u\n", fw.year, fw.month, fw.day );
+  *ver = str;
+  *id = fw.id;
+  return( true );
+}
+#endif
+
+/**************************************************************************/
+/*!
+    @brief  updates the cached device settings from a received frame.
+    Only a sensor that is awake answers, so every frame also tells the
+    sensor works, unless it is the reply to going to sleep.
+    @param frame a valid reply frame
+    @returns void
+*/
+/**************************************************************************/
+void sds011::learn( const uint8_t frame[10] ){
+	bool setId = frame[1] == REPLY_CFG && frame[2] == CMD_SET_DEVICE_ID;
+
+	// frames of other sensors on the same line; the reply to a new id carries the new id
+	if ( !setId && !( _id_1 == MSG_FF && _id_2 == MSG_FF ) && ( frame[6] != _id_1 || frame[7] != _id_2 ) ) return;
+
+	_state.id = sds011ReplyId( frame );
+	_state.work = WORK_MODE;
+	_state.known |= SDS011_FIELD_ID | SDS011_FIELD_WORK;
+	if ( frame[1] != REPLY_CFG ) return;
+	switch( frame[2] ){
+		case CMD_REPORTING_MODE:
+			_state.mode = frame[4];
+			_state.known |= SDS011_FIELD_MODE;
+			break;
+		case CMD_SLEEP_AND_WORK:
+			_state.work = frame[4];
+			break;
+		case CMD_WORKING_PERIOD:
+			_state.period = frame[4];
+			_state.known |= SDS011_FIELD_PERIOD;
+			break;
+		case CMD_FIRMWARE_VERSION:
+			memcpy( _state.firmware, frame + 3, 3 );
+			_state.known |= SDS011_FIELD_FIRMWARE;
+			break;
+	}
+}
+
+/**************************************************************************/
+/*!
+    @brief  brings the sensor to a configuration profile with as few
+    commands as possible. Fields whose value is already known from earlier
+    replies (or setState()) are not sent at all. The commands are written
+    back to back (wake, reporting mode, work period, id, sleep) and their
+    replies, which come in order, collected in one pass and verified; each
+    reply tells the timeouts how long its command took after the one
+    before. A waking sensor often does not answer, so a missing reply to
+    the wake is passed over and the replies after it tell whether it is up.
+    Any other command whose reply is missing or wrong is sent once more on
+    its own, with the usual retries.
+    @param profile the settings to apply, see sds011Profile
+    @param sent receives the number of command frames written, may be NULL
+    @returns true when every field of the profile is confirmed, false with
+    nothing sent for id FF FF or a work period above 30 minutes
+*/
+/**************************************************************************/
+bool sds011::applyProfile( const sds011Profile &profile, uint8_t *sent ){
+	uint8_t cmd[5], value[5], id[5][2], n = 0, done = 0, count = 0, i, reply[10];
+	bool confirmed[5];
+	uint8_t id_1 = _id_1, id_2 = _id_2;
+	uint16_t newId = (uint16_t)( profile.id_1 | ( profile.id_2 << 8 ) );
+	bool status = true, wake = false, ok;
+	const uint8_t *frame;
+	unsigned long start, last, deadline;
+
+	if ( sent ) *sent = 0;
+	// the range checks of setId() and setWorkPeriod()
+	if ( ( ( profile.fields & SDS011_FIELD_ID ) && newId == 0xFFFF )
+	     || ( ( profile.fields & SDS011_FIELD_PERIOD ) && profile.period > 30 ) ) return( false );
+
+	if ( ( profile.fields & SDS011_FIELD_WORK ) && profile.work == WORK_MODE
+	     && !( ( _state.known & SDS011_FIELD_WORK ) && _state.work == WORK_MODE ) )
+	{
+		// a sleeping sensor ignores everything else; any reply tells it is up again
+		wake = true;
+		_state.known &= ~SDS011_FIELD_WORK;
+		cmd[n] = CMD_SLEEP_AND_WORK;
+		value[n++] = WORK_MODE;
+	}
+	if ( ( profile.fields & SDS011_FIELD_MODE ) && !( ( _state.known & SDS011_FIELD_MODE ) && _state.mode == profile.mode ) )
+	{
+		cmd[n] = CMD_REPORTING_MODE;
+		value[n++] = profile.mode;
+	}
+	if ( ( profile.fields & SDS011_FIELD_PERIOD ) && !( ( _state.known & SDS011_FIELD_PERIOD ) && _state.period == profile.period ) )
+	{
+		cmd[n] = CMD_WORKING_PERIOD;
+		value[n++] = profile.period;
+	}
+	if ( ( profile.fields & SDS011_FIELD_ID ) && !( ( _state.known & SDS011_FIELD_ID ) && _state.id == newId ) )
+	{
+		cmd[n] = CMD_SET_DEVICE_ID;
+		value[n++] = profile.id_1;
 	}
- sprintf(str, "20%02d-%02d-%02d\n", reply[3],reply[4],reply[5]);
- *ver = str;
- *id = reply[7]*256+reply[6];
- return( status );
+	if ( ( profile.fields & SDS011_FIELD_WORK ) && profile.work == SLEEP_MODE
+	     && !( ( _state.known & SDS011_FIELD_WORK ) && _state.work == SLEEP_MODE ) )
+	{
+		cmd[n] = CMD_SLEEP_AND_WORK;
+		value[n++] = SLEEP_MODE;
+	}
+	if ( n == 0 ) return( true );
+
+	// write all frames at once; after a new id the sensor only listens to that id
+	start = millis();
+	deadline = start;
+	for ( i = 0; i < n; ++i )
+	{
+		id[i][0] = id_1;
+		id[i][1] = id_2;
+		SDS011_METRIC_COUNT( commands );
+		if ( cmd[i] == CMD_SET_DEVICE_ID )
+		{
+			send( cmd[i], profile.id_1, profile.id_2, id_1, id_2 );
+			if ( id_1 != MSG_FF || id_2 != MSG_FF )
+			{
+				id_1 = profile.id_1;
+				id_2 = profile.id_2;
+			}
+		}else
+		{
+			send( cmd[i], WRITE_MODE, value[i], id_1, id_2 );
+		}
+		deadline += wake && i == 0 ? SDS011_WAKE_TIMEOUT : _timeouts.timeout( cmd[i] );
+	}
+	count = n;
+
+	// collect the replies in order, data reports in between are kept as in receive
+	last = start;
+	while ( done < n )
+	{
+		while ( done < n && _uart->available() )
+		{
+			if ( !_parser.push( (uint8_t)_uart->read() ) ) continue;
+			frame = _parser.frame();
+			learn( frame );
+			// the wake was not answered, the sensor answers the next command
+			if ( wake && done == 0 && n > 1 && sds011ReplyAnswers( frame, cmd[1] ) ) confirmed[done++] = false;
+			if ( sds011ReplyAnswers( frame, cmd[done] ) )
+			{
+				// the sensor starts on a command when it is done with the one before
+				_timeouts.observe( cmd[done], millis() - last );
+				last = millis();
+				confirmed[done] = cmd[done] == CMD_SET_DEVICE_ID
+				    ? ( frame[6] == profile.id_1 && frame[7] == profile.id_2 ) : frame[4] == value[done];
+				if ( confirmed[done] && cmd[done] == CMD_SET_DEVICE_ID ) useId( profile.id_1, profile.id_2 );
+				++done;
+			}else if ( frame[1] == REPLY_DATA )
+			{
+				_pending.keep( frame, millis() );
+			}
+		}
+		if ( done == n || (long)( millis() - deadline ) >= 0 ) break;
+		delay(1);
+	}
+	if( _debug)debugf("profile: %d of %d replies\n", done, n );
+
+	for ( i = wake ? 1 : 0; i < n; ++i )
+	{
+		ok = i < done && confirmed[i];
+		if ( !ok )
+		{
+			// missing or refused: once more on its own, with the usual retries
+			SDS011_METRIC_COUNT( timeouts );
+			++count;
+			if ( cmd[i] == CMD_SET_DEVICE_ID )
+			{
+				ok = sdsCommunicate( cmd[i], profile.id_1, profile.id_2, id[i][0], id[i][1], reply )
+				     && reply[6] == profile.id_1 && reply[7] == profile.id_2;
+				if ( ok ) useId( profile.id_1, profile.id_2 );
+			}else
+			{
+				ok = sdsCommunicate( cmd[i], WRITE_MODE, value[i], id[i][0], id[i][1], reply ) && reply[4] == value[i];
+			}
+		}
+		status = status && ok;
+	}
+	if ( sent ) *sent = count;
+	return( status );
 }
 
 /**************************************************************************/
@@ -550,6 +706,28 @@ void sds011::setDebug( bool on ){
 	_debug = on;
 }
 
+/**************************************************************************/
+/*!
+    @brief  prints a formatted debugging message, to Serial on Arduino
+    and to stderr on a host
+    @param fmt printf style format
+    @returns void
+*/
+/**************************************************************************/
+void sds011::debugf( const char *fmt, ... ){
+	char str[80];
+	va_list args;
+
+	va_start( args, fmt );
+	vsnprintf( str, sizeof( str ), fmt, args );
+	va_end( args );
+#ifdef ARDUINO
+	Serial.print( str );
+#else
+	fputs( str, stderr );
+#endif
+}
+
 
 /// Specification from the Nova Fitness Co. Ltd. sds011 data sheet, V1.3 
 ///
@@ -561,6 +739,7 @@ void sds011::setDebug( bool on ){
 /// | Stop bit              | 1             |
 /// | Data Packet frequency | 1Hz           |
 
+#ifdef ARDUINO
 /**************************************************************************/
 /*!
     @brief  initializes the sds011 sensor with hardware port and pins
@@ -576,12 +755,27 @@ bool sds011::begin(HardwareSerial* uart, uint8_t rx, uint8_t tx, uint8_t id_1, u
 {
   _rx = rx;
 	_tx = tx;
-	_id_1 = id_1;
-	_id_2 = id_2;
-	
-	_debug  = false;
   uart->begin(9600,SERIAL_8N1, rx, tx);
-  _uart=uart;
-  if ( _debug) Serial.println("sensor is init.");
+  _stream.attach( uart );
+  return( begin( &_stream, id_1, id_2 ) );
+}
+#endif
+
+/**************************************************************************/
+/*!
+    @brief  initializes the sds011 sensor on any byte transport, e.g. a
+    POSIX tty or a simulated sensor on a host
+    @param transport the transport connected to the sensor, already set up for 9600 8N1
+    @param id_1 device lower byter
+    @param id_2 device higher byter
+    @returns status true when executed seccessfully
+*/
+/**************************************************************************/
+bool sds011::begin( sds011Transport *transport, uint8_t id_1, uint8_t id_2 )
+{
+	attach( transport, id_1, id_2 );
+	_state.known = 0;
+	_error = SDS011_OK;
+  if ( _debug) debugf("sensor is init.\n");
   return true;
 }
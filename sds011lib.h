@@ -7,80 +7,80 @@
 #ifndef PM_SDS011_h 
 #define PM_SDS011_h
 
-#include "Arduino.h"
-
-/// Reporting mode as auto
-#define AUTO_REPORT_MODE 0
-/// Reporting mode as queries
-#define QUERY_MODE  1
-/// get or receive
-#define READ_MODE 0
-/// set or write
-#define WRITE_MODE 1
-/// mode set to sleep
-#define SLEEP_MODE 0
-/// mode set to normal
-#define WORK_MODE  1
-/// set the maximum trials for response
-#define MAX_WAIT 30
-/// dont care while reading
-#define DONT_CARE  0
-
-/// sds response header
-#define MSG_HEAD 0xAA //170
-/// sds response footer
-#define MSG_TAIL       0xAB  //172
-/// sds response/command reserve word
-#define MSG_RESERVED   0x00 
-/// sds sending command
-#define CMD_WRITE_MODE    0xB4  //180
-/// response query data indication
-#define REPLY_DATA     0xC0  //192
-/// response query configuration indication
-#define REPLY_CFG      0xC5  //197
-/// sending command for reporting mode
-#define CMD_REPORTING_MODE       0x02 
-/// sending command for query data mode
-#define CMD_QUERY_DATA      0x04 
-/// sending command to set device id
-#define CMD_SET_DEVICE_ID         0x05 
-/// sending command for sleep and work mode
-#define CMD_SLEEP_AND_WORK      0x06 
-/// sending command for geting firmware version
-#define CMD_FIRMWARE_VERSION  0x07 
-/// sending command for working period setting
-#define CMD_WORKING_PERIOD      0x08 
-/// all set values as one
-#define MSG_FF      0xff 
+#include "sds011port.h"
+#include "sds011transport.h"
+#include "sds011parser.h"
+#include "sds011sample.h"
+#include "sds011timeout.h"
+#include "sds011profile.h"
+#include "sds011result.h"
+#include "sds011protocol.h"
+#include "sds011core.h"
 
 /// sds011 sensor class interface to interace with the hardware
-class sds011 {
+class sds011 : public sds011Core<sds011, sds011Timeouts, sds011Pending<true> > {
 	public:
 		sds011(void);
+#ifdef ARDUINO
 		bool begin(HardwareSerial* uart,	uint8_t rx, uint8_t tx, uint8_t id_1 = MSG_FF, uint8_t id_2 = MSG_FF );
+#endif
+		bool begin( sds011Transport *transport, uint8_t id_1 = MSG_FF, uint8_t id_2 = MSG_FF );
 		bool dataReportingModeCmd( 			uint8_t *response, 	uint8_t mod = AUTO_REPORT_MODE,	uint8_t wr = READ_MODE );
 		bool dataQueryCmd( float *ppm10, 		float *ppm25 );
     bool dataAutoQueryCmd( float *ppm10,    float *ppm25 );
+		bool dataQueryRaw( sds011Sample *sample );
+		bool dataAutoQueryRaw( sds011Sample *sample );
 		bool deviceIdCmd( 		uint8_t response[2], 	uint8_t new_Id1, uint8_t new_Id2 );
 		bool sleepWorkModeCmd( 		uint8_t *response, 	uint8_t mod = WORK_MODE,uint8_t wr = READ_MODE);
 		bool workPeriodCmd(		uint8_t *response, 	uint8_t minutes = 0,uint8_t wr = READ_MODE);
+#ifdef ARDUINO
 		bool deviceInfoCmd( String *ver, uint16_t *id );
+#endif
+    sds011SampleResult query(void);
+    sds011Firmware firmware(void);
+    sds011IdResult setId( uint16_t id );
+    sds011ModeResult reportMode(void);
+    sds011ModeResult setReportMode( sds011ReportMode mode );
+    sds011PowerResult power(void);
+    sds011PowerResult setPower( sds011Power power );
+    sds011PeriodResult workPeriod(void);
+    sds011PeriodResult setWorkPeriod( uint8_t minutes );
+    /// cause of the last failed command
+    sds011Error lastError(void) const { return( _error ); }
+    bool applyProfile( const sds011Profile &profile, uint8_t *sent = NULL );
+    /// device settings seen in the replies so far
+    const sds011State &state(void) const { return( _state ); }
+    /// restores settings kept across a restart of the sketch
+    void setState( const sds011State &state ) { _state = state; }
+    /// forgets the cached settings, e.g. after the sensor was replaced
+    void forgetState(void) { _state.known = 0; }
     void setDebug( bool on );
+    /// learned reply timeouts, e.g. timeouts().latency( CMD_QUERY_DATA )
+    const sds011Timeouts &timeouts(void) const { return( _timeouts ); }
   private:
+    /// the shared request / response code
+    typedef sds011Core<sds011, sds011Timeouts, sds011Pending<true> > Core;
+    friend Core;
     /// uart rx pin
     uint8_t _rx;
     /// uart tx pin
     uint8_t _tx;
-    /// serial number lower byte
-    uint8_t _id_1;
-    /// serial number lower byte
-    uint8_t _id_2;
     /// the debugging flag
     bool _debug;
-    /// the hardware uart port
-    Stream *_uart;  
-    uint8_t sendCommand( uint8_t command, uint8_t option_1, uint8_t  option_2, uint8_t id_1, uint8_t id_2 );
-    bool getResponse(uint8_t cmd, uint8_t reply[10] );
+#ifdef ARDUINO
+    /// transport wrapping the hardware uart port given to begin()
+    sds011StreamTransport _stream;
+#endif
+    /// cached device settings
+    sds011State _state;
+    /// result of the last sdsCommunicate
+    sds011Error _error;
+    void learn( const uint8_t frame[10] );
+    sds011Error setting( uint8_t command, uint8_t wr, uint8_t value, uint8_t *current );
+    void debugf( const char *fmt, ... );
+    /// debug messages of the core, printed when setDebug( true )
+    template <typename... Args>
+    void debug( const char *fmt, Args... args ) { if ( _debug ) debugf( fmt, args... ); }
     bool sdsCommunicate( uint8_t command, uint8_t option_1, uint8_t  option_2, uint8_t id_1, uint8_t id_2, uint8_t reply[10]  );
 };
 
@@ -0,0 +1,253 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (feature-configured sensor template)
+
+/// @file sds011lite.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// sds011 carries all six commands, the float and String wrappers, the
+/// cached device state and the debug messages in every build.
+/// sds011Lite<F> is the same protocol, the request / response core of
+/// sds011core.h, with only the parts a build selects in F, a set of
+/// SDS011_FEATURE_ bits, e.g. a node that reads auto reports and nothing
+/// else:
+///
+///     sds011Lite<SDS011_FEATURE_READ> sensor;
+///
+/// Commands left out are not compiled, and calling one fails to compile.
+/// Members whose feature is off (learned timeouts, the data frame held back
+/// while a command waits) take no RAM, and debug messages are not in the
+/// image unless SDS011_FEATURE_DEBUG is set. Results are the structs of
+/// sds011result.h; nothing is allocated or formatted.
+/// `make -C extras/host size` records the code and data size of several
+/// configurations.
+
+#ifndef PM_SDS011_LITE_h
+#define PM_SDS011_LITE_h
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "sds011core.h"
+#include "sds011timeout.h"
+
+/// read() of the auto reports
+#define SDS011_FEATURE_READ     0x0001
+/// query()
+#define SDS011_FEATURE_QUERY    0x0002
+/// reportMode() and setReportMode()
+#define SDS011_FEATURE_MODE     0x0004
+/// power() and setPower()
+#define SDS011_FEATURE_POWER    0x0008
+/// workPeriod() and setWorkPeriod()
+#define SDS011_FEATURE_PERIOD   0x0010
+/// setId()
+#define SDS011_FEATURE_ID       0x0020
+/// firmware()
+#define SDS011_FEATURE_FIRMWARE 0x0040
+/// all commands
+#define SDS011_FEATURE_COMMANDS 0x007e
+/// reply timeouts learned per command (sds011timeout.h) instead of SDS011_LITE_TIMEOUT
+#define SDS011_FEATURE_ADAPTIVE 0x0080
+/// dataAutoQueryCmd() and dataQueryCmd() with float results, as in sds011
+#define SDS011_FEATURE_FLOAT    0x0100
+/// debug messages, to Serial or stderr
+#define SDS011_FEATURE_DEBUG    0x0200
+/// everything, about what sds011 offers
+#define SDS011_FEATURE_ALL      0x03ff
+
+/// reply timeout without SDS011_FEATURE_ADAPTIVE in ms, twice the round trip at 9600 baud
+#define SDS011_LITE_TIMEOUT 100
+
+/// learned timeouts, SDS011_FEATURE_ADAPTIVE
+template <bool On>
+struct sds011LiteTimeouts : public sds011Timeouts {
+};
+
+/// fixed timeouts without SDS011_FEATURE_ADAPTIVE, no state
+template <>
+struct sds011LiteTimeouts<false> {
+	void reset(void) {}
+	uint32_t timeout( uint8_t command ) const { (void)command; return( SDS011_LITE_TIMEOUT ); }
+	void observe( uint8_t command, uint32_t ms ) { (void)command; (void)ms; }
+	void expired( uint8_t command ) { (void)command; }
+};
+
+/// debug messages of SDS011_FEATURE_DEBUG
+template <bool On>
+struct sds011LiteDebug {
+	/// prints a message, at most 80 characters
+	static void print( const char *fmt, ... ) {
+		char str[80];
+		va_list args;
+
+		va_start( args, fmt );
+		vsnprintf( str, sizeof( str ), fmt, args );
+		va_end( args );
+#ifdef ARDUINO
+		Serial.print( str );
+#else
+		fputs( str, stderr );
+#endif
+	}
+};
+
+/// without SDS011_FEATURE_DEBUG the messages compile to nothing
+template <>
+struct sds011LiteDebug<false> {
+	static void print( const char *fmt, ... ) { (void)fmt; }
+};
+
+/// SDS011 sensor with the features F (SDS011_FEATURE_ bits) only
+template <unsigned F>
+class sds011Lite : public sds011Core<sds011Lite<F>, sds011LiteTimeouts<( F & SDS011_FEATURE_ADAPTIVE ) != 0>,
+                                     sds011Pending<( F & SDS011_FEATURE_READ ) && ( F & SDS011_FEATURE_COMMANDS )> > {
+	public:
+		/// the features of this type
+		static const unsigned features = F;
+
+		/// attaches the transport (already set up for 9600 8N1) and the device id, MSG_FF for any
+		bool begin( sds011Transport *transport, uint8_t id_1 = MSG_FF, uint8_t id_2 = MSG_FF ) {
+			this->attach( transport, id_1, id_2 );
+			return( true );
+		}
+
+		/// waits up to MAX_WAIT * 20 ms (600 ms) for the next auto report; one received while a command waited comes first
+		sds011SampleResult read(void) {
+			static_assert( F & SDS011_FEATURE_READ, "read() needs SDS011_FEATURE_READ" );
+			sds011SampleResult result = { SDS011_OK, { 0, 0, 0, 0 } };
+
+			result.error = this->report( &result.sample );
+			return( result );
+		}
+
+		/// queries one measurement; a report held back for read() is dropped, the answer is newer
+		sds011SampleResult query(void) {
+			static_assert( F & SDS011_FEATURE_QUERY, "query() needs SDS011_FEATURE_QUERY" );
+			sds011SampleResult result = { SDS011_OK, { 0, 0, 0, 0 } };
+
+			result.error = this->measure( &result.sample );
+			return( result );
+		}
+
+		/// reads the reporting mode
+		sds011ModeResult reportMode(void) {
+			static_assert( F & SDS011_FEATURE_MODE, "reportMode() needs SDS011_FEATURE_MODE" );
+			uint8_t mode = AUTO_REPORT_MODE;
+			sds011ModeResult result;
+
+			result.error = this->configure( CMD_REPORTING_MODE, READ_MODE, DONT_CARE, &mode );
+			result.mode = mode == QUERY_MODE ? SDS011_REPORT_QUERY : SDS011_REPORT_AUTO;
+			return( result );
+		}
+
+		/// sets the reporting mode
+		sds011ModeResult setReportMode( sds011ReportMode mode ) {
+			static_assert( F & SDS011_FEATURE_MODE, "setReportMode() needs SDS011_FEATURE_MODE" );
+			uint8_t current = mode;
+			sds011ModeResult result;
+
+			result.error = this->configure( CMD_REPORTING_MODE, WRITE_MODE, mode, &current );
+			result.mode = current == QUERY_MODE ? SDS011_REPORT_QUERY : SDS011_REPORT_AUTO;
+			return( result );
+		}
+
+		/// reads the sleep / work state; a sleeping sensor does not answer
+		sds011PowerResult power(void) {
+			static_assert( F & SDS011_FEATURE_POWER, "power() needs SDS011_FEATURE_POWER" );
+			uint8_t state = SLEEP_MODE;
+			sds011PowerResult result;
+
+			result.error = this->configure( CMD_SLEEP_AND_WORK, READ_MODE, DONT_CARE, &state );
+			result.power = state == WORK_MODE ? SDS011_POWER_WORK : SDS011_POWER_SLEEP;
+			return( result );
+		}
+
+		/// puts the sensor to sleep or wakes it up; a waking sensor often does not answer
+		sds011PowerResult setPower( sds011Power power ) {
+			static_assert( F & SDS011_FEATURE_POWER, "setPower() needs SDS011_FEATURE_POWER" );
+			uint8_t current = power;
+			sds011PowerResult result;
+
+			result.error = this->configure( CMD_SLEEP_AND_WORK, WRITE_MODE, power, &current );
+			result.power = current == WORK_MODE ? SDS011_POWER_WORK : SDS011_POWER_SLEEP;
+			return( result );
+		}
+
+		/// reads the work period
+		sds011PeriodResult workPeriod(void) {
+			static_assert( F & SDS011_FEATURE_PERIOD, "workPeriod() needs SDS011_FEATURE_PERIOD" );
+			sds011PeriodResult result = { SDS011_OK, 0 };
+
+			result.error = this->configure( CMD_WORKING_PERIOD, READ_MODE, DONT_CARE, &result.minutes );
+			return( result );
+		}
+
+		/// sets the work period, 0 for continuous or 1 - 30 minutes
+		sds011PeriodResult setWorkPeriod( uint8_t minutes ) {
+			static_assert( F & SDS011_FEATURE_PERIOD, "setWorkPeriod() needs SDS011_FEATURE_PERIOD" );
+			sds011PeriodResult result = { SDS011_ERR_RANGE, minutes };
+
+			if ( minutes > 30 ) return( result );
+			result.error = this->configure( CMD_WORKING_PERIOD, WRITE_MODE, minutes, &result.minutes );
+			return( result );
+		}
+
+		/// sets a new device id, ID byte 1 as the lower byte; FFFF is not allowed. The sensor is
+		/// addressed by the new id afterwards, unless begin() addressed all sensors (FF FF)
+		sds011IdResult setId( uint16_t id ) {
+			static_assert( F & SDS011_FEATURE_ID, "setId() needs SDS011_FEATURE_ID" );
+			sds011IdResult result = { SDS011_ERR_RANGE, 0 };
+
+			if ( id == 0xFFFF ) return( result );
+			return( this->changeId( id ) );
+		}
+
+		/// reads the firmware date and the id of the device
+		sds011Firmware firmware(void) {
+			static_assert( F & SDS011_FEATURE_FIRMWARE, "firmware() needs SDS011_FEATURE_FIRMWARE" );
+			return( this->readFirmware() );
+		}
+
+		/// the next auto report as float ug/m3, as sds011::dataAutoQueryCmd()
+		bool dataAutoQueryCmd( float *pm10, float *pm25 ) {
+			static_assert( ( F & SDS011_FEATURE_FLOAT ) && ( F & SDS011_FEATURE_READ ), "dataAutoQueryCmd() needs SDS011_FEATURE_FLOAT and SDS011_FEATURE_READ" );
+			return( toFloat( read(), pm10, pm25 ) );
+		}
+
+		/// a queried measurement as float ug/m3, as sds011::dataQueryCmd()
+		bool dataQueryCmd( float *pm10, float *pm25 ) {
+			static_assert( ( F & SDS011_FEATURE_FLOAT ) && ( F & SDS011_FEATURE_QUERY ), "dataQueryCmd() needs SDS011_FEATURE_FLOAT and SDS011_FEATURE_QUERY" );
+			return( toFloat( query(), pm10, pm25 ) );
+		}
+
+		/// learned reply timeouts, with SDS011_FEATURE_ADAPTIVE
+		const sds011Timeouts &timeouts(void) const {
+			static_assert( F & SDS011_FEATURE_ADAPTIVE, "timeouts() needs SDS011_FEATURE_ADAPTIVE" );
+			return( this->_timeouts );
+		}
+
+	private:
+		/// the shared request / response code
+		typedef sds011Core<sds011Lite<F>, sds011LiteTimeouts<( F & SDS011_FEATURE_ADAPTIVE ) != 0>,
+		                   sds011Pending<( F & SDS011_FEATURE_READ ) && ( F & SDS011_FEATURE_COMMANDS )> > Core;
+		friend Core;
+		/// debug messages, empty without SDS011_FEATURE_DEBUG
+		typedef sds011LiteDebug<( F & SDS011_FEATURE_DEBUG ) != 0> Debug;
+
+		/// frames received are not cached
+		void learn( const uint8_t *frame ) { (void)frame; }
+
+		/// debug messages of the core
+		template <typename... Args>
+		void debug( const char *fmt, Args... args ) { Debug::print( fmt, args... ); }
+
+		/// float ug/m3 of a sample result
+		static bool toFloat( const sds011SampleResult &r, float *pm10, float *pm25 ) {
+			if ( r.error != SDS011_OK ) return( false );
+			*pm25 = sds011DeciToFloat( r.sample.pm25 );
+			*pm10 = sds011DeciToFloat( r.sample.pm10 );
+			return( true );
+		}
+};
+
+#endif
@@ -0,0 +1,418 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (binary sample log implementation)
+
+/// @file sds011log.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011log.h"
+
+#if SDS011_HOST
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// the four magic bytes starting every block
+static const uint8_t logMagic[4] = { 'S', 'D', 'S', 'L' };
+
+/**************************************************************************/
+/*!
+    @brief  Fletcher-16 check-sum
+    @param buf the bytes
+    @param len number of bytes
+    @returns the check-sum
+*/
+/**************************************************************************/
+static uint16_t fletcher16( const uint8_t *buf, uint16_t len ) {
+  uint16_t sum1 = 0, sum2 = 0;
+
+  while ( len-- )
+  {
+    sum1 = ( sum1 + *buf++ ) % 255;
+    sum2 = ( sum2 + sum1 ) % 255;
+  }
+  return( (uint16_t)( ( sum2 << 8 ) | sum1 ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  writes a signed difference as zigzag varint
+    @param out destination, five bytes at most are written
+    @param v the difference
+    @returns number of bytes written
+*/
+/**************************************************************************/
+static uint8_t putVarint( uint8_t *out, int32_t v ) {
+  uint32_t z = ( (uint32_t)v << 1 ) ^ (uint32_t)( v >> 31 );
+  uint8_t n = 0;
+
+  while ( z >= 0x80 )
+  {
+    out[n++] = (uint8_t)( z | 0x80 );
+    z >>= 7;
+  }
+  out[n++] = (uint8_t)z;
+  return( n );
+}
+
+/**************************************************************************/
+/*!
+    @brief  reads a zigzag varint
+    @param pos read position, advanced past the varint
+    @param end end of the readable bytes
+    @param v the decoded difference
+    @returns false when the varint runs past end or is too long
+*/
+/**************************************************************************/
+static inline bool getVarint( const uint8_t **pos, const uint8_t *end, int32_t *v ) {
+  const uint8_t *p = *pos;
+  uint32_t z = 0;
+  uint8_t shift = 0;
+
+  // a single byte is by far the most common case
+  if ( p < end && *p < 0x80 )
+  {
+    z = *p++;
+  }else
+  {
+    do
+    {
+      if ( p >= end || shift > 28 ) return( false );
+      z |= (uint32_t)( *p & 0x7f ) << shift;
+      shift += 7;
+    } while ( *p++ & 0x80 );
+  }
+  *pos = p;
+  *v = (int32_t)( ( z >> 1 ) ^ ( 0 - ( z & 1 ) ) );
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  reads a little endian 16 bit value
+    @param p the two bytes
+    @returns the value
+*/
+/**************************************************************************/
+static inline uint16_t get16( const uint8_t *p ) {
+  return( (uint16_t)( p[0] | ( p[1] << 8 ) ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  reads a little endian 32 bit value
+    @param p the four bytes
+    @returns the value
+*/
+/**************************************************************************/
+static inline uint32_t get32( const uint8_t *p ) {
+  return( (uint32_t)p[0] | ( (uint32_t)p[1] << 8 ) | ( (uint32_t)p[2] << 16 ) | ( (uint32_t)p[3] << 24 ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  checks magic, payload length and check-sum of a block
+    @param b the block
+    @returns true when the header and the payload can be trusted
+*/
+/**************************************************************************/
+static bool intact( const uint8_t *b ) {
+  uint16_t payload = get16( b + 6 );
+
+  return( memcmp( b, logMagic, 4 ) == 0 && payload <= SDS011_LOG_BLOCK - SDS011_LOG_HEADER
+          && fletcher16( b + SDS011_LOG_HEADER, payload ) == get16( b + 12 ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011LogWriter::sds011LogWriter(void) : _len(0), _count(0), _sink(NULL), _ctx(NULL), _records(0), _blocks(0) {
+}
+
+/**************************************************************************/
+/*!
+    @brief  sets the sink receiving the complete blocks
+    @param sink the sink, e.g. a flash page writer or a file writer
+    @param ctx passed to sink
+    @returns void
+*/
+/**************************************************************************/
+void sds011LogWriter::begin( sds011LogSink sink, void *ctx ) {
+  _sink = sink;
+  _ctx = ctx;
+  _len = 0;
+  _count = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  appends a sample; a full block is handed to the sink first
+    @param sample the sample
+    @returns false when the sink failed to take a full block
+*/
+/**************************************************************************/
+bool sds011LogWriter::append( const sds011Sample &sample ) {
+  uint8_t record[SDS011_LOG_RECORD_MAX], n;
+  uint8_t i;
+
+  for ( i = 0; i < 2; ++i )
+  {
+    if ( _count == 0 )
+    {
+      _len = SDS011_LOG_HEADER;
+      _prev.time = sample.time;
+      _prev.id = 0;
+      _prev.pm25 = 0;
+      _prev.pm10 = 0;
+      _block[8] = (uint8_t)sample.time;
+      _block[9] = (uint8_t)( sample.time >> 8 );
+      _block[10] = (uint8_t)( sample.time >> 16 );
+      _block[11] = (uint8_t)( sample.time >> 24 );
+    }
+    n = putVarint( record, (int32_t)( sample.time - _prev.time ) );
+    n += putVarint( record + n, (int32_t)sample.id - _prev.id );
+    n += putVarint( record + n, (int32_t)sample.pm25 - _prev.pm25 );
+    n += putVarint( record + n, (int32_t)sample.pm10 - _prev.pm10 );
+    if ( _len + n <= SDS011_LOG_BLOCK ) break;
+    // block full: write it, the record is encoded again relative to the new block
+    if ( !flush() ) return( false );
+  }
+
+  memcpy( _block + _len, record, n );
+  _len += n;
+  ++_count;
+  ++_records;
+  _prev = sample;
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  hands the current block to the sink, padded to its full size.
+    The next sample starts a new block. A block the sink did not take whole
+    is kept, and the next append() or flush() hands it over again, whole.
+    @returns false when the sink did not take the whole block
+*/
+/**************************************************************************/
+bool sds011LogWriter::flush(void) {
+  uint16_t checksum;
+
+  if ( _count == 0 ) return( true );
+  memcpy( _block, logMagic, 4 );
+  _block[4] = (uint8_t)_count;
+  _block[5] = (uint8_t)( _count >> 8 );
+  _block[6] = (uint8_t)( _len - SDS011_LOG_HEADER );
+  _block[7] = (uint8_t)( ( _len - SDS011_LOG_HEADER ) >> 8 );
+  checksum = fletcher16( _block + SDS011_LOG_HEADER, _len - SDS011_LOG_HEADER );
+  _block[12] = (uint8_t)checksum;
+  _block[13] = (uint8_t)( checksum >> 8 );
+  _block[14] = 0;
+  _block[15] = 0;
+  memset( _block + _len, 0, SDS011_LOG_BLOCK - _len );
+  if ( _sink == NULL || _sink( _block, SDS011_LOG_BLOCK, _ctx ) != SDS011_LOG_BLOCK ) return( false );
+  _count = 0;
+  _len = 0;
+  ++_blocks;
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011LogReader::sds011LogReader(void) {
+  begin( NULL, 0 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  starts reading a log from its first block
+    @param data the log bytes
+    @param len length of the log, a trailing partial block is ignored
+    @returns void
+*/
+/**************************************************************************/
+void sds011LogReader::begin( const uint8_t *data, size_t len ) {
+  _data = data;
+  _len = len;
+  _block = 0;
+  _pos = NULL;
+  _end = NULL;
+  _corrupt = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  opens the first intact block at or after an index
+    @param block the block index
+    @returns false when there is no further block
+*/
+/**************************************************************************/
+bool sds011LogReader::open( uint32_t block ) {
+  const uint8_t *b;
+
+  for ( ; block < blocks(); ++block )
+  {
+    b = _data + (size_t)block * SDS011_LOG_BLOCK;
+    if ( !intact( b ) )
+    {
+      ++_corrupt;
+      continue;
+    }
+    _pos = b + SDS011_LOG_HEADER;
+    _end = _pos + get16( b + 6 );
+    _prev.time = get32( b + 8 );
+    _prev.id = 0;
+    _prev.pm25 = 0;
+    _prev.pm10 = 0;
+    _block = block + 1;
+    return( true );
+  }
+  _block = block;
+  _pos = _end = NULL;
+  return( false );
+}
+
+/**************************************************************************/
+/*!
+    @brief  decodes the next record
+    @param sample the record
+    @returns false at the end of the log
+*/
+/**************************************************************************/
+bool sds011LogReader::next( sds011Sample *sample ) {
+  int32_t dt, did, d25, d10;
+
+  for ( ;; )
+  {
+    while ( _pos >= _end )
+    {
+      if ( !open( _block ) ) return( false );
+    }
+    if ( getVarint( &_pos, _end, &dt ) && getVarint( &_pos, _end, &did )
+         && getVarint( &_pos, _end, &d25 ) && getVarint( &_pos, _end, &d10 ) ) break;
+    // truncated record despite a good check-sum: drop the rest of the block
+    ++_corrupt;
+    _pos = _end;
+  }
+  _prev.time += (uint32_t)dt;
+  _prev.id = (uint16_t)( _prev.id + did );
+  _prev.pm25 = (uint16_t)( _prev.pm25 + d25 );
+  _prev.pm10 = (uint16_t)( _prev.pm10 + d10 );
+  *sample = _prev;
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  decodes a batch of records
+    @param samples array receiving the records
+    @param max size of the array
+    @returns number of records decoded, 0 at the end of the log
+*/
+/**************************************************************************/
+size_t sds011LogReader::read( sds011Sample *samples, size_t max ) {
+  size_t n = 0;
+
+  while ( n < max && next( &samples[n] ) ) ++n;
+  return( n );
+}
+
+/**************************************************************************/
+/*!
+    @brief  positions the reader at the first record at or after a time.
+    The block is found by a binary search over the times of the intact
+    block headers, which assumes the log was written in time order; a
+    damaged block is passed over for the next intact one.
+    @param time the time to look for
+    @returns false when no record at or after time exists
+*/
+/**************************************************************************/
+bool sds011LogReader::seek( uint32_t time ) {
+  uint32_t lo = 0, hi = blocks(), mid, probe, block;
+  const uint8_t *pos, *end;
+  sds011Sample prev, sample;
+
+  // last intact block starting at or before time
+  while ( hi - lo > 1 )
+  {
+    mid = lo + ( hi - lo ) / 2;
+    for ( probe = mid; probe < hi && !intact( _data + (size_t)probe * SDS011_LOG_BLOCK ); ++probe ) { }
+    if ( probe < hi && (int32_t)( get32( _data + (size_t)probe * SDS011_LOG_BLOCK + 8 ) - time ) <= 0 ) lo = probe;
+    else hi = mid;
+  }
+  if ( !open( lo ) ) return( false );
+  for ( ;; )
+  {
+    pos = _pos;
+    end = _end;
+    prev = _prev;
+    block = _block;
+    if ( !next( &sample ) ) return( false );
+    if ( (int32_t)( sample.time - time ) >= 0 ) break;
+  }
+  // step back to the record found
+  if ( block != _block && !open( _block - 1 ) ) return( false );
+  if ( block == _block )
+  {
+    _pos = pos;
+    _end = end;
+    _prev = prev;
+  }
+  return( true );
+}
+
+#if SDS011_HOST
+
+/**************************************************************************/
+/*!
+    @brief  maps a log file read-only into memory
+    @param path the file
+    @returns false when the file cannot be opened or mapped
+*/
+/**************************************************************************/
+bool sds011LogFile::open( const char *path ) {
+  struct stat st;
+  void *map;
+  int fd;
+
+  close();
+  fd = ::open( path, O_RDONLY | O_CLOEXEC );
+  if ( fd < 0 ) return( false );
+  if ( fstat( fd, &st ) != 0 )
+  {
+    ::close( fd );
+    return( false );
+  }
+  // an empty log has nothing to map
+  if ( st.st_size == 0 )
+  {
+    ::close( fd );
+    return( true );
+  }
+  map = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  ::close( fd );
+  if ( map == MAP_FAILED ) return( false );
+  madvise( map, st.st_size, MADV_SEQUENTIAL );
+  _data = (const uint8_t *)map;
+  _len = st.st_size;
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  removes the mapping
+    @returns void
+*/
+/**************************************************************************/
+void sds011LogFile::close(void) {
+  if ( _data ) munmap( (void *)_data, _len );
+  _data = NULL;
+  _len = 0;
+}
+
+#endif
@@ -0,0 +1,122 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (binary sample log interface)
+
+/// @file sds011log.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Compact append-only binary log of samples, for flash on the device and
+/// files on a gateway. The log is a sequence of fixed size blocks, so block
+/// n starts at n * SDS011_LOG_BLOCK and a reader can seek by time with a
+/// binary search over the block headers.
+///
+/// | Offset | Size | Block header                                        |
+/// | :----: | :--: | :-------------------------------------------------- |
+/// | 0      | 4    | magic "SDSL"                                        |
+/// | 4      | 2    | number of records in the block                      |
+/// | 6      | 2    | payload length in bytes                             |
+/// | 8      | 4    | time of the first record (millis or epoch, caller's choice) |
+/// | 12     | 2    | Fletcher-16 check-sum of the payload                |
+/// | 14     | 2    | reserved, 0                                         |
+///
+/// Every record is four varints of zigzag encoded differences to the
+/// previous record of the block: time, sensor id, PM2.5 and PM10 (raw 0.1
+/// ug/m3 values). The first record of a block is relative to the block time,
+/// id 0 and PM 0. A steady 1 Hz stream takes about 5 bytes per record.
+/// Multi-byte header fields are little endian; unused bytes after the payload are 0.
+
+#ifndef PM_SDS011_LOG_h
+#define PM_SDS011_LOG_h
+
+#include "sds011sample.h"
+
+/// size of one log block in bytes, a typical flash page
+#define SDS011_LOG_BLOCK 256
+/// size of the block header in bytes
+#define SDS011_LOG_HEADER 16
+/// largest encoded record: four varints of up to five bytes
+#define SDS011_LOG_RECORD_MAX 20
+
+/// receives complete blocks from an sds011LogWriter, returns bytes written
+typedef size_t (*sds011LogSink)( const uint8_t *buf, size_t len, void *ctx );
+
+/// appends samples to a log, one block at a time
+class sds011LogWriter {
+	public:
+		sds011LogWriter(void);
+		void begin( sds011LogSink sink, void *ctx = NULL );
+		bool append( const sds011Sample &sample );
+		bool flush(void);
+		/// number of records appended
+		uint32_t records(void) const { return( _records ); }
+		/// number of blocks handed to the sink
+		uint32_t blocks(void) const { return( _blocks ); }
+	private:
+		/// the block being filled
+		uint8_t _block[SDS011_LOG_BLOCK];
+		/// bytes used in _block, header included
+		uint16_t _len;
+		/// records in _block
+		uint16_t _count;
+		/// the previous record of the block
+		sds011Sample _prev;
+		/// the block sink
+		sds011LogSink _sink;
+		/// context for _sink
+		void *_ctx;
+		/// records appended
+		uint32_t _records;
+		/// blocks written
+		uint32_t _blocks;
+};
+
+/// streaming reader over a log held in memory (RAM, memory mapped flash or file)
+class sds011LogReader {
+	public:
+		sds011LogReader(void);
+		void begin( const uint8_t *data, size_t len );
+		bool next( sds011Sample *sample );
+		size_t read( sds011Sample *samples, size_t max );
+		bool seek( uint32_t time );
+		/// number of blocks in the log
+		uint32_t blocks(void) const { return( (uint32_t)( _len / SDS011_LOG_BLOCK ) ); }
+		/// number of blocks skipped because of a bad header or check-sum
+		uint32_t corrupt(void) const { return( _corrupt ); }
+	private:
+		/// the log
+		const uint8_t *_data;
+		/// length of the log in bytes
+		size_t _len;
+		/// index of the next block to open
+		uint32_t _block;
+		/// read position in the open block
+		const uint8_t *_pos;
+		/// end of the payload of the open block
+		const uint8_t *_end;
+		/// the previous record
+		sds011Sample _prev;
+		/// blocks skipped
+		uint32_t _corrupt;
+		bool open( uint32_t block );
+};
+
+#if SDS011_HOST
+/// read-only memory mapping of a log file, for sds011LogReader
+class sds011LogFile {
+	public:
+		sds011LogFile(void) : _data(NULL), _len(0) {}
+		~sds011LogFile(void) { close(); }
+		bool open( const char *path );
+		void close(void);
+		/// the mapped bytes
+		const uint8_t *data(void) const { return( _data ); }
+		/// the file length
+		size_t length(void) const { return( _len ); }
+	private:
+		/// the mapping
+		const uint8_t *_data;
+		/// length of the mapping
+		size_t _len;
+};
+#endif
+
+#endif
@@ -0,0 +1,207 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (multi-sensor manager implementation)
+
+/// @file sds011manager.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011manager.h"
+#include "sds011frame.h"
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011Manager::sds011Manager(void) : _sensorCount(0), _portCount(0), _cb(NULL), _ctx(NULL) {
+}
+
+/**************************************************************************/
+/*!
+    @brief  registers a sensor. Several sensors may share one transport when
+    each is addressed by its own id; a sensor addressed as FF FF needs a
+    transport of its own.
+    @param transport the transport the sensor is connected to, set up for 9600 8N1
+    @param id_1 device lower byter
+    @param id_2 device higher byter
+    @returns the sensor index, -1 when the tables are full or the address is ambiguous
+*/
+/**************************************************************************/
+int8_t sds011Manager::add( sds011Transport *transport, uint8_t id_1, uint8_t id_2 ) {
+  uint8_t i, p;
+  bool broadcast = id_1 == MSG_FF && id_2 == MSG_FF;
+  sensor *s;
+
+  if ( _sensorCount >= SDS011_MAX_SENSORS ) return( -1 );
+  for ( p = 0; p < _portCount && _ports[p].transport != transport; ++p ) { }
+  if ( p == _portCount )
+  {
+    if ( _portCount >= SDS011_MAX_PORTS ) return( -1 );
+    _ports[p].owner = this;
+    _ports[p].transport = transport;
+    _ports[p].engine.begin( transport );
+    _ports[p].engine.onData( onReport, &_ports[p] );
+    ++_portCount;
+  }
+  for ( i = 0; i < _sensorCount; ++i )
+  {
+    s = &_sensors[i];
+    if ( s->port == p && ( broadcast || ( s->id_1 == MSG_FF && s->id_2 == MSG_FF ) || ( s->id_1 == id_1 && s->id_2 == id_2 ) ) ) return( -1 );
+  }
+
+  s = &_sensors[_sensorCount];
+  s->owner = this;
+  s->port = p;
+  s->id_1 = id_1;
+  s->id_2 = id_2;
+  s->busy = false;
+  s->failed = 0;
+  s->interval = 0;
+  s->last = millis();
+  return( _sensorCount++ );
+}
+
+/**************************************************************************/
+/*!
+    @brief  lets poll() query a sensor in query mode periodically
+    @param sensor the sensor index returned by add()
+    @param ms query interval, 0 for a sensor in auto report mode (default)
+    @returns false for an unknown sensor
+*/
+/**************************************************************************/
+bool sds011Manager::setQueryInterval( uint8_t sensor, unsigned long ms ) {
+  if ( sensor >= _sensorCount ) return( false );
+  _sensors[sensor].interval = ms;
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  queues a data query for one sensor, the result arrives through
+    the sample callback
+    @param sensor the sensor index returned by add()
+    @returns false for an unknown sensor, a query already running or a full queue
+*/
+/**************************************************************************/
+bool sds011Manager::query( uint8_t sensor ) {
+  struct sensor *s;
+
+  if ( sensor >= _sensorCount || _sensors[sensor].busy ) return( false );
+  s = &_sensors[sensor];
+  s->busy = _ports[s->port].engine.enqueue( CMD_QUERY_DATA, 0, 0, s->id_1, s->id_2, NULL, onQuery, s );
+  return( s->busy );
+}
+
+/**************************************************************************/
+/*!
+    @brief  number of queries of a sensor that got no valid reply after
+    all tries; a query that failed gives no sample
+    @param sensor the sensor index returned by add()
+    @returns the failures since add(), 0 for an unknown sensor
+*/
+/**************************************************************************/
+uint32_t sds011Manager::failures( uint8_t sensor ) const {
+  if ( sensor >= _sensorCount ) return( 0 );
+  return( _sensors[sensor].failed );
+}
+
+/**************************************************************************/
+/*!
+    @brief  sets the callback receiving the samples of all sensors
+    @param cb the callback
+    @param ctx passed to cb
+    @returns void
+*/
+/**************************************************************************/
+void sds011Manager::onSample( sds011SampleCallback cb, void *ctx ) {
+  _cb = cb;
+  _ctx = ctx;
+}
+
+/**************************************************************************/
+/*!
+    @brief  the command engine of the line a sensor is connected to, for
+    configuration commands (address them with enqueue() and the sensor id)
+    @param sensor the sensor index returned by add()
+    @returns the engine, NULL for an unknown sensor
+*/
+/**************************************************************************/
+sds011Async *sds011Manager::engine( uint8_t sensor ) {
+  if ( sensor >= _sensorCount ) return( NULL );
+  return( &_ports[_sensors[sensor].port].engine );
+}
+
+/**************************************************************************/
+/*!
+    @brief  services all lines and starts the queries that are due.
+    Call it from loop() as often as possible, it never blocks.
+    @returns void
+*/
+/**************************************************************************/
+void sds011Manager::poll(void) {
+  unsigned long now;
+  uint8_t i;
+
+  for ( i = 0; i < _portCount; ++i ) _ports[i].engine.poll();
+
+  now = millis();
+  for ( i = 0; i < _sensorCount; ++i )
+  {
+    if ( _sensors[i].interval && !_sensors[i].busy && now - _sensors[i].last >= _sensors[i].interval )
+    {
+      _sensors[i].last = now;
+      query( i );
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  hands a data frame to the sensor it came from
+    @param port the line the frame was received on
+    @param frame the validated data frame
+    @returns void
+*/
+/**************************************************************************/
+void sds011Manager::sample( uint8_t port, const uint8_t *frame ) {
+  uint8_t i;
+  sensor *s;
+
+  for ( i = 0; i < _sensorCount; ++i )
+  {
+    s = &_sensors[i];
+    if ( s->port == port && ( ( s->id_1 == MSG_FF && s->id_2 == MSG_FF ) || ( s->id_1 == frame[6] && s->id_2 == frame[7] ) ) )
+    {
+      if ( _cb ) _cb( i, sds011ReplyId( frame ), sds011ReplyPm25( frame ), sds011ReplyPm10( frame ), _ctx );
+      return;
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  engine callback for data frames reported on a line
+    @param result the data frame
+    @param ctx the port
+    @returns void
+*/
+/**************************************************************************/
+void sds011Manager::onReport( const sds011AsyncResult *result, void *ctx ) {
+  port *p = (port *)ctx;
+
+  p->owner->sample( p - p->owner->_ports, result->reply );
+}
+
+/**************************************************************************/
+/*!
+    @brief  engine callback for completed data queries
+    @param result the query outcome
+    @param ctx the sensor
+    @returns void
+*/
+/**************************************************************************/
+void sds011Manager::onQuery( const sds011AsyncResult *result, void *ctx ) {
+  sensor *s = (sensor *)ctx;
+
+  s->busy = false;
+  if ( result->status ) s->owner->sample( s->port, result->reply ); else ++s->failed;
+}
@@ -0,0 +1,74 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (multi-sensor manager interface)
+
+/// @file sds011manager.h
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#ifndef PM_SDS011_MANAGER_h
+#define PM_SDS011_MANAGER_h
+
+#include "sds011async.h"
+
+/// number of sensors a manager can serve
+#define SDS011_MAX_SENSORS 8
+/// number of distinct transports (UARTs) a manager can serve
+#define SDS011_MAX_PORTS 4
+
+/// called for every data frame of a registered sensor, whether it was
+/// queried or reported on its own; PM values in 0.1 ug/m3
+typedef void (*sds011SampleCallback)( uint8_t sensor, uint16_t id, uint16_t pm25, uint16_t pm10, void *ctx );
+
+/// schedules many sensors on one or more UARTs through a single poll().
+/// Every transport gets one non-blocking command engine, which learns the
+/// timeouts of each sensor on it; sensors sharing a
+/// line are told apart by the ID bytes of the reply (reply[6..7]), so the
+/// cost of poll() grows with the number of received frames, never with
+/// sensors times blocking timeouts.
+class sds011Manager {
+	public:
+		sds011Manager(void);
+		int8_t add( sds011Transport *transport, uint8_t id_1 = MSG_FF, uint8_t id_2 = MSG_FF );
+		bool setQueryInterval( uint8_t sensor, unsigned long ms );
+		bool query( uint8_t sensor );
+		void onSample( sds011SampleCallback cb, void *ctx = NULL );
+		sds011Async *engine( uint8_t sensor );
+		void poll(void);
+		/// number of registered sensors
+		uint8_t sensors(void) const { return( _sensorCount ); }
+		uint32_t failures( uint8_t sensor ) const;
+	private:
+		/// a registered sensor
+		struct sensor {
+			sds011Manager *owner;
+			uint8_t port;
+			uint8_t id_1;
+			uint8_t id_2;
+			bool busy;
+			uint32_t failed;
+			unsigned long interval;
+			unsigned long last;
+		};
+		/// a transport and its engine
+		struct port {
+			sds011Manager *owner;
+			sds011Transport *transport;
+			sds011Async engine;
+		};
+		/// registered sensors
+		sensor _sensors[SDS011_MAX_SENSORS];
+		/// distinct transports
+		port _ports[SDS011_MAX_PORTS];
+		/// number of registered sensors
+		uint8_t _sensorCount;
+		/// number of distinct transports
+		uint8_t _portCount;
+		/// sample callback
+		sds011SampleCallback _cb;
+		/// context for _cb
+		void *_ctx;
+		void sample( uint8_t port, const uint8_t *frame );
+		static void onReport( const sds011AsyncResult *result, void *ctx );
+		static void onQuery( const sds011AsyncResult *result, void *ctx );
+};
+
+#endif
@@ -0,0 +1,94 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (instrumentation implementation)
+
+/// @file sds011metrics.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011metrics.h"
+
+#if SDS011_METRICS
+
+#include <string.h>
+
+sds011Counters sds011MetricCounters;
+
+/// latency histograms per command
+static sds011Latency latencies[SDS011_METRICS_COMMANDS];
+/// time of the previous snapshot
+static uint32_t snapshotAt;
+/// frames at the previous snapshot
+static uint32_t snapshotFrames;
+
+/**************************************************************************/
+/*!
+    @brief  records the round trip of a command
+    @param command the command id
+    @param ms the round trip in ms
+    @returns void
+*/
+/**************************************************************************/
+void sds011MetricsLatency( uint8_t command, uint32_t ms ) {
+  uint8_t index = sds011CommandIndex( command ), bin = 0;
+  sds011Latency *l;
+  uint32_t max;
+
+  if ( index >= SDS011_METRICS_COMMANDS ) return;
+  l = &latencies[index];
+  while ( bin < SDS011_LATENCY_BINS - 1 && ms >= ( 1UL << bin ) ) ++bin;
+  __atomic_fetch_add( &l->count, 1, __ATOMIC_RELAXED );
+  __atomic_fetch_add( &l->sum, ms, __ATOMIC_RELAXED );
+  __atomic_fetch_add( &l->bins[bin], 1, __ATOMIC_RELAXED );
+  max = __atomic_load_n( &l->max, __ATOMIC_RELAXED );
+  while ( ms > max && !__atomic_compare_exchange_n( &l->max, &max, ms, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) ) {}
+}
+
+/**************************************************************************/
+/*!
+    @brief  copies all metrics; the frame rate covers the time since the
+    previous snapshot
+    @param out the snapshot
+    @returns void
+*/
+/**************************************************************************/
+void sds011MetricsRead( sds011MetricsSnapshot *out ) {
+  uint32_t now = millis();
+  uint8_t c, b;
+
+  out->frames = __atomic_load_n( &sds011MetricCounters.frames, __ATOMIC_RELAXED );
+  out->discarded = __atomic_load_n( &sds011MetricCounters.discarded, __ATOMIC_RELAXED );
+  out->badHeader = __atomic_load_n( &sds011MetricCounters.badHeader, __ATOMIC_RELAXED );
+  out->badChecksum = __atomic_load_n( &sds011MetricCounters.badChecksum, __ATOMIC_RELAXED );
+  out->badTail = __atomic_load_n( &sds011MetricCounters.badTail, __ATOMIC_RELAXED );
+  out->commands = __atomic_load_n( &sds011MetricCounters.commands, __ATOMIC_RELAXED );
+  out->retries = __atomic_load_n( &sds011MetricCounters.retries, __ATOMIC_RELAXED );
+  out->timeouts = __atomic_load_n( &sds011MetricCounters.timeouts, __ATOMIC_RELAXED );
+  for ( c = 0; c < SDS011_METRICS_COMMANDS; ++c )
+  {
+    out->latency[c].count = __atomic_load_n( &latencies[c].count, __ATOMIC_RELAXED );
+    out->latency[c].sum = __atomic_load_n( &latencies[c].sum, __ATOMIC_RELAXED );
+    out->latency[c].max = __atomic_load_n( &latencies[c].max, __ATOMIC_RELAXED );
+    for ( b = 0; b < SDS011_LATENCY_BINS; ++b )
+    {
+      out->latency[c].bins[b] = __atomic_load_n( &latencies[c].bins[b], __ATOMIC_RELAXED );
+    }
+  }
+  out->interval = now - snapshotAt;
+  out->fps = out->interval ? (uint32_t)( ( out->frames - snapshotFrames ) * 100000ULL / out->interval ) : 0;
+  snapshotAt = now;
+  snapshotFrames = out->frames;
+}
+
+/**************************************************************************/
+/*!
+    @brief  sets all metrics to 0, not safe while another context records
+    @returns void
+*/
+/**************************************************************************/
+void sds011MetricsReset(void) {
+  memset( &sds011MetricCounters, 0, sizeof( sds011MetricCounters ) );
+  memset( latencies, 0, sizeof( latencies ) );
+  snapshotAt = millis();
+  snapshotFrames = 0;
+}
+
+#endif
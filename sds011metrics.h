@@ -0,0 +1,102 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (instrumentation interface)
+
+/// @file sds011metrics.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Protocol counters and per-command round-trip latency histograms,
+/// selected at compile time: build with SDS011_METRICS defined to 1 (e.g.
+/// -DSDS011_METRICS=1 in the build flags) to record them. Otherwise the
+/// SDS011_METRIC_* hooks expand to nothing and no code or data is added.
+/// The counters are shared by all sensors and engines of the program and
+/// are updated with relaxed atomics, so a receive thread may record while
+/// the application takes a snapshot.
+
+#ifndef PM_SDS011_METRICS_h
+#define PM_SDS011_METRICS_h
+
+#include "sds011timeout.h"
+
+#ifndef SDS011_METRICS
+/// 1 records metrics, 0 compiles them out
+#define SDS011_METRICS 0
+#endif
+
+/// number of commands with a histogram, see sds011CommandIndex()
+#define SDS011_METRICS_COMMANDS SDS011_COMMANDS
+/// number of latency bins; bin n counts round trips below 2^n ms, the last one the rest
+#define SDS011_LATENCY_BINS 13
+
+/// round-trip latency of one command, from the write to the valid reply
+struct sds011Latency {
+	/// replies received
+	uint32_t count;
+	/// sum of all round trips in ms
+	uint32_t sum;
+	/// longest round trip in ms
+	uint32_t max;
+	/// round trips per power of two bin
+	uint32_t bins[SDS011_LATENCY_BINS];
+};
+
+/// copy of all metrics at one point in time
+struct sds011MetricsSnapshot {
+	/// valid frames parsed
+	uint32_t frames;
+	/// bytes dropped while resynchronizing to a frame header
+	uint32_t discarded;
+	/// frames started with a header but a wrong reply or command id
+	uint32_t badHeader;
+	/// frames with a wrong check-sum
+	uint32_t badChecksum;
+	/// frames with a wrong tail byte
+	uint32_t badTail;
+	/// commands sent, retries not included
+	uint32_t commands;
+	/// commands sent again after a missing or wrong reply
+	uint32_t retries;
+	/// waits for a reply that ended without one
+	uint32_t timeouts;
+	/// ms since the previous snapshot (or the reset)
+	uint32_t interval;
+	/// frames per second over interval, in 0.01 frames/s
+	uint32_t fps;
+	/// latency per command, indexed by sds011CommandIndex()
+	sds011Latency latency[SDS011_METRICS_COMMANDS];
+};
+
+#if SDS011_METRICS
+
+/// the counters, updated through the SDS011_METRIC_* hooks
+struct sds011Counters {
+	uint32_t frames;
+	uint32_t discarded;
+	uint32_t badHeader;
+	uint32_t badChecksum;
+	uint32_t badTail;
+	uint32_t commands;
+	uint32_t retries;
+	uint32_t timeouts;
+};
+extern sds011Counters sds011MetricCounters;
+
+void sds011MetricsLatency( uint8_t command, uint32_t ms );
+void sds011MetricsRead( sds011MetricsSnapshot *out );
+void sds011MetricsReset(void);
+
+/// adds one to a counter
+#define SDS011_METRIC_COUNT( field ) __atomic_fetch_add( &sds011MetricCounters.field, 1, __ATOMIC_RELAXED )
+/// records the round trip of a command that started at millis() == start
+#define SDS011_METRIC_LATENCY( command, start ) sds011MetricsLatency( ( command ), (uint32_t)( millis() - ( start ) ) )
+/// declares and sets a start time for SDS011_METRIC_LATENCY
+#define SDS011_METRIC_STAMP( var ) unsigned long var = millis()
+
+#else
+
+#define SDS011_METRIC_COUNT( field ) do {} while ( 0 )
+#define SDS011_METRIC_LATENCY( command, start ) do {} while ( 0 )
+#define SDS011_METRIC_STAMP( var ) do {} while ( 0 )
+
+#endif
+
+#endif
@@ -0,0 +1,165 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (frame parser implementation)
+
+/// @file sds011parser.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include <string.h>
+#include "sds011lib.h"
+#include "sds011metrics.h"
+
+/// step() result: frame still incomplete
+#define STEP_MORE   0
+/// step() result: frame complete and valid
+#define STEP_FRAME  1
+/// step() result: byte does not fit the frame
+#define STEP_BAD   -1
+
+#if SDS011_METRICS
+/// step() failure of a started frame: counts it and its header byte, which the rescan drops
+#define BROKEN( field ) ( SDS011_METRIC_COUNT( field ), SDS011_METRIC_COUNT( discarded ), STEP_BAD )
+#else
+#define BROKEN( field ) STEP_BAD
+#endif
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011Parser::sds011Parser(void) {
+  reset();
+}
+
+/**************************************************************************/
+/*!
+    @brief  drops a partially assembled frame
+    @returns void
+*/
+/**************************************************************************/
+void sds011Parser::reset(void) {
+  _len = 0;
+  _checksum = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  advances the frame state machine by one byte.
+    The byte position decides what is checked: header at 0, reply id at 1,
+    the replied command at 2 (configuration replies only), check-sum at 8
+    and the tail at 9.
+    @param c the received byte
+    @returns STEP_MORE, STEP_FRAME or STEP_BAD
+*/
+/**************************************************************************/
+int8_t sds011Parser::step( uint8_t c ) {
+  switch( _len )
+  {
+    case 0:
+      if ( c != MSG_HEAD )
+      {
+        SDS011_METRIC_COUNT( discarded );
+        return( STEP_BAD );
+      }
+      _checksum = 0;
+      break;
+    case 1:
+      if ( c != REPLY_DATA && c != REPLY_CFG ) return( BROKEN( badHeader ) );
+      break;
+    case 2:
+      if ( _buf[1] == REPLY_CFG && c != CMD_REPORTING_MODE && c != CMD_SET_DEVICE_ID && c != CMD_SLEEP_AND_WORK
+          && c != CMD_FIRMWARE_VERSION && c != CMD_WORKING_PERIOD ) return( BROKEN( badHeader ) );
+      break;
+    case 8:
+      if ( c != _checksum ) return( BROKEN( badChecksum ) );
+      break;
+    case 9:
+      if ( c != MSG_TAIL ) return( BROKEN( badTail ) );
+      break;
+    default:
+      break;
+  }
+  if ( _len >= 2 && _len < 8 ) _checksum += c;
+  if ( _len < SDS011_REPLY_LEN - 1 )
+  {
+    _buf[_len++] = c;
+    return( STEP_MORE );
+  }
+
+  // the tail completes the frame
+  _buf[SDS011_REPLY_LEN - 1] = c;
+  memcpy( _frame, _buf, SDS011_REPLY_LEN );
+  _len = 0;
+  SDS011_METRIC_COUNT( frames );
+  return( STEP_FRAME );
+}
+
+/**************************************************************************/
+/*!
+    @brief  feeds one received byte into the parser.
+    If the byte breaks the frame being assembled, the frame is dropped
+    and all its bytes after the header are scanned again, so that a header
+    hidden inside a broken frame is picked up without losing the frame it starts.
+    @param c the received byte
+    @returns true when c completed a valid frame, available through frame()
+*/
+/**************************************************************************/
+bool sds011Parser::push( uint8_t c ) {
+  uint8_t rescan[SDS011_REPLY_LEN], n, i;
+
+  if ( step( c ) != STEP_BAD ) return( _len == 0 );
+  if ( _len == 0 ) return( false );
+
+  // at most nine bytes are rescanned, too few to complete another frame
+  n = _len - 1;
+  memcpy( rescan, _buf + 1, n );
+  rescan[n++] = c;
+  _len = 0;
+  for ( i = 0; i < n; ++i )
+  {
+    if ( step( rescan[i] ) == STEP_BAD && _len > 0 )
+    {
+      // the restarted frame broke as well, start over right after its header
+      memmove( rescan, rescan + i - _len + 1, n - ( i - _len + 1 ) );
+      n -= i - _len + 1;
+      i = (uint8_t)-1;
+      _len = 0;
+    }
+  }
+  return( false );
+}
+
+/**************************************************************************/
+/*!
+    @brief  the last complete and validated frame
+    @returns pointer to the ten bytes of the frame
+*/
+/**************************************************************************/
+const uint8_t *sds011Parser::frame(void) const {
+  return( _frame );
+}
+
+/**************************************************************************/
+/*!
+    @brief  number of bytes of a partial frame kept for the next push()
+    @returns count of bytes already assembled
+*/
+/**************************************************************************/
+uint8_t sds011Parser::pending(void) const {
+  return( _len );
+}
+
+/**************************************************************************/
+/*!
+    @brief  tells whether a validated reply frame answers a command:
+    a data frame answers the query data command, a configuration frame
+    the command echoed in DATA1
+    @param frame the reply frame
+    @param command the command sent
+    @returns true when the frame is the reply to command
+*/
+/**************************************************************************/
+bool sds011ReplyAnswers( const uint8_t frame[SDS011_REPLY_LEN], uint8_t command ) {
+  if ( command == CMD_QUERY_DATA ) return( frame[1] == REPLY_DATA );
+  return( frame[1] == REPLY_CFG && frame[2] == command );
+}
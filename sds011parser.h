@@ -0,0 +1,44 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (frame parser interface)
+
+/// @file sds011parser.h
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#ifndef PM_SDS011_PARSER_h
+#define PM_SDS011_PARSER_h
+
+#include <stdint.h>
+
+/// length of a sensor reply frame in bytes
+#define SDS011_REPLY_LEN 10
+/// length of a command frame sent to the sensor
+#define SDS011_REQUEST_LEN 19
+
+bool sds011ReplyAnswers( const uint8_t frame[SDS011_REPLY_LEN], uint8_t command );
+
+/// incremental byte-at-a-time parser for the 10 byte sensor replies.
+/// Bytes are pushed one by one; the parser scans for the header, validates
+/// the command ID, the check-sum and the tail and reports every complete
+/// frame. A partial frame is kept across calls, and when a frame turns out
+/// to be broken the already consumed bytes are rescanned for the next header,
+/// so a valid frame following garbage is never lost.
+class sds011Parser {
+	public:
+		sds011Parser(void);
+		void reset(void);
+		bool push( uint8_t c );
+		const uint8_t *frame(void) const;
+		uint8_t pending(void) const;
+	private:
+		/// bytes of the frame being assembled
+		uint8_t _buf[SDS011_REPLY_LEN];
+		/// the last complete frame
+		uint8_t _frame[SDS011_REPLY_LEN];
+		/// number of bytes already assembled in _buf
+		uint8_t _len;
+		/// running check-sum over DATA1..DATA6
+		uint8_t _checksum;
+		int8_t step( uint8_t c );
+};
+
+#endif
@@ -0,0 +1,56 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (platform glue implementation)
+
+/// @file sds011port.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011port.h"
+
+#if SDS011_HOST
+
+#include "sds011clock.h"
+
+/**************************************************************************/
+/*!
+    @brief  microseconds of the installed clock (see sds011UseClock()),
+    monotonic since the first call, as on Arduino
+    @returns microseconds, wrapping like the Arduino counter
+*/
+/**************************************************************************/
+unsigned long micros(void) {
+  return( sds011CurrentClock()->micros() );
+}
+
+/**************************************************************************/
+/*!
+    @brief  milliseconds of the installed clock, as on Arduino
+    @returns milliseconds
+*/
+/**************************************************************************/
+unsigned long millis(void) {
+  return( sds011CurrentClock()->millis() );
+}
+
+/**************************************************************************/
+/*!
+    @brief  waits on the installed clock: sleeps the calling thread, or
+    moves virtual time on at once
+    @param ms milliseconds to wait
+    @returns void
+*/
+/**************************************************************************/
+void delay( unsigned long ms ) {
+  sds011CurrentClock()->delay( ms );
+}
+
+/**************************************************************************/
+/*!
+    @brief  gives up the processor, as the Arduino yield()
+    @returns void
+*/
+/**************************************************************************/
+void yield(void) {
+  sds011CurrentClock()->yield();
+}
+
+#endif
@@ -0,0 +1,31 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (platform glue)
+
+/// @file sds011port.h
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#ifndef PM_SDS011_PORT_h
+#define PM_SDS011_PORT_h
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+// host build (Linux): the few Arduino timing calls the library relies on
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void yield(void);
+#endif
+
+/// true when the POSIX host backends (tty transport, pty tools) are compiled
+#if !defined(ARDUINO) && defined(__linux__)
+#define SDS011_HOST 1
+#else
+#define SDS011_HOST 0
+#endif
+
+#endif
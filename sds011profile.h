@@ -0,0 +1,58 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (device state and configuration profiles)
+
+/// @file sds011profile.h
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#ifndef PM_SDS011_PROFILE_h
+#define PM_SDS011_PROFILE_h
+
+#include "sds011port.h"
+
+/// reporting mode field of sds011State and sds011Profile
+#define SDS011_FIELD_MODE     0x01
+/// sleep / work field
+#define SDS011_FIELD_WORK     0x02
+/// work period field
+#define SDS011_FIELD_PERIOD   0x04
+/// device id field
+#define SDS011_FIELD_ID       0x08
+/// firmware date field, sds011State only
+#define SDS011_FIELD_FIRMWARE 0x10
+
+/// device settings as last seen in a reply of the device. The sensor keeps
+/// reporting mode, work period and id across power cycles; a sketch may
+/// keep this struct across its own restarts (e.g. in RTC memory) and give
+/// it back with sds011::setState().
+struct sds011State {
+	/// SDS011_FIELD_ bits of the fields below that are known
+	uint8_t known;
+	/// AUTO_REPORT_MODE or QUERY_MODE
+	uint8_t mode;
+	/// SLEEP_MODE or WORK_MODE
+	uint8_t work;
+	/// work period in minutes, 0 for continuous
+	uint8_t period;
+	/// device id, ID byte 1 as the lower byte
+	uint16_t id;
+	/// firmware date: year, month, day
+	uint8_t firmware[3];
+};
+
+/// desired settings for sds011::applyProfile()
+struct sds011Profile {
+	/// SDS011_FIELD_ bits of the fields below to apply
+	uint8_t fields;
+	/// AUTO_REPORT_MODE or QUERY_MODE
+	uint8_t mode;
+	/// SLEEP_MODE or WORK_MODE
+	uint8_t work;
+	/// work period in minutes, 0 for continuous
+	uint8_t period;
+	/// new id byte 1
+	uint8_t id_1;
+	/// new id byte 2
+	uint8_t id_2;
+};
+
+#endif
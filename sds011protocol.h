@@ -0,0 +1,58 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (protocol constants)
+
+/// @file sds011protocol.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Frame bytes, command ids and option values of the Laser Dust Sensor
+/// Control Protocol, V1.4, shared by the frame helpers, the request /
+/// response core and the sensor classes.
+
+#ifndef PM_SDS011_PROTOCOL_h
+#define PM_SDS011_PROTOCOL_h
+
+/// Reporting mode as auto
+#define AUTO_REPORT_MODE 0
+/// Reporting mode as queries
+#define QUERY_MODE  1
+/// get or receive
+#define READ_MODE 0
+/// set or write
+#define WRITE_MODE 1
+/// mode set to sleep
+#define SLEEP_MODE 0
+/// mode set to normal
+#define WORK_MODE  1
+/// wait for an auto report in steps of 20 ms
+#define MAX_WAIT 30
+/// dont care while reading
+#define DONT_CARE  0
+
+/// sds response header
+#define MSG_HEAD 0xAA //170
+/// sds response footer
+#define MSG_TAIL       0xAB  //172
+/// sds response/command reserve word
+#define MSG_RESERVED   0x00 
+/// sds sending command
+#define CMD_WRITE_MODE    0xB4  //180
+/// response query data indication
+#define REPLY_DATA     0xC0  //192
+/// response query configuration indication
+#define REPLY_CFG      0xC5  //197
+/// sending command for reporting mode
+#define CMD_REPORTING_MODE       0x02 
+/// sending command for query data mode
+#define CMD_QUERY_DATA      0x04 
+/// sending command to set device id
+#define CMD_SET_DEVICE_ID         0x05 
+/// sending command for sleep and work mode
+#define CMD_SLEEP_AND_WORK      0x06 
+/// sending command for geting firmware version
+#define CMD_FIRMWARE_VERSION  0x07 
+/// sending command for working period setting
+#define CMD_WORKING_PERIOD      0x08 
+/// all set values as one
+#define MSG_FF      0xff
+
+#endif
@@ -0,0 +1,176 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (background receive path implementation)
+
+/// @file sds011receiver.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011receiver.h"
+#include "sds011frame.h"
+#include "sds011clock.h"
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011Receiver::sds011Receiver(void) : _uart(NULL), _frames(0), _period(5), _running(false) {
+#if !SDS011_HOST && defined(ARDUINO_ARCH_ESP32)
+  _task = NULL;
+#endif
+}
+
+/**************************************************************************/
+/*!
+    @brief  attaches the receive path to a sensor in auto report mode
+    @param transport the transport connected to the sensor, set up for 9600 8N1
+    @returns status true when executed seccessfully
+*/
+/**************************************************************************/
+bool sds011Receiver::begin( sds011Transport *transport ) {
+  _uart = transport;
+  _parser.reset();
+  return( transport != NULL );
+}
+
+/**************************************************************************/
+/*!
+    @brief  producer side: consumes all received bytes and queues every
+    complete data frame as a sample stamped with millis()
+    @returns number of samples queued by this call
+*/
+/**************************************************************************/
+uint16_t sds011Receiver::service(void) {
+  sds011Sample sample;
+  const uint8_t *frame;
+  uint16_t n = 0;
+
+  if ( _uart == NULL ) return( 0 );
+  while ( _uart->available() > 0 )
+  {
+    if ( !_parser.push( (uint8_t)_uart->read() ) ) continue;
+    frame = _parser.frame();
+    if ( frame[1] != REPLY_DATA ) continue;
+    sample.time = millis();
+    sample.id = sds011ReplyId( frame );
+    sample.pm25 = sds011ReplyPm25( frame );
+    sample.pm10 = sds011ReplyPm10( frame );
+    __atomic_store_n( &_frames, _frames + 1, __ATOMIC_RELAXED );
+    if ( _ring.push( sample ) ) ++n;
+  }
+  return( n );
+}
+
+/**************************************************************************/
+/*!
+    @brief  consumer side: takes the queued samples, oldest first
+    @param samples array receiving the samples
+    @param max size of the array
+    @returns number of samples copied
+*/
+/**************************************************************************/
+uint16_t sds011Receiver::read( sds011Sample *samples, uint16_t max ) {
+  return( _ring.pop( samples, max ) );
+}
+
+#if SDS011_HOST
+
+/**************************************************************************/
+/*!
+    @brief  body of the receive thread
+    @param self the receiver
+    @returns NULL
+*/
+/**************************************************************************/
+void *sds011Receiver::run( void *self ) {
+  sds011Receiver *r = (sds011Receiver *)self;
+  // the thread paces itself in wall time, whatever clock the program installs
+  sds011RealClock wall;
+
+  while ( r->_running )
+  {
+    r->service();
+    wall.delay( r->_period );
+  }
+  return( NULL );
+}
+
+/**************************************************************************/
+/*!
+    @brief  runs service() in a thread of its own. Refused while a clock
+    that is not thread safe, e.g. an sds011VirtualClock, is installed, since
+    service() stamps the samples with millis().
+    @param period_ms pause between two service() calls, the sensor sends
+    one frame (ten bytes) per second at most
+    @returns status true when the thread is running
+*/
+/**************************************************************************/
+bool sds011Receiver::start( unsigned long period_ms ) {
+  if ( _running || _uart == NULL || !sds011CurrentClock()->threadSafe() ) return( false );
+  _period = period_ms;
+  _running = true;
+  if ( pthread_create( &_thread, NULL, run, this ) != 0 ) _running = false;
+  return( _running );
+}
+
+/**************************************************************************/
+/*!
+    @brief  stops the receive thread and waits for it
+    @returns void
+*/
+/**************************************************************************/
+void sds011Receiver::stop(void) {
+  if ( !_running ) return;
+  _running = false;
+  pthread_join( _thread, NULL );
+}
+
+#elif defined(ARDUINO_ARCH_ESP32)
+
+/**************************************************************************/
+/*!
+    @brief  body of the receive task
+    @param self the receiver
+    @returns void
+*/
+/**************************************************************************/
+void sds011Receiver::task( void *self ) {
+  sds011Receiver *r = (sds011Receiver *)self;
+
+  while ( r->_running )
+  {
+    r->service();
+    vTaskDelay( pdMS_TO_TICKS( r->_period ) > 0 ? pdMS_TO_TICKS( r->_period ) : 1 );
+  }
+  r->_task = NULL;
+  vTaskDelete( NULL );
+}
+
+/**************************************************************************/
+/*!
+    @brief  runs service() in a FreeRTOS task of its own
+    @param period_ms pause between two service() calls, the sensor sends
+    one frame (ten bytes) per second at most
+    @returns status true when the task is running
+*/
+/**************************************************************************/
+bool sds011Receiver::start( unsigned long period_ms ) {
+  if ( _running || _uart == NULL ) return( false );
+  _period = period_ms;
+  _running = true;
+  if ( xTaskCreate( task, "sds011rx", 2048, this, 2, &_task ) != pdPASS ) _running = false;
+  return( _running );
+}
+
+/**************************************************************************/
+/*!
+    @brief  stops the receive task and waits for it to end
+    @returns void
+*/
+/**************************************************************************/
+void sds011Receiver::stop(void) {
+  if ( !_running ) return;
+  _running = false;
+  while ( _task != NULL ) delay( 1 );
+}
+
+#endif
@@ -0,0 +1,68 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (background receive path interface)
+
+/// @file sds011receiver.h
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#ifndef PM_SDS011_RECEIVER_h
+#define PM_SDS011_RECEIVER_h
+
+#include "sds011lib.h"
+#include "sds011ring.h"
+
+/// number of samples the receive ring holds, a power of two
+#define SDS011_RING_SIZE 32
+
+#if SDS011_HOST
+#include <pthread.h>
+#endif
+
+/// decodes data frames as they arrive and queues them as timestamped
+/// samples. service() is the producer: run it from a UART event task on the
+/// ESP32, a thread on a host (see start()) or simply from loop(). The
+/// application drains the samples in batches with read() whenever it has
+/// time; nothing is allocated on the way.
+class sds011Receiver {
+	public:
+		sds011Receiver(void);
+		bool begin( sds011Transport *transport );
+		uint16_t service(void);
+		uint16_t read( sds011Sample *samples, uint16_t max );
+		/// samples waiting to be read
+		uint16_t available(void) const { return( _ring.size() ); }
+		/// samples dropped because the application did not read in time
+		uint32_t overruns(void) const { return( _ring.overruns() ); }
+		/// valid data frames received
+		uint32_t frames(void) const { return( __atomic_load_n( &_frames, __ATOMIC_RELAXED ) ); }
+#if SDS011_HOST || defined(ARDUINO_ARCH_ESP32)
+		bool start( unsigned long period_ms = 5 );
+		void stop(void);
+#endif
+	private:
+		/// the transport connected to the sensor
+		sds011Transport *_uart;
+		/// the reply frame parser
+		sds011Parser _parser;
+		/// decoded samples
+		sds011Ring<sds011Sample, SDS011_RING_SIZE> _ring;
+		/// valid data frames received
+		uint32_t _frames;
+		/// pause of the receive thread / task between two service() calls
+		unsigned long _period;
+		/// true while the receive thread / task shall run
+		volatile bool _running;
+#if SDS011_HOST
+		/// the receive thread
+		pthread_t _thread;
+#elif defined(ARDUINO_ARCH_ESP32)
+		/// the receive task
+		TaskHandle_t _task;
+#endif
+#if SDS011_HOST
+		static void *run( void *self );
+#elif defined(ARDUINO_ARCH_ESP32)
+		static void task( void *self );
+#endif
+};
+
+#endif
@@ -0,0 +1,93 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (typed command results)
+
+/// @file sds011result.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// Fixed size results of the typed command API of sds011. Each carries the
+/// value and an explicit error code; none of them allocates or formats.
+
+#ifndef PM_SDS011_RESULT_h
+#define PM_SDS011_RESULT_h
+
+#include "sds011sample.h"
+
+/// cause of a failed command
+enum sds011Error : uint8_t {
+	/// the command was confirmed
+	SDS011_OK = 0,
+	/// not a byte came back: the sensor sleeps, is unplugged or has another id
+	SDS011_ERR_SILENT,
+	/// bytes came back, but not the reply (reports, noise, broken frames)
+	SDS011_ERR_NO_REPLY,
+	/// the reply does not confirm the value written
+	SDS011_ERR_REFUSED,
+	/// the argument is out of range, nothing was sent
+	SDS011_ERR_RANGE
+};
+
+/// reporting mode
+enum sds011ReportMode : uint8_t {
+	/// the sensor reports on its own
+	SDS011_REPORT_AUTO = 0,
+	/// the sensor answers queries only
+	SDS011_REPORT_QUERY = 1
+};
+
+/// sleep / work state
+enum sds011Power : uint8_t {
+	/// fan and laser off
+	SDS011_POWER_SLEEP = 0,
+	/// measuring
+	SDS011_POWER_WORK = 1
+};
+
+/// firmware date and id of the device
+struct sds011Firmware {
+	sds011Error error;
+	/// year, e.g. 2015
+	uint16_t year;
+	/// month 1 - 12
+	uint8_t month;
+	/// day 1 - 31
+	uint8_t day;
+	/// device id, ID byte 1 as the lower byte
+	uint16_t id;
+};
+
+/// device id
+struct sds011IdResult {
+	sds011Error error;
+	/// device id as confirmed, ID byte 1 as the lower byte
+	uint16_t id;
+};
+
+/// reporting mode
+struct sds011ModeResult {
+	sds011Error error;
+	/// the mode of the device
+	sds011ReportMode mode;
+};
+
+/// sleep / work state
+struct sds011PowerResult {
+	sds011Error error;
+	/// the state of the device
+	sds011Power power;
+};
+
+/// work period
+struct sds011PeriodResult {
+	sds011Error error;
+	/// minutes between measurements, 0 for continuous
+	uint8_t minutes;
+};
+
+/// a measurement
+struct sds011SampleResult {
+	sds011Error error;
+	/// id, receive time and PM values in 0.1 ug/m3
+	sds011Sample sample;
+};
+
+#endif
@@ -0,0 +1,68 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (lock-free sample ring)
+
+/// @file sds011ring.h
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#ifndef PM_SDS011_RING_h
+#define PM_SDS011_RING_h
+
+#include "sds011sample.h"
+
+/// fixed capacity single-producer / single-consumer ring without locks.
+/// One context (UART task, receive thread) pushes, one other context pops;
+/// the indexes run freely and are published with acquire / release
+/// ordering, so no interrupt masking or mutex is needed. A full ring drops
+/// the new element and counts an overrun. N must be a power of two.
+template <class T, uint16_t N>
+class sds011Ring {
+	public:
+		sds011Ring(void) : _head(0), _tail(0), _overruns(0) {}
+
+		/// producer: appends one element, false (and an overrun) when full
+		bool push( const T &item ) {
+			uint16_t tail = _tail;
+
+			if ( (uint16_t)( tail - __atomic_load_n( &_head, __ATOMIC_ACQUIRE ) ) >= N )
+			{
+				__atomic_store_n( &_overruns, _overruns + 1, __ATOMIC_RELAXED );
+				return( false );
+			}
+			_buf[tail & ( N - 1 )] = item;
+			__atomic_store_n( &_tail, (uint16_t)( tail + 1 ), __ATOMIC_RELEASE );
+			return( true );
+		}
+
+		/// consumer: takes up to max elements in one batch
+		uint16_t pop( T *out, uint16_t max ) {
+			uint16_t head = _head, n = 0;
+			uint16_t tail = __atomic_load_n( &_tail, __ATOMIC_ACQUIRE );
+
+			while ( head != tail && n < max ) out[n++] = _buf[head++ & ( N - 1 )];
+			__atomic_store_n( &_head, head, __ATOMIC_RELEASE );
+			return( n );
+		}
+
+		/// number of elements waiting, from either side
+		uint16_t size(void) const {
+			return( (uint16_t)( __atomic_load_n( &_tail, __ATOMIC_ACQUIRE ) - __atomic_load_n( &_head, __ATOMIC_ACQUIRE ) ) );
+		}
+
+		/// number of elements dropped because the ring was full
+		uint32_t overruns(void) const { return( __atomic_load_n( &_overruns, __ATOMIC_RELAXED ) ); }
+
+		/// capacity of the ring
+		static uint16_t capacity(void) { return( N ); }
+	private:
+		static_assert( N > 0 && ( N & ( N - 1 ) ) == 0, "ring size must be a power of two" );
+		/// the elements
+		T _buf[N];
+		/// consumer index, written by the consumer only
+		uint16_t _head;
+		/// producer index, written by the producer only
+		uint16_t _tail;
+		/// elements dropped, written by the producer only
+		uint32_t _overruns;
+};
+
+#endif
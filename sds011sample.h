@@ -0,0 +1,49 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (fixed-point samples)
+
+/// @file sds011sample.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// The sensor reports PM values as 16 bit integers in 0.1 ug/m3 (deci
+/// ug/m3). Samples keep that integer, so aggregation, thresholds and
+/// serialization stay in integer arithmetic; convert to float only where
+/// the value is presented.
+
+#ifndef PM_SDS011_SAMPLE_h
+#define PM_SDS011_SAMPLE_h
+
+#include "sds011port.h"
+
+/// one decoded measurement
+struct sds011Sample {
+	/// millis() when the frame was received
+	uint32_t time;
+	/// device id, ID byte 1 as the lower byte
+	uint16_t id;
+	/// PM2.5 in 0.1 ug/m3
+	uint16_t pm25;
+	/// PM10 in 0.1 ug/m3
+	uint16_t pm10;
+};
+
+/// a deci ug/m3 value from whole and tenth ug/m3, e.g. a threshold of 35.5 as sds011Deci( 35, 5 )
+inline uint16_t sds011Deci( uint16_t whole, uint8_t tenths = 0 ) {
+	return( (uint16_t)( whole * 10 + tenths ) );
+}
+
+/// whole ug/m3 of a deci ug/m3 value
+inline uint16_t sds011DeciWhole( uint16_t deci ) {
+	return( deci / 10 );
+}
+
+/// tenths of ug/m3 of a deci ug/m3 value
+inline uint8_t sds011DeciTenths( uint16_t deci ) {
+	return( deci % 10 );
+}
+
+/// deci ug/m3 as float ug/m3, one single precision multiply
+inline float sds011DeciToFloat( uint16_t deci ) {
+	return( deci * 0.1f );
+}
+
+#endif
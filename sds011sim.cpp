@@ -0,0 +1,405 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (software sensor simulator implementation)
+
+/// @file sds011sim.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011lib.h"
+#include "sds011sim.h"
+
+/// signed distance between two wrapping microsecond time stamps
+#define SIM_AFTER(a,b) ( (int32_t)( (uint32_t)(a) - (uint32_t)(b) ) >= 0 )
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+    @param baud simulated bit rate of the serial line
+*/
+/**************************************************************************/
+sds011Simulator::sds011Simulator( unsigned long baud ) {
+  _byteTime = 10000000UL / baud;
+  _latency = 1000;
+  _id_1 = 0xA1;
+  _id_2 = 0x60;
+  _idLocked = false;
+  _fw[0] = 18;
+  _fw[1] = 11;
+  _fw[2] = 16;
+  _pm25 = 123;
+  _pm10 = 456;
+  memset( &_faults, 0, sizeof( _faults ) );
+  _random = 1;
+  _injected = 0;
+  reset( 0 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  power cycles the simulated sensor: auto report mode, working,
+    continuous work period and empty queues
+    @param now current time in microseconds
+    @returns void
+*/
+/**************************************************************************/
+void sds011Simulator::reset( uint32_t now ) {
+  _mode = AUTO_REPORT_MODE;
+  _state = WORK_MODE;
+  _period = 0;
+  _rxLen = 0;
+  _rxClock = now;
+  _txHead = 0;
+  _txCount = 0;
+  _txClock = now;
+  _commands = 0;
+  _nextReport = now + reportInterval();
+}
+
+/**************************************************************************/
+/*!
+    @brief  sets the measurement values reported from now on
+    @param pm25 PM2.5 in 0.1 ug/m3
+    @param pm10 PM10 in 0.1 ug/m3
+    @returns void
+*/
+/**************************************************************************/
+void sds011Simulator::setPm( uint16_t pm25, uint16_t pm10 ) {
+  _pm25 = pm25;
+  _pm10 = pm10;
+}
+
+/**************************************************************************/
+/*!
+    @brief  sets the factory device id
+    @param id_1 id byte 1
+    @param id_2 id byte 2
+    @returns void
+*/
+/**************************************************************************/
+void sds011Simulator::setId( uint8_t id_1, uint8_t id_2 ) {
+  _id_1 = id_1;
+  _id_2 = id_2;
+}
+
+/**************************************************************************/
+/*!
+    @brief  makes the sensor refuse new ids: set id commands are answered
+    with the id it keeps
+    @param locked true to refuse, false to accept new ids
+    @returns void
+*/
+/**************************************************************************/
+void sds011Simulator::lockId( bool locked ) {
+  _idLocked = locked;
+}
+
+/**************************************************************************/
+/*!
+    @brief  sets the firmware date returned by the version command
+    @param year two digit year
+    @param month month
+    @param day day
+    @returns void
+*/
+/**************************************************************************/
+void sds011Simulator::setFirmware( uint8_t year, uint8_t month, uint8_t day ) {
+  _fw[0] = year;
+  _fw[1] = month;
+  _fw[2] = day;
+}
+
+/**************************************************************************/
+/*!
+    @brief  sets the processing time between a command and its reply
+    @param us latency in microseconds
+    @returns void
+*/
+/**************************************************************************/
+void sds011Simulator::setLatency( uint32_t us ) {
+  _latency = us;
+}
+
+/**************************************************************************/
+/*!
+    @brief  interval between two auto reports
+    @returns microseconds, one second in continuous mode
+*/
+/**************************************************************************/
+uint32_t sds011Simulator::reportInterval(void) const {
+  return( _period == 0 ? 1000000UL : _period * 60000000UL );
+}
+
+/**************************************************************************/
+/*!
+    @brief  bytes sent to the sensor. Every byte takes one byte time on
+    the wire, a command is executed once its last byte has arrived.
+    @param buf the bytes
+    @param len number of bytes
+    @param now time the host started writing, in microseconds
+    @returns void
+*/
+/**************************************************************************/
+void sds011Simulator::receive( const uint8_t *buf, size_t len, uint32_t now ) {
+  uint8_t c, i, checksum;
+
+  if ( SIM_AFTER( now, _rxClock ) ) _rxClock = now;
+  while ( len-- )
+  {
+    c = *buf++;
+    _rxClock += _byteTime;
+    if ( ( _rxLen == 0 && c != MSG_HEAD ) || ( _rxLen == 1 && c != CMD_WRITE_MODE ) )
+    {
+      _rxLen = ( c == MSG_HEAD ) ? 1 : 0;
+      if ( _rxLen ) _rx[0] = c;
+      continue;
+    }
+    _rx[_rxLen++] = c;
+    if ( _rxLen < SDS011_REQUEST_LEN ) continue;
+
+    _rxLen = 0;
+    for ( i = 2, checksum = 0; i < 17; ++i ) checksum += _rx[i];
+    if ( _rx[17] == checksum && _rx[18] == MSG_TAIL ) command( _rxClock );
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  executes the command frame in _rx as the data sheet describes.
+    A sleeping sensor only reacts to the sleep / work command, frames for
+    another device id are ignored.
+    @param now time the command has arrived
+    @returns void
+*/
+/**************************************************************************/
+void sds011Simulator::command( uint32_t now ) {
+  uint8_t data[4] = { _rx[2], _rx[3], 0, 0 };
+  bool set = _rx[3] == WRITE_MODE;
+
+  if ( !( _rx[15] == MSG_FF && _rx[16] == MSG_FF ) && !( _rx[15] == _id_1 && _rx[16] == _id_2 ) ) return;
+  if ( _state == SLEEP_MODE && _rx[2] != CMD_SLEEP_AND_WORK ) return;
+  ++_commands;
+
+  switch( _rx[2] )
+  {
+    case CMD_REPORTING_MODE:
+      if ( set ) _mode = _rx[4] ? QUERY_MODE : AUTO_REPORT_MODE;
+      data[2] = _mode;
+      break;
+    case CMD_QUERY_DATA:
+      data[0] = _pm25 & 0xff;
+      data[1] = _pm25 >> 8;
+      data[2] = _pm10 & 0xff;
+      data[3] = _pm10 >> 8;
+      reply( REPLY_DATA, data, _id_1, _id_2, now );
+      return;
+    case CMD_SET_DEVICE_ID:
+      if ( !_idLocked )
+      {
+        _id_1 = _rx[13];
+        _id_2 = _rx[14];
+      }
+      data[1] = 0;
+      break;
+    case CMD_SLEEP_AND_WORK:
+      if ( set )
+      {
+        if ( _state == SLEEP_MODE && _rx[4] == WORK_MODE ) _nextReport = now + reportInterval();
+        _state = _rx[4] ? WORK_MODE : SLEEP_MODE;
+      }
+      data[2] = _state;
+      break;
+    case CMD_FIRMWARE_VERSION:
+      data[1] = _fw[0];
+      data[2] = _fw[1];
+      data[3] = _fw[2];
+      break;
+    case CMD_WORKING_PERIOD:
+      if ( set && _rx[4] <= 30 )
+      {
+        _period = _rx[4];
+        _nextReport = now + reportInterval();
+      }
+      data[2] = _period;
+      break;
+    default:
+      --_commands;
+      return;
+  }
+  reply( REPLY_CFG, data, _id_1, _id_2, now );
+}
+
+/**************************************************************************/
+/*!
+    @brief  queues a reply frame behind everything already being sent,
+    with the faults drawn for it
+    @param kind REPLY_CFG or REPLY_DATA
+    @param data DATA1 to DATA4 of the reply
+    @param id_1 id byte 1 sent in the reply
+    @param id_2 id byte 2 sent in the reply
+    @param now earliest time the reply can be produced
+    @returns void
+*/
+/**************************************************************************/
+void sds011Simulator::reply( uint8_t kind, const uint8_t data[4], uint8_t id_1, uint8_t id_2, uint32_t now ) {
+  uint8_t frame[SDS011_REPLY_LEN] = { MSG_HEAD, kind, data[0], data[1], data[2], data[3], id_1, id_2, 0, MSG_TAIL };
+  uint8_t out[8 + 1 + 2 * SDS011_REPLY_LEN];
+  uint8_t i, n, len = 0, flen = SDS011_REPLY_LEN;
+
+  for ( i = 2; i < 8; ++i ) frame[8] += frame[i];
+
+  if ( kind == REPLY_CFG && chance( _faults.interleave ) )
+  {
+    out[len++] = MSG_HEAD;
+    out[len++] = REPLY_DATA;
+    out[len++] = _pm25 & 0xff;
+    out[len++] = _pm25 >> 8;
+    out[len++] = _pm10 & 0xff;
+    out[len++] = _pm10 >> 8;
+    out[len++] = _id_1;
+    out[len++] = _id_2;
+    out[len] = 0;
+    for ( i = len - 6; i < len; ++i ) out[len] += out[i];
+    ++len;
+    out[len++] = MSG_TAIL;
+  }
+  if ( chance( _faults.noise ) )
+  {
+    for ( n = 1 + random() % 8; n > 0; --n ) out[len++] = random() % 4 ? (uint8_t)random() : MSG_HEAD;
+  }
+  if ( chance( _faults.header ) ) out[len++] = MSG_HEAD;
+  if ( chance( _faults.command ) ) frame[1 + random() % 2] ^= (uint8_t)( 1 + random() % 255 );
+  if ( chance( _faults.checksum ) ) frame[8] ^= (uint8_t)( 1 + random() % 255 );
+  if ( chance( _faults.corrupt ) ) frame[random() % SDS011_REPLY_LEN] ^= (uint8_t)( 1 + random() % 255 );
+  if ( chance( _faults.drop ) )
+  {
+    i = random() % SDS011_REPLY_LEN;
+    memmove( frame + i, frame + i + 1, SDS011_REPLY_LEN - i - 1 );
+    --flen;
+  }
+  if ( chance( _faults.truncate ) ) flen = 1 + random() % ( flen - 1 );
+  memcpy( out + len, frame, flen );
+  transmit( out, len + flen, now );
+}
+
+/**************************************************************************/
+/*!
+    @brief  queues bytes behind everything already being sent
+    @param buf the bytes
+    @param len number of bytes
+    @param now earliest time the bytes can be produced
+    @returns void
+*/
+/**************************************************************************/
+void sds011Simulator::transmit( const uint8_t *buf, uint8_t len, uint32_t now ) {
+  uint8_t i, pos;
+  uint32_t t = now + _latency;
+
+  if ( _txCount + len > SDS011_SIM_TX_SIZE ) return;
+  if ( SIM_AFTER( _txClock, t ) ) t = _txClock;
+  for ( i = 0; i < len; ++i )
+  {
+    t += _byteTime;
+    pos = ( _txHead + _txCount++ ) % SDS011_SIM_TX_SIZE;
+    _tx[pos] = buf[i];
+    _txAt[pos] = t;
+  }
+  _txClock = t;
+}
+
+/**************************************************************************/
+/*!
+    @brief  sets the faults injected into the replies from now on
+    @param faults the fault probabilities
+    @param seed seed of the fault random generator, for repeatable runs
+    @returns void
+*/
+/**************************************************************************/
+void sds011Simulator::setFaults( const sds011SimFaults &faults, uint32_t seed ) {
+  _faults = faults;
+  _random = seed ? seed : 1;
+}
+
+/**************************************************************************/
+/*!
+    @brief  xorshift random generator for the faults
+    @returns the next random number
+*/
+/**************************************************************************/
+uint32_t sds011Simulator::random(void) {
+  _random ^= _random << 13;
+  _random ^= _random >> 17;
+  _random ^= _random << 5;
+  return( _random );
+}
+
+/**************************************************************************/
+/*!
+    @brief  draws one fault
+    @param permille probability in 1/1000
+    @returns true when the fault is to be injected
+*/
+/**************************************************************************/
+bool sds011Simulator::chance( uint16_t permille ) {
+  if ( permille == 0 || random() % 1000 >= permille ) return( false );
+  ++_injected;
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  produces the auto reports due until now
+    @param now current time in microseconds
+    @returns void
+*/
+/**************************************************************************/
+void sds011Simulator::tick( uint32_t now ) {
+  uint8_t data[4];
+  uint32_t interval = reportInterval();
+
+  if ( _state != WORK_MODE || _mode != AUTO_REPORT_MODE )
+  {
+    return;
+  }
+  // after a long pause only the latest report is produced
+  if ( SIM_AFTER( now, _nextReport + interval ) ) _nextReport = now - ( now - _nextReport ) % interval;
+  while ( SIM_AFTER( now, _nextReport ) )
+  {
+    data[0] = _pm25 & 0xff;
+    data[1] = _pm25 >> 8;
+    data[2] = _pm10 & 0xff;
+    data[3] = _pm10 >> 8;
+    reply( REPLY_DATA, data, _id_1, _id_2, _nextReport - _latency );
+    _nextReport += interval;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  number of bytes that have completely arrived at the host
+    @param now current time in microseconds
+    @returns byte count
+*/
+/**************************************************************************/
+int sds011Simulator::ready( uint32_t now ) {
+  uint8_t n;
+
+  tick( now );
+  for ( n = 0; n < _txCount && SIM_AFTER( now, _txAt[( _txHead + n ) % SDS011_SIM_TX_SIZE] ); ++n ) { }
+  return( n );
+}
+
+/**************************************************************************/
+/*!
+    @brief  takes the next byte that has arrived at the host
+    @param now current time in microseconds
+    @returns the byte, -1 when none has arrived yet
+*/
+/**************************************************************************/
+int sds011Simulator::read( uint32_t now ) {
+  uint8_t c;
+
+  if ( ready( now ) == 0 ) return( -1 );
+  c = _tx[_txHead];
+  _txHead = ( _txHead + 1 ) % SDS011_SIM_TX_SIZE;
+  --_txCount;
+  return( c );
+}
@@ -0,0 +1,137 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (software sensor simulator interface)
+
+/// @file sds011sim.h
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#ifndef PM_SDS011_SIM_h
+#define PM_SDS011_SIM_h
+
+#include "sds011transport.h"
+#include "sds011parser.h"
+
+/// size of the simulator transmit queue in bytes
+#define SDS011_SIM_TX_SIZE 64
+
+/// wire faults an sds011Simulator injects into its replies, each a
+/// probability in 1/1000 per reply frame; all 0 for a clean wire
+struct sds011SimFaults {
+	/// a burst of 1 to 8 random bytes, stray headers included, before the frame
+	uint16_t noise;
+	/// one byte of the frame changed
+	uint16_t corrupt;
+	/// one byte of the frame lost
+	uint16_t drop;
+	/// the header byte sent twice
+	uint16_t header;
+	/// a wrong reply or command id
+	uint16_t command;
+	/// a wrong check-sum
+	uint16_t checksum;
+	/// the frame cut short, as when the sensor is plugged in mid-frame
+	uint16_t truncate;
+	/// an extra data frame sent ahead of a configuration reply
+	uint16_t interleave;
+};
+
+/// software SDS011, speaking the 0xB4 command / 0xC5, 0xC0 reply protocol.
+/// Bytes written to the simulator are parsed as command frames and answered
+/// as the data sheet describes; in auto report mode a data frame is emitted
+/// every second, or once per work period. All bytes are paced at the
+/// simulated bit rate (10 bit times per byte) against a microsecond clock
+/// passed in by the caller, so the host sees the timing of a real wire.
+class sds011Simulator {
+	public:
+		sds011Simulator( unsigned long baud = 9600 );
+		void receive( const uint8_t *buf, size_t len, uint32_t now );
+		void tick( uint32_t now );
+		int ready( uint32_t now );
+		int read( uint32_t now );
+		void setPm( uint16_t pm25, uint16_t pm10 );
+		void setId( uint8_t id_1, uint8_t id_2 );
+		void setFirmware( uint8_t year, uint8_t month, uint8_t day );
+		void lockId( bool locked );
+		void setLatency( uint32_t us );
+		void reset( uint32_t now );
+		void setFaults( const sds011SimFaults &faults, uint32_t seed = 1 );
+		/// number of faults injected
+		uint32_t faults(void) const { return( _injected ); }
+		/// reporting mode, AUTO_REPORT_MODE or QUERY_MODE
+		uint8_t reportMode(void) const { return( _mode ); }
+		/// SLEEP_MODE or WORK_MODE
+		uint8_t state(void) const { return( _state ); }
+		/// work period in minutes, 0 for continuous
+		uint8_t workPeriod(void) const { return( _period ); }
+		/// number of valid command frames received
+		uint32_t commands(void) const { return( _commands ); }
+	private:
+		/// time for one byte on the wire in microseconds
+		uint32_t _byteTime;
+		/// processing delay between the end of a command and its reply
+		uint32_t _latency;
+		/// device id byte 1
+		uint8_t _id_1;
+		/// device id byte 2
+		uint8_t _id_2;
+		/// true when set id commands are answered with the unchanged id
+		bool _idLocked;
+		/// reporting mode
+		uint8_t _mode;
+		/// sleep or work state
+		uint8_t _state;
+		/// work period in minutes
+		uint8_t _period;
+		/// firmware date year, month, day
+		uint8_t _fw[3];
+		/// PM2.5 in 0.1 ug/m3
+		uint16_t _pm25;
+		/// PM10 in 0.1 ug/m3
+		uint16_t _pm10;
+		/// command frame being assembled
+		uint8_t _rx[SDS011_REQUEST_LEN];
+		/// bytes assembled in _rx
+		uint8_t _rxLen;
+		/// time the last received byte has fully arrived
+		uint32_t _rxClock;
+		/// transmit queue bytes
+		uint8_t _tx[SDS011_SIM_TX_SIZE];
+		/// time each queued byte is completely on the wire
+		uint32_t _txAt[SDS011_SIM_TX_SIZE];
+		/// transmit queue read position
+		uint8_t _txHead;
+		/// number of queued bytes
+		uint8_t _txCount;
+		/// time the last queued byte leaves the transmitter
+		uint32_t _txClock;
+		/// time of the next auto report
+		uint32_t _nextReport;
+		/// valid commands received
+		uint32_t _commands;
+		/// fault probabilities
+		sds011SimFaults _faults;
+		/// state of the fault random generator
+		uint32_t _random;
+		/// faults injected
+		uint32_t _injected;
+		void command( uint32_t now );
+		void reply( uint8_t id, const uint8_t data[4], uint8_t id_1, uint8_t id_2, uint32_t now );
+		void transmit( const uint8_t *buf, uint8_t len, uint32_t now );
+		uint32_t random(void);
+		bool chance( uint16_t permille );
+		uint32_t reportInterval(void) const;
+};
+
+/// in-process transport connecting the library to an sds011Simulator,
+/// timed by micros()
+class sds011SimTransport : public sds011Transport {
+	public:
+		sds011SimTransport( sds011Simulator *sim ) : _sim(sim) {}
+		int available(void) { return( _sim->ready( (uint32_t)micros() ) ); }
+		int read(void) { return( _sim->read( (uint32_t)micros() ) ); }
+		size_t write( const uint8_t *buf, size_t len ) { _sim->receive( buf, len, (uint32_t)micros() ); return( len ); }
+	private:
+		/// the simulated sensor
+		sds011Simulator *_sim;
+};
+
+#endif
@@ -0,0 +1,379 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (windowed statistics implementation)
+
+/// @file sds011stats.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011stats.h"
+
+/// upper bound (inclusive, 0.1 ug/m3) of every quantile bin: fine steps at
+/// low concentrations, the PM2.5 AQI breakpoints, coarse steps above
+static const uint16_t binEdges[SDS011_QUANTILE_BINS] = {
+  20, 40, 60, 80, 100, 120, 150, 200, 250, 300, 354, 400,
+  450, 554, 700, 850, 1000, 1250, 1504, 2000, 2504, 3504, 5004, 65535
+};
+
+/// a segment of the AQI table: concentrations up to high (0.1 ug/m3) map linearly onto indices up to index
+struct aqiBreakpoint {
+  /// highest concentration of the segment in 0.1 ug/m3
+  uint16_t high;
+  /// index at that concentration
+  uint16_t index;
+};
+
+/// PM2.5 24 hour breakpoints of the US EPA, 2024 revision
+static const aqiBreakpoint aqiPm25[] = {
+  { 90, 50 }, { 354, 100 }, { 554, 150 }, { 1254, 200 }, { 2254, 300 }, { 3254, 500 }
+};
+
+/// PM10 24 hour breakpoints of the US EPA, 2024 revision
+static const aqiBreakpoint aqiPm10[] = {
+  { 540, 50 }, { 1540, 100 }, { 2540, 150 }, { 3540, 200 }, { 4240, 300 }, { 6040, 500 }
+};
+
+/**************************************************************************/
+/*!
+    @brief  AQI sub-index of a truncated concentration, by linear
+    interpolation inside its segment of the table
+    @param table the breakpoints
+    @param n number of segments
+    @param step resolution of the concentrations of the table, 1 for PM2.5 and 10 for PM10
+    @param c the concentration in 0.1 ug/m3
+    @returns the index, 500 above the table
+*/
+/**************************************************************************/
+static uint16_t aqiIndex( const aqiBreakpoint *table, uint8_t n, uint16_t step, uint16_t c ) {
+  uint32_t cLow = 0, iLow = 0;
+  uint8_t i;
+
+  for ( i = 0; i < n; ++i )
+  {
+    if ( c <= table[i].high )
+    {
+      // round( ( iHigh - iLow ) / ( cHigh - cLow ) * ( c - cLow ) + iLow )
+      uint32_t span = table[i].high - cLow, rise = table[i].index - iLow;
+      return( (uint16_t)( iLow + ( rise * ( c - cLow ) + span / 2 ) / span ) );
+    }
+    cLow = table[i].high + step;
+    iLow = table[i].index + 1;
+  }
+  return( 500 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class, a one minute window
+*/
+/**************************************************************************/
+sds011Window::sds011Window(void) {
+  begin( 60000UL, 0 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  empties the window and sets its length
+    @param length window length in milliseconds
+    @param now current time in milliseconds
+    @returns void
+*/
+/**************************************************************************/
+void sds011Window::begin( uint32_t length, uint32_t now ) {
+  uint8_t i;
+
+  _span = length / SDS011_WINDOW_BUCKETS;
+  if ( _span == 0 ) _span = 1;
+  _start = now;
+  _cur = 0;
+  _sum = 0;
+  _count = 0;
+  _dropped = 0;
+  for ( i = 0; i < SDS011_QUANTILE_BINS; ++i ) _bins[i] = 0;
+  for ( i = 0; i < SDS011_WINDOW_BUCKETS; ++i ) clear( &_buckets[i] );
+}
+
+/**************************************************************************/
+/*!
+    @brief  empties one bucket
+    @param b the bucket
+    @returns void
+*/
+/**************************************************************************/
+void sds011Window::clear( bucket *b ) {
+  uint8_t i;
+
+  b->sum = 0;
+  b->count = 0;
+  b->min = 0xffff;
+  b->max = 0;
+  for ( i = 0; i < SDS011_QUANTILE_BINS; ++i ) b->bins[i] = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  quantile bin of a value
+    @param value in 0.1 ug/m3
+    @returns bin index
+*/
+/**************************************************************************/
+uint8_t sds011Window::bin( uint16_t value ) {
+  uint8_t lo = 0, hi = SDS011_QUANTILE_BINS - 1, mid;
+
+  while ( lo < hi )
+  {
+    mid = ( lo + hi ) / 2;
+    if ( value <= binEdges[mid] ) hi = mid; else lo = mid + 1;
+  }
+  return( lo );
+}
+
+/**************************************************************************/
+/*!
+    @brief  expires the buckets that fell out of the window
+    @param now current time in milliseconds
+    @returns void
+*/
+/**************************************************************************/
+void sds011Window::advance( uint32_t now ) {
+  uint32_t steps = ( now - _start ) / _span;
+  uint8_t i;
+  bucket *b;
+
+  if ( (int32_t)( now - _start ) < 0 || steps == 0 ) return;
+  _start += steps * _span;
+  if ( steps >= SDS011_WINDOW_BUCKETS )
+  {
+    begin( _span * SDS011_WINDOW_BUCKETS, _start );
+    return;
+  }
+  while ( steps-- )
+  {
+    _cur = ( _cur + 1 ) % SDS011_WINDOW_BUCKETS;
+    b = &_buckets[_cur];
+    _sum -= b->sum;
+    _count -= b->count;
+    for ( i = 0; i < SDS011_QUANTILE_BINS; ++i ) _bins[i] -= b->bins[i];
+    clear( b );
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  adds a sample; a sample older than the newest bucket is
+    counted in the newest bucket
+    @param time millis() of the sample
+    @param value in 0.1 ug/m3
+    @returns false when the bucket was full and the sample dropped
+*/
+/**************************************************************************/
+bool sds011Window::add( uint32_t time, uint16_t value ) {
+  bucket *b;
+  uint8_t i;
+
+  advance( time );
+  b = &_buckets[_cur];
+  if ( b->count == 0xffff )
+  {
+    ++_dropped;
+    return( false );
+  }
+  i = bin( value );
+  ++b->count;
+  b->sum += value;
+  ++b->bins[i];
+  if ( value < b->min ) b->min = value;
+  if ( value > b->max ) b->max = value;
+  ++_count;
+  _sum += value;
+  ++_bins[i];
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  smallest value in the window
+    @returns value in 0.1 ug/m3, 0 for an empty window
+*/
+/**************************************************************************/
+uint16_t sds011Window::min(void) const {
+  uint16_t m = 0xffff;
+  uint8_t i;
+
+  for ( i = 0; i < SDS011_WINDOW_BUCKETS; ++i ) if ( _buckets[i].count && _buckets[i].min < m ) m = _buckets[i].min;
+  return( _count ? m : 0 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  largest value in the window
+    @returns value in 0.1 ug/m3, 0 for an empty window
+*/
+/**************************************************************************/
+uint16_t sds011Window::max(void) const {
+  uint16_t m = 0;
+  uint8_t i;
+
+  for ( i = 0; i < SDS011_WINDOW_BUCKETS; ++i ) if ( _buckets[i].count && _buckets[i].max > m ) m = _buckets[i].max;
+  return( m );
+}
+
+/**************************************************************************/
+/*!
+    @brief  approximate quantile, interpolated inside the bin holding it
+    and clamped to the window minimum and maximum
+    @param percent the quantile, 0 to 100
+    @returns value in 0.1 ug/m3, 0 for an empty window
+*/
+/**************************************************************************/
+uint16_t sds011Window::quantile( uint8_t percent ) const {
+  uint32_t target, before = 0, lo, hi;
+  uint16_t lowest, highest, value;
+  uint8_t i;
+
+  if ( _count == 0 ) return( 0 );
+  if ( percent > 100 ) percent = 100;
+  target = ( _count * percent + 99 ) / 100;
+  if ( target == 0 ) target = 1;
+  for ( i = 0; i < SDS011_QUANTILE_BINS - 1 && before + _bins[i] < target; ++i ) before += _bins[i];
+
+  lowest = min();
+  highest = max();
+  lo = i ? binEdges[i - 1] + 1 : 0;
+  hi = binEdges[i];
+  if ( lo < lowest ) lo = lowest;
+  if ( hi > highest ) hi = highest;
+  if ( hi < lo ) hi = lo;
+  value = (uint16_t)( lo + ( hi - lo ) * ( target - before ) / ( _bins[i] ? _bins[i] : 1 ) );
+  return( value > highest ? highest : value );
+}
+
+/**************************************************************************/
+/*!
+    @brief  all figures of the window at once
+    @param out the summary to fill
+    @returns void
+*/
+/**************************************************************************/
+void sds011Window::summary( sds011Summary *out ) const {
+  out->count = _count;
+  out->mean = mean();
+  out->min = min();
+  out->max = max();
+  out->p50 = quantile( 50 );
+  out->p90 = quantile( 90 );
+  out->p99 = quantile( 99 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class, see begin()
+*/
+/**************************************************************************/
+sds011Stats::sds011Stats(void) {
+  begin( 0 );
+}
+
+/**************************************************************************/
+/*!
+    @brief  empties all windows and sets the default lengths of 1 minute,
+    15 minutes and 24 hours
+    @param now current time in milliseconds
+    @returns void
+*/
+/**************************************************************************/
+void sds011Stats::begin( uint32_t now ) {
+  static const uint32_t lengths[3] = { 60000UL, 900000UL, 86400000UL };
+  uint8_t i;
+
+  for ( i = 0; i < SDS011_STATS_WINDOWS; ++i ) setWindow( i, lengths[i < 3 ? i : 2], now );
+}
+
+/**************************************************************************/
+/*!
+    @brief  empties one window and sets its length
+    @param window window index, 0 to SDS011_STATS_WINDOWS - 1
+    @param length window length in milliseconds
+    @param now current time in milliseconds
+    @returns false for an unknown window
+*/
+/**************************************************************************/
+bool sds011Stats::setWindow( uint8_t window, uint32_t length, uint32_t now ) {
+  if ( window >= SDS011_STATS_WINDOWS ) return( false );
+  _pm25[window].begin( length, now );
+  _pm10[window].begin( length, now );
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  adds a decoded sample to all windows
+    @param sample the sample
+    @returns false when a window dropped it, see sds011Window::dropped()
+*/
+/**************************************************************************/
+bool sds011Stats::add( const sds011Sample &sample ) {
+  bool kept = true;
+  uint8_t i;
+
+  for ( i = 0; i < SDS011_STATS_WINDOWS; ++i )
+  {
+    kept = _pm25[i].add( sample.time, sample.pm25 ) && kept;
+    kept = _pm10[i].add( sample.time, sample.pm10 ) && kept;
+  }
+  return( kept );
+}
+
+/**************************************************************************/
+/*!
+    @brief  expires old samples of all windows, call before reading
+    figures when samples may have stopped arriving
+    @param now current time in milliseconds
+    @returns void
+*/
+/**************************************************************************/
+void sds011Stats::advance( uint32_t now ) {
+  uint8_t i;
+
+  for ( i = 0; i < SDS011_STATS_WINDOWS; ++i )
+  {
+    _pm25[i].advance( now );
+    _pm10[i].advance( now );
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  figures of both channels over one window
+    @param window window index
+    @param pm25 PM2.5 summary to fill, may be NULL
+    @param pm10 PM10 summary to fill, may be NULL
+    @returns false for an unknown window
+*/
+/**************************************************************************/
+bool sds011Stats::summary( uint8_t window, sds011Summary *pm25, sds011Summary *pm10 ) const {
+  if ( window >= SDS011_STATS_WINDOWS ) return( false );
+  if ( pm25 ) _pm25[window].summary( pm25 );
+  if ( pm10 ) _pm10[window].summary( pm10 );
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  Air Quality Index over one window: the means truncated as the
+    EPA breakpoints take them (PM2.5 to 0.1, PM10 to 1 ug/m3) and the
+    sub-indices. The 24 hour window gives the daily AQI, the 1 minute
+    window a current indication.
+    @param window window index
+    @param out the figures to fill
+    @returns false for an unknown window
+*/
+/**************************************************************************/
+bool sds011Stats::aqi( uint8_t window, sds011Aqi *out ) const {
+  if ( window >= SDS011_STATS_WINDOWS ) return( false );
+  out->count = _pm25[window].count();
+  out->pm25 = _pm25[window].floorMean();
+  out->pm10 = (uint16_t)( _pm10[window].floorMean() / 10 * 10 );
+  out->aqi25 = out->count ? aqiIndex( aqiPm25, sizeof( aqiPm25 ) / sizeof( aqiPm25[0] ), 1, out->pm25 ) : 0;
+  out->aqi10 = out->count ? aqiIndex( aqiPm10, sizeof( aqiPm10 ) / sizeof( aqiPm10[0] ), 10, out->pm10 ) : 0;
+  out->aqi = out->aqi25 > out->aqi10 ? out->aqi25 : out->aqi10;
+  return( true );
+}
@@ -0,0 +1,139 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (windowed statistics interface)
+
+/// @file sds011stats.h
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#ifndef PM_SDS011_STATS_h
+#define PM_SDS011_STATS_h
+
+#include "sds011sample.h"
+
+#ifndef SDS011_WINDOW_BUCKETS
+/// number of buckets a window is divided into, the time resolution of expiry
+#define SDS011_WINDOW_BUCKETS 12
+#endif
+/// number of value bins of the quantile sketch
+#define SDS011_QUANTILE_BINS 24
+#ifndef SDS011_STATS_WINDOWS
+/// number of concurrent windows of an sds011Stats
+#define SDS011_STATS_WINDOWS 3
+#endif
+
+/// summary of one channel over one window, values in 0.1 ug/m3
+struct sds011Summary {
+	/// number of samples in the window
+	uint32_t count;
+	/// mean
+	uint16_t mean;
+	/// smallest value
+	uint16_t min;
+	/// largest value
+	uint16_t max;
+	/// median estimate
+	uint16_t p50;
+	/// 90th percentile estimate
+	uint16_t p90;
+	/// 99th percentile estimate
+	uint16_t p99;
+};
+
+/// inputs and indices of the US EPA Air Quality Index (2024 breakpoints) over
+/// one window. The EPA table applies to 24 hour means; over shorter
+/// windows the figures are an early indication. Concentrations in 0.1 ug/m3.
+struct sds011Aqi {
+	/// number of samples in the window; all figures are 0 without any
+	uint32_t count;
+	/// PM2.5 mean truncated to 0.1 ug/m3, as the breakpoints take it
+	uint16_t pm25;
+	/// PM10 mean truncated to 1 ug/m3, as the breakpoints take it
+	uint16_t pm10;
+	/// PM2.5 sub-index, 0 - 500
+	uint16_t aqi25;
+	/// PM10 sub-index, 0 - 500
+	uint16_t aqi10;
+	/// the larger sub-index, the AQI to report
+	uint16_t aqi;
+};
+
+/// sliding time window over one channel. The window is split into
+/// SDS011_WINDOW_BUCKETS buckets of equal span; a sample updates the
+/// current bucket and the running totals in O(1), whole buckets expire as
+/// time passes. Each bucket also counts values per bin of a fixed,
+/// roughly logarithmic grid, which gives approximate quantiles. Memory is
+/// constant whatever the window length; only the expiry granularity
+/// (length / SDS011_WINDOW_BUCKETS) grows. A bucket holds at most 65535
+/// samples, e.g. 9 Hz over the 2 h bucket of a 24 hour window; further
+/// samples of its span are dropped and counted.
+class sds011Window {
+	public:
+		sds011Window(void);
+		void begin( uint32_t length, uint32_t now );
+		bool add( uint32_t time, uint16_t value );
+		void advance( uint32_t now );
+		/// number of samples in the window
+		uint32_t count(void) const { return( _count ); }
+		/// mean in 0.1 ug/m3, 0 for an empty window
+		uint16_t mean(void) const { return( _count ? (uint16_t)( ( _sum + _count / 2 ) / _count ) : 0 ); }
+		/// mean in 0.1 ug/m3 rounded down, 0 for an empty window
+		uint16_t floorMean(void) const { return( _count ? (uint16_t)( _sum / _count ) : 0 ); }
+		/// samples dropped since begin() because their bucket was full
+		uint32_t dropped(void) const { return( _dropped ); }
+		uint16_t min(void) const;
+		uint16_t max(void) const;
+		uint16_t quantile( uint8_t percent ) const;
+		void summary( sds011Summary *out ) const;
+		/// window length in milliseconds
+		uint32_t length(void) const { return( _span * SDS011_WINDOW_BUCKETS ); }
+	private:
+		/// the samples of one span of time
+		struct bucket {
+			uint32_t sum;
+			uint16_t count;
+			uint16_t min;
+			uint16_t max;
+			uint16_t bins[SDS011_QUANTILE_BINS];
+		};
+		/// the buckets, a ring with _cur as the newest
+		bucket _buckets[SDS011_WINDOW_BUCKETS];
+		/// sum over all buckets; a week at 1 Hz near full scale passes 2^32
+		uint64_t _sum;
+		/// samples over all buckets
+		uint32_t _count;
+		/// samples dropped into a full bucket since begin()
+		uint32_t _dropped;
+		/// samples per bin over all buckets
+		uint32_t _bins[SDS011_QUANTILE_BINS];
+		/// time span of one bucket in milliseconds
+		uint32_t _span;
+		/// start time of the newest bucket
+		uint32_t _start;
+		/// index of the newest bucket
+		uint8_t _cur;
+		void clear( bucket *b );
+		static uint8_t bin( uint16_t value );
+};
+
+/// PM2.5 and PM10 statistics over several concurrent windows, by default
+/// 1 minute, 15 minutes and 24 hours, fed with decoded samples
+class sds011Stats {
+	public:
+		sds011Stats(void);
+		void begin( uint32_t now );
+		bool setWindow( uint8_t window, uint32_t length, uint32_t now );
+		bool add( const sds011Sample &sample );
+		void advance( uint32_t now );
+		bool summary( uint8_t window, sds011Summary *pm25, sds011Summary *pm10 ) const;
+		bool aqi( uint8_t window, sds011Aqi *out ) const;
+		/// PM2.5 window, for direct queries
+		const sds011Window &pm25( uint8_t window ) const { return( _pm25[window] ); }
+		/// PM10 window, for direct queries
+		const sds011Window &pm10( uint8_t window ) const { return( _pm10[window] ); }
+	private:
+		/// PM2.5 windows
+		sds011Window _pm25[SDS011_STATS_WINDOWS];
+		/// PM10 windows
+		sds011Window _pm10[SDS011_STATS_WINDOWS];
+};
+
+#endif
@@ -0,0 +1,105 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (adaptive reply timeouts implementation)
+
+/// @file sds011timeout.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011timeout.h"
+
+/// largest backoff shift, the timeout grows at most 8 fold
+#define SDS011_BACKOFF_MAX 3
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011Timeouts::sds011Timeouts(void) {
+  reset();
+}
+
+/**************************************************************************/
+/*!
+    @brief  forgets all round trips, e.g. after the sensor was replaced
+    @returns void
+*/
+/**************************************************************************/
+void sds011Timeouts::reset(void) {
+  memset( _srtt, 0, sizeof( _srtt ) );
+  memset( _rttvar, 0, sizeof( _rttvar ) );
+  memset( _backoff, 0, sizeof( _backoff ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  time to wait for the reply to a command
+    @param command the command id
+    @returns the timeout in ms
+*/
+/**************************************************************************/
+uint32_t sds011Timeouts::timeout( uint8_t command ) const {
+  uint8_t i = sds011CommandIndex( command );
+  uint32_t t;
+
+  if ( i >= SDS011_COMMANDS || _srtt[i] == 0 ) return( SDS011_TIMEOUT_INITIAL );
+  t = ( ( _srtt[i] >> 3 ) + _rttvar[i] ) << _backoff[i];
+  if ( t < SDS011_TIMEOUT_MIN ) t = SDS011_TIMEOUT_MIN;
+  if ( t > SDS011_TIMEOUT_MAX ) t = SDS011_TIMEOUT_MAX;
+  return( t );
+}
+
+/**************************************************************************/
+/*!
+    @brief  takes the round trip of a reply to the first send of a command
+    @param command the command id
+    @param ms the round trip in ms
+    @returns void
+*/
+/**************************************************************************/
+void sds011Timeouts::observe( uint8_t command, uint32_t ms ) {
+  uint8_t i = sds011CommandIndex( command );
+  int32_t err;
+
+  if ( i >= SDS011_COMMANDS ) return;
+  if ( ms > SDS011_TIMEOUT_MAX ) ms = SDS011_TIMEOUT_MAX;
+  if ( ms == 0 ) ms = 1;
+  _backoff[i] = 0;
+  if ( _srtt[i] == 0 )
+  {
+    _srtt[i] = (uint16_t)( ms << 3 );
+    _rttvar[i] = (uint16_t)( ms << 1 );
+    return;
+  }
+  // srtt += ( ms - srtt ) / 8, rttvar += ( |ms - srtt| - rttvar ) / 4, both scaled
+  err = (int32_t)ms - ( _srtt[i] >> 3 );
+  _srtt[i] = (uint16_t)( _srtt[i] + err );
+  if ( err < 0 ) err = -err;
+  _rttvar[i] = (uint16_t)( _rttvar[i] + err - ( _rttvar[i] >> 2 ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  notes a wait for a command that ended without a byte, which
+    doubles the next timeout
+    @param command the command id
+    @returns void
+*/
+/**************************************************************************/
+void sds011Timeouts::expired( uint8_t command ) {
+  uint8_t i = sds011CommandIndex( command );
+
+  if ( i < SDS011_COMMANDS && _backoff[i] < SDS011_BACKOFF_MAX ) ++_backoff[i];
+}
+
+/**************************************************************************/
+/*!
+    @brief  smoothed round trip of a command
+    @param command the command id
+    @returns the round trip in ms, 0 before the first reply
+*/
+/**************************************************************************/
+uint32_t sds011Timeouts::latency( uint8_t command ) const {
+  uint8_t i = sds011CommandIndex( command );
+
+  return( i < SDS011_COMMANDS ? (uint32_t)( ( _srtt[i] + 4 ) >> 3 ) : 0 );
+}
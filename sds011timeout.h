@@ -0,0 +1,66 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (adaptive reply timeouts)
+
+/// @file sds011timeout.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// A command frame and its reply take about 30 ms on the wire at 9600 baud,
+/// and the sensor answers within a few ms more. Instead of a fixed wait,
+/// each command gets a deadline from the smoothed round trip and its
+/// variation observed so far (as TCP does: srtt + 4 * rttvar), doubled after
+/// each silent timeout. Only replies to the first send are measured, so a
+/// late reply to an earlier try cannot shrink the estimate.
+
+#ifndef PM_SDS011_TIMEOUT_h
+#define PM_SDS011_TIMEOUT_h
+
+#include "sds011port.h"
+
+/// number of commands with their own estimate, see sds011CommandIndex()
+#define SDS011_COMMANDS 6
+/// timeout before the first reply was seen, in ms
+#define SDS011_TIMEOUT_INITIAL 900
+/// shortest timeout in ms, a little above the wire time of request and reply
+#define SDS011_TIMEOUT_MIN 40
+/// longest timeout in ms
+#define SDS011_TIMEOUT_MAX 2000
+/// wait for the reply to the wake command in ms; a waking sensor often does not answer
+#define SDS011_WAKE_TIMEOUT 1000
+/// sends of a command that got no byte at all back (sensor asleep, unplugged)
+#define SDS011_TRIES_SILENT 2
+/// sends of a command that got bytes but not its reply (reports, noise)
+#define SDS011_TRIES_WRONG 4
+
+/// index of a command id, SDS011_COMMANDS for unknown ids
+inline uint8_t sds011CommandIndex( uint8_t command ) {
+	switch( command )
+	{
+		case 0x02: return( 0 );		// CMD_REPORTING_MODE
+		case 0x04: return( 1 );		// CMD_QUERY_DATA
+		case 0x05: return( 2 );		// CMD_SET_DEVICE_ID
+		case 0x06: return( 3 );		// CMD_SLEEP_AND_WORK
+		case 0x07: return( 4 );		// CMD_FIRMWARE_VERSION
+		case 0x08: return( 5 );		// CMD_WORKING_PERIOD
+		default: return( SDS011_COMMANDS );
+	}
+}
+
+/// learned round trip and timeout per command of one device or port
+class sds011Timeouts {
+	public:
+		sds011Timeouts(void);
+		void reset(void);
+		uint32_t timeout( uint8_t command ) const;
+		void observe( uint8_t command, uint32_t ms );
+		void expired( uint8_t command );
+		uint32_t latency( uint8_t command ) const;
+	private:
+		/// smoothed round trip in 1/8 ms, 0 before the first reply
+		uint16_t _srtt[SDS011_COMMANDS];
+		/// smoothed deviation of the round trip in 1/4 ms
+		uint16_t _rttvar[SDS011_COMMANDS];
+		/// timeouts in a row, each doubles the timeout
+		uint8_t _backoff[SDS011_COMMANDS];
+};
+
+#endif
@@ -0,0 +1,189 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness sds011 PM sensor (POSIX transport implementation)
+
+/// @file sds011transport.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include "sds011transport.h"
+
+#if SDS011_HOST
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011PosixTransport::sds011PosixTransport(void) : _fd(-1), _owned(false), _head(0), _tail(0) {
+}
+
+/**************************************************************************/
+/*!
+    @brief  destructor, closes an owned descriptor
+*/
+/**************************************************************************/
+sds011PosixTransport::~sds011PosixTransport(void) {
+  close();
+}
+
+/**************************************************************************/
+/*!
+    @brief  opens a tty and configures it raw, 8N1 at the given bit rate
+    @param path device path, e.g. /dev/ttyUSB0 or a pty slave
+    @param baud bit rate, 9600 for the sensor
+    @returns status true when the port is ready
+*/
+/**************************************************************************/
+bool sds011PosixTransport::open( const char *path, unsigned long baud ) {
+  struct termios tio;
+  speed_t speed;
+  int fd;
+
+  switch( baud )
+  {
+    case 9600:   speed = B9600;   break;
+    case 19200:  speed = B19200;  break;
+    case 38400:  speed = B38400;  break;
+    case 57600:  speed = B57600;  break;
+    case 115200: speed = B115200; break;
+    default: return( false );
+  }
+
+  fd = ::open( path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC );
+  if ( fd < 0 ) return( false );
+  if ( tcgetattr( fd, &tio ) == 0 )
+  {
+    cfmakeraw( &tio );
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~( CSTOPB | PARENB );
+    cfsetispeed( &tio, speed );
+    cfsetospeed( &tio, speed );
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr( fd, TCSANOW, &tio );
+  }
+  return( attach( fd, true ) );
+}
+
+/**************************************************************************/
+/*!
+    @brief  uses an already opened descriptor, e.g. the master side of a pty
+    @param fd the descriptor, switched to non-blocking mode
+    @param owned true when close() shall close the descriptor
+    @returns status true when the descriptor is usable
+*/
+/**************************************************************************/
+bool sds011PosixTransport::attach( int fd, bool owned ) {
+  int flags;
+
+  close();
+  if ( fd < 0 || ( flags = fcntl( fd, F_GETFL ) ) < 0 ) return( false );
+  fcntl( fd, F_SETFL, flags | O_NONBLOCK );
+  _fd = fd;
+  _owned = owned;
+  _head = _tail = 0;
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  releases the descriptor
+    @returns void
+*/
+/**************************************************************************/
+void sds011PosixTransport::close(void) {
+  if ( _fd >= 0 && _owned ) ::close( _fd );
+  _fd = -1;
+  _head = _tail = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  reads whatever the descriptor has into the local buffer
+    @returns void
+*/
+/**************************************************************************/
+void sds011PosixTransport::fill(void) {
+  ssize_t n;
+
+  if ( _fd < 0 || _head < _tail ) return;
+  _head = _tail = 0;
+  n = ::read( _fd, _buf, sizeof( _buf ) );
+  if ( n > 0 ) _tail = (uint16_t)n;
+}
+
+/**************************************************************************/
+/*!
+    @brief  number of received bytes ready to be read
+    @returns byte count
+*/
+/**************************************************************************/
+int sds011PosixTransport::available(void) {
+  fill();
+  return( _tail - _head );
+}
+
+/**************************************************************************/
+/*!
+    @brief  next received byte
+    @returns the byte, -1 when none is available
+*/
+/**************************************************************************/
+int sds011PosixTransport::read(void) {
+  fill();
+  if ( _head >= _tail ) return( -1 );
+  return( _buf[_head++] );
+}
+
+/**************************************************************************/
+/*!
+    @brief  writes a buffer. A busy non-blocking descriptor is waited for
+    with poll(), up to SDS011_WRITE_TIMEOUT ms without progress; a port
+    that stalls longer gets a short write.
+    @param buf the bytes to write
+    @param len number of bytes
+    @returns number of bytes written
+*/
+/**************************************************************************/
+size_t sds011PosixTransport::write( const uint8_t *buf, size_t len ) {
+  struct pollfd pfd;
+  size_t done = 0;
+  ssize_t n;
+
+  while ( _fd >= 0 && done < len )
+  {
+    n = ::write( _fd, buf + done, len - done );
+    if ( n > 0 )
+    {
+      done += n;
+    }else if ( n < 0 && errno == EAGAIN )
+    {
+      pfd.fd = _fd;
+      pfd.events = POLLOUT;
+      pfd.revents = 0;
+      n = poll( &pfd, 1, SDS011_WRITE_TIMEOUT );
+      if ( n == 0 || ( n < 0 && errno != EINTR ) || ( pfd.revents & ( POLLERR | POLLHUP | POLLNVAL ) ) ) break;
+    }else if ( n == 0 || errno != EINTR )
+    {
+      break;
+    }
+  }
+  return( done );
+}
+
+/**************************************************************************/
+/*!
+    @brief  waits until all written bytes are transmitted
+    @returns void
+*/
+/**************************************************************************/
+void sds011PosixTransport::flush(void) {
+  if ( _fd >= 0 ) tcdrain( _fd );
+}
+
+#endif
@@ -0,0 +1,82 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (byte transport interface)
+
+/// @file sds011transport.h
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#ifndef PM_SDS011_TRANSPORT_h
+#define PM_SDS011_TRANSPORT_h
+
+#include "sds011port.h"
+
+/// byte transport between the library and a sensor.
+/// The protocol code only needs these four operations, so the same code
+/// runs on an Arduino Stream, a POSIX tty or an in-process simulator.
+class sds011Transport {
+	public:
+		virtual ~sds011Transport(void) {}
+		/// number of received bytes ready to be read
+		virtual int available(void) = 0;
+		/// next received byte, -1 when none is available
+		virtual int read(void) = 0;
+		/// writes len bytes, returns the number of bytes accepted
+		virtual size_t write( const uint8_t *buf, size_t len ) = 0;
+		/// writes a single byte
+		size_t write( uint8_t c ) { return( write( &c, 1 ) ); }
+		/// waits until written bytes have left the transmitter
+		virtual void flush(void) {}
+};
+
+#ifdef ARDUINO
+/// transport over any Arduino Stream, e.g. a HardwareSerial port
+class sds011StreamTransport : public sds011Transport {
+	public:
+		sds011StreamTransport(void) : _stream(NULL) {}
+		/// attaches the stream used for all transfers
+		void attach( Stream *stream ) { _stream = stream; }
+		int available(void) { return( _stream->available() ); }
+		int read(void) { return( _stream->read() ); }
+		size_t write( const uint8_t *buf, size_t len ) { return( _stream->write( buf, len ) ); }
+		void flush(void) { _stream->flush(); }
+	private:
+		/// the attached stream
+		Stream *_stream;
+};
+#endif
+
+#if SDS011_HOST
+#ifndef SDS011_WRITE_TIMEOUT
+/// longest wait in ms for a busy descriptor to take more bytes, 5 commands at 9600 baud
+#define SDS011_WRITE_TIMEOUT 100
+#endif
+
+/// transport over a POSIX tty, a USB-serial adapter or a pty, on a Linux host
+class sds011PosixTransport : public sds011Transport {
+	public:
+		sds011PosixTransport(void);
+		~sds011PosixTransport(void);
+		bool open( const char *path, unsigned long baud = 9600 );
+		bool attach( int fd, bool owned = false );
+		void close(void);
+		/// the file descriptor, -1 when closed
+		int fd(void) const { return( _fd ); }
+		int available(void);
+		int read(void);
+		size_t write( const uint8_t *buf, size_t len );
+		void flush(void);
+	private:
+		/// the tty file descriptor
+		int _fd;
+		/// true when close() has to close _fd
+		bool _owned;
+		/// bytes read from _fd but not yet handed out
+		uint8_t _buf[256];
+		/// read position in _buf
+		uint16_t _head;
+		/// fill level of _buf
+		uint16_t _tail;
+		void fill(void);
+};
+#endif
+
+#endif
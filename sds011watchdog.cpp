@@ -0,0 +1,179 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (liveness watchdog implementation)
+
+/// @file sds011watchdog.cpp
+/// @author Sajjad Hussain
+/// @version 0.1
+
+#include <string.h>
+
+#include "sds011watchdog.h"
+
+/**************************************************************************/
+/*!
+    @brief  constructor for the class
+*/
+/**************************************************************************/
+sds011Watchdog::sds011Watchdog(void) : _sensor(NULL), _reinit(NULL), _ctx(NULL) {
+}
+
+/**************************************************************************/
+/*!
+    @brief  starts watching a sensor. No command is sent; apply the profile
+    first if the sensor may not be set up yet.
+    @param sensor the sensor, begun
+    @param profile the settings recovery restores; mode and work period
+    also give the expected interval between frames
+    @param limit silence in ms before recovery starts, 0 for three expected intervals
+    @returns true
+*/
+/**************************************************************************/
+bool sds011Watchdog::begin( sds011 *sensor, const sds011Profile &profile, uint32_t limit ) {
+  _sensor = sensor;
+  _profile = profile;
+  if ( ( profile.fields & SDS011_FIELD_MODE ) && profile.mode == QUERY_MODE )
+  {
+    _interval = SDS011_WATCHDOG_QUERY;
+  }else if ( ( profile.fields & SDS011_FIELD_PERIOD ) && profile.period )
+  {
+    _interval = profile.period * 60000UL;
+  }else
+  {
+    // continuous auto reports
+    _interval = 1000UL;
+  }
+  _limit = limit ? limit : 3 * _interval;
+  _patience = 2 * _interval < SDS011_WATCHDOG_PATIENCE ? SDS011_WATCHDOG_PATIENCE : 2 * _interval;
+  _step = SDS011_RECOVER_NONE;
+  memset( &_report, 0, sizeof( _report ) );
+  _recoveryTotal = 0;
+  _last = _asked = _detected = _stepAt = millis();
+  // query at once
+  _asked -= SDS011_WATCHDOG_QUERY;
+  return( true );
+}
+
+/**************************************************************************/
+/*!
+    @brief  reads the sensor and runs the recovery when it stays silent
+    @param sample receives the sample of a valid data frame
+    @returns true when sample was filled
+*/
+/**************************************************************************/
+bool sds011Watchdog::poll( sds011Sample *sample ) {
+  uint32_t now = millis();
+  sds011SampleResult r;
+  bool got = false;
+
+  if ( _sensor == NULL ) return( false );
+  if ( ( _profile.fields & SDS011_FIELD_MODE ) && _profile.mode == QUERY_MODE )
+  {
+    if ( now - _asked >= SDS011_WATCHDOG_QUERY )
+    {
+      _asked = now;
+      r = _sensor->query();
+      if ( ( got = r.error == SDS011_OK ) ) *sample = r.sample;
+    }
+  }else
+  {
+    got = _sensor->dataAutoQueryRaw( sample );
+  }
+  now = millis();
+  if ( got )
+  {
+    received( now );
+    return( true );
+  }
+
+  if ( _step == SDS011_RECOVER_NONE )
+  {
+    if ( now - _last < _limit ) return( false );
+    ++_report.outages;
+    _detected = now;
+    _step = SDS011_RECOVER_RESYNC;
+  }else
+  {
+    if ( now - _stepAt < _patience ) return( false );
+    // after the UART, start over with the cheap steps
+    _step = _step == SDS011_RECOVER_REINIT ? (uint8_t)SDS011_RECOVER_RESYNC : (uint8_t)( _step + 1 );
+  }
+  recover();
+  return( false );
+}
+
+/**************************************************************************/
+/*!
+    @brief  accounts a valid frame: the gap since the previous one and the
+    end of an outage
+    @param now millis() of the frame
+    @returns void
+*/
+/**************************************************************************/
+void sds011Watchdog::received( uint32_t now ) {
+  uint32_t gap = now - _last, took;
+
+  if ( _report.frames )
+  {
+    if ( gap > _interval + _interval / 2 )
+    {
+      ++_report.gaps;
+      _report.gapTime += gap - _interval;
+    }
+    if ( gap > _report.longestGap ) _report.longestGap = gap;
+  }
+  ++_report.frames;
+  if ( _step != SDS011_RECOVER_NONE )
+  {
+    took = now - _detected;
+    ++_report.recoveries;
+    ++_report.recoveredBy[_step];
+    _recoveryTotal += took;
+    if ( took > _report.maxRecovery ) _report.maxRecovery = took;
+    _step = SDS011_RECOVER_NONE;
+  }
+  _last = now;
+}
+
+/**************************************************************************/
+/*!
+    @brief  takes the current recovery step
+    @returns void
+*/
+/**************************************************************************/
+void sds011Watchdog::recover(void) {
+  ++_report.actions[_step];
+  switch ( _step )
+  {
+    case SDS011_RECOVER_RESYNC:
+      _sensor->resync();
+      break;
+    case SDS011_RECOVER_WAKE:
+      _sensor->resync();
+      // a waking sensor often does not answer, the next frames will tell
+      _sensor->setPower( SDS011_POWER_WORK );
+      break;
+    case SDS011_RECOVER_CONFIGURE:
+      // the cache says what was set, not what the sensor does now
+      _sensor->forgetState();
+      _sensor->applyProfile( _profile );
+      break;
+    case SDS011_RECOVER_REINIT:
+      if ( _reinit ) _reinit( _ctx );
+      _sensor->resync();
+      break;
+  }
+  // the commands took time, give the step its full patience
+  _stepAt = millis();
+}
+
+/**************************************************************************/
+/*!
+    @brief  reports data gaps and recoveries so far
+    @param out the report
+    @returns void
+*/
+/**************************************************************************/
+void sds011Watchdog::report( sds011WatchdogReport *out ) const {
+  *out = _report;
+  out->meanRecovery = _report.recoveries ? (uint32_t)( _recoveryTotal / _report.recoveries ) : 0;
+  out->step = _step;
+}
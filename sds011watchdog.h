@@ -0,0 +1,124 @@
+//! ESP32 C/C++ Arduino library for the Nova Fitness SDS011 PM sensor (liveness watchdog interface)
+
+/// @file sds011watchdog.h
+/// @author Sajjad Hussain
+/// @version 0.1
+///
+/// A sensor that falls asleep, is left in query mode by someone else or
+/// sits behind a wedged UART simply stops sending frames, and the read
+/// calls return false forever. sds011Watchdog reads the sensor, tracks the
+/// time since the last valid data frame and, once it exceeds a limit,
+/// escalates through recovery steps until frames arrive again. Gaps in the
+/// data and the time to recovery are counted, so recovery can be measured
+/// against a misbehaving sensor (see sds011watchtool).
+
+#ifndef PM_SDS011_WATCHDOG_h
+#define PM_SDS011_WATCHDOG_h
+
+#include "sds011lib.h"
+
+/// interval between queries while the profile selects query mode, in ms
+#define SDS011_WATCHDOG_QUERY 1000UL
+/// shortest time a recovery step is given to bring frames back, in ms
+#define SDS011_WATCHDOG_PATIENCE 2000UL
+/// number of sds011Recovery steps, SDS011_RECOVER_NONE included
+#define SDS011_RECOVER_STEPS 5
+
+/// recovery steps of an sds011Watchdog, in the order they are tried
+enum sds011Recovery : uint8_t {
+	/// healthy, frames arrive
+	SDS011_RECOVER_NONE,
+	/// drop buffered bytes and the partial frame of the parser
+	SDS011_RECOVER_RESYNC,
+	/// send the wake command
+	SDS011_RECOVER_WAKE,
+	/// forget the cached settings and apply the profile again
+	SDS011_RECOVER_CONFIGURE,
+	/// re-initialize the UART through the callback given to onReinit()
+	SDS011_RECOVER_REINIT
+};
+
+/// re-initializes the UART of a sensor, e.g. Serial2.end() and
+/// Serial2.begin() on the ESP32 or reopening the tty on a host; returns false on failure
+typedef bool (*sds011ReinitFn)( void *ctx );
+
+/// data gaps and recoveries seen by an sds011Watchdog
+struct sds011WatchdogReport {
+	/// valid data frames received
+	uint32_t frames;
+	/// intervals between frames longer than 1.5 expected intervals
+	uint32_t gaps;
+	/// data missing in those gaps, ms beyond the expected interval
+	uint32_t gapTime;
+	/// longest interval between two frames in ms
+	uint32_t longestGap;
+	/// outages, silences longer than the limit
+	uint32_t outages;
+	/// outages ended by a valid frame
+	uint32_t recoveries;
+	/// mean time from detecting an outage to the next valid frame in ms
+	uint32_t meanRecovery;
+	/// longest time from detecting an outage to the next valid frame in ms
+	uint32_t maxRecovery;
+	/// recovery steps taken, indexed by sds011Recovery
+	uint32_t actions[SDS011_RECOVER_STEPS];
+	/// recoveries by the last step taken before frames came back
+	uint32_t recoveredBy[SDS011_RECOVER_STEPS];
+	/// current step, SDS011_RECOVER_NONE while healthy
+	uint8_t step;
+};
+
+/// reads a sensor and keeps it alive. Call poll() from loop() instead of
+/// the read commands: in auto report mode it waits for reports, in query
+/// mode it queries once a second. When no valid frame came for the limit,
+/// it resyncs, wakes the sensor, applies the profile again and
+/// re-initializes the UART, one step at a time and each given time to
+/// work, and starts over until a frame arrives.
+class sds011Watchdog {
+	public:
+		sds011Watchdog(void);
+		bool begin( sds011 *sensor, const sds011Profile &profile, uint32_t limit = 0 );
+		/// sets the UART re-initialization of the last step; without it the step only resyncs
+		void onReinit( sds011ReinitFn fn, void *ctx = NULL ) { _reinit = fn; _ctx = ctx; }
+		bool poll( sds011Sample *sample );
+		void report( sds011WatchdogReport *out ) const;
+		/// true while frames arrive within the limit
+		bool healthy(void) const { return( _step == SDS011_RECOVER_NONE ); }
+		/// expected interval between frames in ms
+		uint32_t interval(void) const { return( _interval ); }
+		/// silence in ms after which recovery starts
+		uint32_t limit(void) const { return( _limit ); }
+	private:
+		/// the sensor
+		sds011 *_sensor;
+		/// settings to restore
+		sds011Profile _profile;
+		/// UART re-initialization
+		sds011ReinitFn _reinit;
+		/// context passed to _reinit
+		void *_ctx;
+		/// expected interval between frames in ms
+		uint32_t _interval;
+		/// silence before recovery starts in ms
+		uint32_t _limit;
+		/// time given to each recovery step in ms
+		uint32_t _patience;
+		/// time of the last valid frame
+		uint32_t _last;
+		/// time of the last query
+		uint32_t _asked;
+		/// time the current outage was detected
+		uint32_t _detected;
+		/// time the current step was taken
+		uint32_t _stepAt;
+		/// current sds011Recovery step
+		uint8_t _step;
+		/// counters of the report
+		sds011WatchdogReport _report;
+		/// sum of the recovery times in ms
+		uint64_t _recoveryTotal;
+		void received( uint32_t now );
+		void recover(void);
+};
+
+#endif